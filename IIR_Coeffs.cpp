@@ -65,3 +65,19 @@ double coeffs_hp_EOG[5 * 18] = {
     1.0, -2.0, 1.0, -1.9963747488087777, 0.9965497403747143,
     1.0, -2.0, 1.0, -1.9986704697237774, 0.9988456625203688
 };
+
+// Spindle (sigma) band, 11 to 16 hz: 4th order Butterworth high-pass and low-pass at 250 hz
+double coeffs_sigma[5 * 4] = {
+    0.7834480529234297, -1.5668961058468593, 0.7834480529234297, -1.5365710016786793, 0.5972212100150396,
+    0.8882340710918821, -1.7764681421837643, 0.8882340710918821, -1.7420870614840582, 0.8108492228834703,
+    0.0292924500996476, 0.0585849001992952, 0.0292924500996476, -1.3517096524829348, 0.4688794528815250,
+    0.0346886763195607, 0.0693773526391215, 0.0346886763195607, -1.6007202693355638, 0.7394749746138068,
+};
+
+// Slow oscillation and K-complex band, 0.16 to 4 hz: 2nd order Butterworth high-pass, 6th order low-pass at 250 hz
+double coeffs_slow[5 * 4] = {
+    0.9971605936725066, -1.9943211873450133, 0.9971605936725066, -1.9943131251004707, 0.9943292495895557,
+    0.0023013902038520, 0.0046027804077040, 0.0023013902038520, -1.8140449395949845, 0.8232505004103924,
+    0.0023572087728523, 0.0047144175457046, 0.0023572087728523, -1.8580432987002595, 0.8674721337916687,
+    0.0024605767411191, 0.0049211534822382, 0.0024605767411191, -1.9395219368889078, 0.9493642438533840,
+};
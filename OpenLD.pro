@@ -13,7 +13,7 @@
 #   You should have received a copy of the GNU General Public License
 #   along with OpenLD.  If not, see <http://www.gnu.org/licenses/>.
 
-QT       += core serialport multimedia
+QT       += core serialport
 
 QT       -= gui
 
@@ -24,9 +24,20 @@ LIBS     += -lncursesw
 # For Linux
 # LIBS     += -lfftw
 # LIBS     += -lncurses
+# LIBS     += -lpthread
+
+# Sound cues straight to ALSA or WinMM, without them only the null and WAV file outputs are there
+linux {
+    DEFINES  += OPENLD_ALSA
+    LIBS     += -lasound
+}
+win32 {
+    DEFINES  += OPENLD_WINMM
+    LIBS     += -lwinmm
+}
 
 TARGET = OpenLD
-CONFIG   += console
+CONFIG   += console c++11
 CONFIG   -= app_bundle
 
 TEMPLATE = app
@@ -48,11 +59,45 @@ SOURCES += main.cpp\
         edflib.c \
         guiconsole.cpp \
         filterIIR.cpp \
+        filterBank.cpp \
+        workspace.cpp \
+        polyphaseDecimator.cpp \
+        mainsNotch.cpp \
+        overlapSaveFIR.cpp \
+        fixedFilterBank.cpp \
+        pipeline.cpp \
+        bandTracker.cpp \
         remDetect.cpp \
+        saccadeDetector.cpp \
+        spindleDetector.cpp \
+        slowWaveDetector.cpp \
+        stimulusScheduler.cpp \
+        cueEngine.cpp \
+        sleepStager.cpp \
+        sleepModel.cpp \
+        featureStore.cpp \
         IIR_Coeffs.cpp
 
 HEADERS  += serialmonitor.h \
         edflib.h \
         guiconsole.h \
         filterIIR.h \
-        remDetect.h
+        filterBank.h \
+        biquadCascade.h \
+        workspace.h \
+        polyphaseDecimator.h \
+        mainsNotch.h \
+        overlapSaveFIR.h \
+        fixedFilterBank.h \
+        pipeline.h \
+        bandTracker.h \
+        remDetect.h \
+        saccadeDetector.h \
+        spindleDetector.h \
+        slowWaveDetector.h \
+        stimulusScheduler.h \
+        cueEngine.h \
+        sleepStager.h \
+        sleepModel.h \
+        featureStore.h \
+        analysisConstants.h
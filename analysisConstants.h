@@ -0,0 +1,58 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef ANALYSISCONSTANTS_H
+#define ANALYSISCONSTANTS_H
+
+/* ANALYSIS SETTINGS SHARED BY THE LIVE ANALYSIS AND THE OFFLINE TOOLS
+ *
+ * serialmonitor.cpp decides REM and stages sleep with these, and tools/ replays
+ * recordings through the same analysis with them, so a tuned limit or a changed
+ * window means the same thing in both.
+ */
+
+// Rate the IIR designs and REM detection run at, acquisition is decimated down to it
+const int ANALYSIS_FREQ = 250;
+const int REM_DATA_WINDOW = ANALYSIS_FREQ * 2;
+const int FFT_WINDOW = 512;
+const int EPOCH_SEC = 30;
+const int EPOCH_HOP_SEC = REM_DATA_WINDOW / ANALYSIS_FREQ; // New epoch-averaged decision every sub-epoch
+const double MAINS_FREQ = 60.0;
+const double MAINS_BANDWIDTH = 1.0;
+
+// REM decision: remDetect::set_limits() on the 8 - 16 hz band, then the windows with eye movements
+const int REM_BAND_LOW = 8;
+const int REM_BAND_HIGH = 16;
+const double REM_MIN_SEFD = 4;
+const double REM_MAX_AP = 17;
+const double REM_MIN_RP = -15;
+const double REM_MAX_RP = -13;
+const int EOG_COUNTER_THRESHOLD = 2;
+const int MIN_WINDOW_SACCADES = 1; // Saccades for a sub-epoch to count as eye movement
+
+// SaccadeDetector::set_limits()
+const double SACCADE_MIN_VELOCITY = 1500; // uV/s
+const double SACCADE_MIN_AMPLITUDE = 25;  // uV
+
+#endif // ANALYSISCONSTANTS_H
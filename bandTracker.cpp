@@ -0,0 +1,165 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "bandTracker.h"
+#include <math.h>
+
+#define FREQ_TO_BIN(x, N_FFT, Fs) int(x * N_FFT/Fs)
+
+// Recompute the sliding sums exactly after this many windows of samples
+const int BAND_TRACKER_RESYNC = 256;
+
+// Hamming window, 0.54 - 0.46 cos(2 pi n / (N - 1)), as in remDetect
+const double HM_A0 = 0.54;
+const double HM_A1 = 0.23;
+
+BandTracker::BandTracker(int Fs, int size_fft, int size_window, int f_Start, int f_End)
+{
+    m_Fs = Fs;
+    m_size_fft = size_fft;
+    m_size_window = size_window;
+
+    // One bin past f_End, which remDetect's SEFx may step onto
+    m_bin_Start = FREQ_TO_BIN(f_Start, size_fft, Fs);
+    m_bin_End = FREQ_TO_BIN(f_End, size_fft, Fs);
+    int bin_End = m_bin_End + 1;
+    if (m_bin_Start < 0) m_bin_Start = 0;
+    if (bin_End > size_fft / 2 - 1) bin_End = size_fft / 2 - 1;
+    if (m_bin_End > bin_End) m_bin_End = bin_End;
+    m_bins = (bin_End >= m_bin_Start) ? bin_End - m_bin_Start + 1 : 0;
+
+    int n = 3 * m_bins;
+    m_re = new double[n];
+    m_im = new double[n];
+    m_rot_re = new double[n];
+    m_rot_im = new double[n];
+    m_tail_re = new double[n];
+    m_tail_im = new double[n];
+    m_freq = new double[n];
+
+    // Frequencies in cycles per sample; the window's cosine shifts each bin both ways
+    double shift = (size_window > 1) ? 1.0 / (size_window - 1) : 0.0;
+    for (int b = 0; b < m_bins; b++) {
+        double f = (double)(m_bin_Start + b) / size_fft;
+        m_freq[b] = f;
+        m_freq[m_bins + b] = f - shift;
+        m_freq[2 * m_bins + b] = f + shift;
+    }
+
+    // S(t + 1) = (S(t) - oldest) e^(j w) + newest e^(-j w (N - 1))
+    for (int i = 0; i < n; i++) {
+        double w = 2.0 * M_PI * m_freq[i];
+        m_rot_re[i] = cos(w);
+        m_rot_im[i] = sin(w);
+        m_tail_re[i] = cos(w * (size_window - 1));
+        m_tail_im[i] = -sin(w * (size_window - 1));
+        m_re[i] = 0.0;
+        m_im[i] = 0.0;
+    }
+
+    m_history = new double[size_window];
+    for (int i = 0; i < size_window; i++) m_history[i] = 0.0;
+    m_pos = 0;
+    m_count = 0;
+
+    m_spectrum = new double[size_fft / 2];
+    for (int i = 0; i < size_fft / 2; i++) m_spectrum[i] = 0.0;
+}
+
+void BandTracker::push(const double *data, int num_samples)
+{
+    int n = 3 * m_bins;
+
+    for (int s = 0; s < num_samples; s++) {
+        double x = data[s];
+        double x_out = m_history[m_pos];
+        m_history[m_pos] = x;
+        if (++m_pos == m_size_window) m_pos = 0;
+
+        for (int i = 0; i < n; i++) {
+            double re = m_re[i] - x_out;
+            double im = m_im[i];
+            m_re[i] = re * m_rot_re[i] - im * m_rot_im[i] + x * m_tail_re[i];
+            m_im[i] = re * m_rot_im[i] + im * m_rot_re[i] + x * m_tail_im[i];
+        }
+
+        if (++m_count % ((long)m_size_window * BAND_TRACKER_RESYNC) == 0) resync();
+    }
+}
+
+// Sum the history directly, oldest sample first as n = 0
+void BandTracker::resync()
+{
+    for (int i = 0; i < 3 * m_bins; i++) {
+        double w = 2.0 * M_PI * m_freq[i];
+        double re = 0.0, im = 0.0;
+
+        for (int k = 0; k < m_size_window; k++) {
+            double x = m_history[(m_pos + k) % m_size_window];
+            re += x * cos(w * k);
+            im -= x * sin(w * k);
+        }
+
+        m_re[i] = re;
+        m_im[i] = im;
+    }
+}
+
+double *BandTracker::spectrum()
+{
+    for (int b = 0; b < m_bins; b++) {
+        double re = HM_A0 * m_re[b] - HM_A1 * (m_re[m_bins + b] + m_re[2 * m_bins + b]);
+        double im = HM_A0 * m_im[b] - HM_A1 * (m_im[m_bins + b] + m_im[2 * m_bins + b]);
+
+        // Same scale as remDetect::fft_power_Spectrum
+        m_spectrum[m_bin_Start + b] = sqrt(re * re + im * im) / (m_size_fft / 4);
+    }
+
+    return m_spectrum;
+}
+
+// Absolute power of the band in dB, as remDetect::absPower on the same spectrum
+double BandTracker::band_Power()
+{
+    double *spectrum_now = spectrum();
+    double sum = 0.0;
+
+    for (int i = m_bin_Start; i <= m_bin_End; i++) sum += spectrum_now[i] * ((double) m_Fs) / ((double) m_size_fft);
+
+    return 20.0 * log10(sum);
+}
+
+BandTracker::~BandTracker()
+{
+    delete[] m_re;
+    delete[] m_im;
+    delete[] m_rot_re;
+    delete[] m_rot_im;
+    delete[] m_tail_re;
+    delete[] m_tail_im;
+    delete[] m_freq;
+    delete[] m_history;
+    delete[] m_spectrum;
+}
@@ -0,0 +1,98 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#ifndef BANDTRACKER_H
+#define BANDTRACKER_H
+
+/* STREAMING BAND POWER TRACKER
+ *
+ * Keeps the bins of remDetect's spectrum in one band up to date sample by sample
+ * with a sliding DFT, so the band can be read at any sample instead of once per
+ * window. The Hamming window is three complex exponentials, so every bin is built
+ * from three sliding sums, each updated in O(1) per sample. The sums are recomputed
+ * from the history now and then so rounding can not drift over a night.
+ * spectrum() has the same layout and scale as remDetect::fft_power_Spectrum
+ * over the last Window size samples, bins outside the tracked band are zero.
+ *
+ * COST: about 33 flops per tracked bin per sample. For a few bins that is cheap,
+ * e.g. 8 - 11 hz at 250 SPS and a 512 FFT (8 bins) is ~260 flops per sample, about
+ * the cost of one 512 point real FFT (~6k flops) every 25 samples. So it only pays
+ * off when the band is read more often than that, e.g. after every burst of
+ * samples in a closed loop. For once-per-window features over many bins it costs
+ * far more than the FFT: remDetect's 1 - 35 hz (71 bins) is ~2.3k flops per sample,
+ * some 200 times one FFT every 2 s.
+ *
+ * HOW TO USE
+    1. Initialize object, with the same sizes as remDetect and the band to track:
+        BandTracker(Sampling Frequency, FFT size, Window size, f_Start, f_End)
+    2. Push samples as they arrive, any block size (without DC, e.g. high-passed):
+        BandTracker.push(data, # of samples);
+    3. Whenever a decision is needed, once BandTracker.ready():
+        BandTracker.band_Power(), same as remDetect's absPower over f_Start - f_End
+        or remDetect.calc_Features(BandTracker.spectrum(), f_Start, f_End, ...) for SEFd and AP
+        (RP also needs 1 - 35 hz, see COST)
+ *
+ */
+
+class BandTracker
+{
+public:
+    BandTracker(int Fs, int size_fft, int size_window, int f_Start, int f_End);
+    ~BandTracker();
+
+    void push(const double *data, int num_samples);
+    double *spectrum();
+    double band_Power();
+
+    // 1 once a whole window has been pushed
+    int ready() const { return m_count >= m_size_window; }
+
+private:
+    BandTracker(const BandTracker &);
+    BandTracker &operator=(const BandTracker &);
+
+    void resync();
+
+    int m_Fs;
+    int m_size_fft;
+    int m_size_window;
+    int m_bin_Start, m_bin_End, m_bins;
+
+    // Sliding sums, [bin | bin - window freq | bin + window freq] x m_bins
+    double *m_re, *m_im;
+    double *m_rot_re, *m_rot_im;
+    double *m_tail_re, *m_tail_im;
+    double *m_freq;
+
+    // Last m_size_window samples, oldest at m_pos
+    double *m_history;
+    int m_pos;
+    long m_count;
+
+    double *m_spectrum;
+
+};
+
+#endif // BANDTRACKER_H
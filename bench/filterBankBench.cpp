@@ -0,0 +1,174 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+/* FILTERBANK THROUGHPUT AGAINST THE PER-SAMPLE STATE LOOP IT REPLACED
+ *
+ * The cascade used to load and store every delay line from the bank's state
+ * on every sample, with the coefficients read through the design pointer.
+ * That loop is kept below as the "before"; the "after" is FilterBank, which
+ * keeps the state and coefficients in locals for the whole call.
+ * Streams a synthetic recording in blocks through process() (the iir= stage)
+ * and in windows through filtfilt(), for each shipped design and 1 to 3 fused
+ * channels, prints million samples per second of both and returns 1 if the
+ * outputs differ.
+ */
+
+#include "../filterBank.h"
+#include "../biquadCascade.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <math.h>
+
+extern double coeffs_hp[];
+extern double coeffs_hp_EOG[];
+extern double coeffs_lp[];
+
+const int SMP_FREQ = 250;
+const int MAX_CHANNELS = 3;
+const int BLOCK = SMP_FREQ;
+const int WINDOW = SMP_FREQ * 2;
+const int SECONDS = 600;
+const int FILTFILT_PASSES = 20;
+const double TOLERANCE = 1e-9;
+
+// The loop before: every stage of every channel per sample, state through memory
+static void old_Cascade(const double *iirCoeffs, double *state, int stages, int channels,
+                        const double *input, int in_stride, double *output, int out_stride, int num_samples, int step)
+{
+    int start = (step > 0) ? 0 : num_samples - 1;
+
+    for (int j = 0, n = start; j < num_samples; j++, n += step) {
+        for (int c = 0; c < channels; c++) output[c * out_stride + j] = input[c * in_stride + n];
+
+        for (int k = 0; k < stages; k++) {
+            const double *coeffs = iirCoeffs + k * 5;
+            double *s1 = state + k * 2 * channels;
+            double *s2 = s1 + channels;
+
+            for (int c = 0; c < channels; c++)
+                output[c * out_stride + j] = biquad_Section(coeffs, s1[c], s2[c], output[c * out_stride + j]);
+        }
+    }
+}
+
+static double seconds_Since(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double difference(const double *a, const double *b, int n)
+{
+    double worst = 0.0;
+    for (int i = 0; i < n; i++) worst = fmax(worst, fabs(a[i] - b[i]));
+
+    return worst;
+}
+
+int main()
+{
+    const int total = SMP_FREQ * SECONDS;
+    double *input = new double[MAX_CHANNELS * total];
+    double *before = new double[MAX_CHANNELS * total];
+    double *after = new double[MAX_CHANNELS * total];
+    double *temp = new double[MAX_CHANNELS * WINDOW];
+
+    // 2 Hz delta, 10 Hz alpha and a slow electrode drift, plus noise, in microvolts
+    srand(1);
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        for (int i = 0; i < total; i++) {
+            double t = (double) i / SMP_FREQ;
+            input[c * total + i] = 40.0 * sin(2 * M_PI * 2.0 * t + c) + 20.0 * sin(2 * M_PI * 10.0 * t) +
+                                   200.0 * sin(2 * M_PI * 0.02 * t) + 5.0 * ((double) rand() / RAND_MAX - 0.5);
+        }
+
+    struct { const char *name; double *coeffs; int stages; } designs[] = {
+        { "coeffs_hp", coeffs_hp, 1 },
+        { "coeffs_lp", coeffs_lp, 6 },
+        { "coeffs_hp_EOG", coeffs_hp_EOG, 18 },
+    };
+
+    std::cout << std::setw(16) << "design" << std::setw(10) << "channels"
+              << std::setw(18) << "process before" << std::setw(14) << "after"
+              << std::setw(18) << "filtfilt before" << std::setw(14) << "after" << "  (MS/s)\n";
+
+    double worst = 0.0;
+
+    for (int d = 0; d < 3; d++) {
+        int stages = designs[d].stages;
+
+        for (int channels = 1; channels <= MAX_CHANNELS; channels++) {
+            double samples = (double) channels * total;
+            double *state = new double[stages * 2 * channels];
+
+            // Streaming, block by block as in the pipeline
+            for (int i = 0; i < stages * 2 * channels; i++) state[i] = 0.0;
+            clock_t start = clock();
+            for (int i = 0; i < total; i += BLOCK)
+                old_Cascade(designs[d].coeffs, state, stages, channels, input + i, total, before + i, total, BLOCK, 1);
+            double process_before = seconds_Since(start);
+
+            FilterBank bank(designs[d].coeffs, stages, channels, WINDOW);
+            start = clock();
+            for (int i = 0; i < total; i += BLOCK) bank.process(input + i, after + i, BLOCK, total);
+            double process_after = seconds_Since(start);
+
+            for (int c = 0; c < channels; c++)
+                worst = fmax(worst, difference(before + c * total, after + c * total, total));
+
+            // Zero phase, window by window, the same passes as FilterBank::filtfilt
+            start = clock();
+            for (int i = 0; i < total; i += WINDOW) {
+                for (int p = 0; p < FILTFILT_PASSES; p++)
+                    old_Cascade(designs[d].coeffs, state, stages, channels, input + i, total, temp, WINDOW, WINDOW, -1);
+                for (int p = 0; p < FILTFILT_PASSES; p++)
+                    old_Cascade(designs[d].coeffs, state, stages, channels, temp, WINDOW, before + i, total, WINDOW, -1);
+            }
+            double filtfilt_before = seconds_Since(start);
+
+            start = clock();
+            for (int i = 0; i < total; i += WINDOW) bank.filtfilt(input + i, after + i, WINDOW, total);
+            double filtfilt_after = seconds_Since(start);
+
+            for (int c = 0; c < channels; c++)
+                worst = fmax(worst, difference(before + c * total, after + c * total, total));
+
+            std::cout << std::setw(16) << designs[d].name << std::setw(10) << channels << std::fixed << std::setprecision(2)
+                      << std::setw(18) << samples / process_before / 1e6 << std::setw(14) << samples / process_after / 1e6
+                      << std::setw(18) << samples / filtfilt_before / 1e6 << std::setw(14) << samples / filtfilt_after / 1e6 << "\n";
+
+            delete[] state;
+        }
+    }
+
+    std::cout << "Largest difference before/after: " << std::scientific << worst << (worst < TOLERANCE ? " OK\n" : " FAILED\n");
+
+    delete[] input;
+    delete[] before;
+    delete[] after;
+    delete[] temp;
+
+    return worst < TOLERANCE ? 0 : 1;
+}
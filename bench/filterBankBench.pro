@@ -0,0 +1,21 @@
+#   FilterBank cascade before/after benchmark, part of the project OpenLD.
+#   Build and run from this directory:
+#       qmake && make && ./filterBankBench
+
+TARGET = filterBankBench
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += filterBankBench.cpp \
+        ../filterBank.cpp \
+        ../workspace.cpp \
+        ../IIR_Coeffs.cpp
+
+HEADERS += ../filterBank.h \
+        ../biquadCascade.h \
+        ../workspace.h
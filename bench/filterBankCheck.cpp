@@ -0,0 +1,120 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+/* FILTERBANK AGAINST FILTERIIR, WITH CHANNELS SPACED APART
+ *
+ * Filters channels that sit `stride` apart in a larger buffer, with a stride
+ * different from the bank's max samples, through FilterBank::process and
+ * FilterBank::filtfilt, and compares every channel with its own filterIIR.
+ * Prints the largest difference and returns 1 if it is not at rounding level.
+ */
+
+#include "../filterBank.h"
+#include "../filterIIR.h"
+#include <iostream>
+#include <cstdlib>
+#include <math.h>
+
+extern double coeffs_hp[];
+extern double coeffs_lp[];
+
+const int SMP_FREQ = 250;
+const int CHANNELS = 5; // A pair and a group of three in the cascade
+const int MAX_SAMPLES = 200;
+const int SAMPLES = 100;
+const int STRIDE = 150;
+const double TOLERANCE = 1e-9;
+
+static double compare(const double *strided, const double *reference, int n)
+{
+    double worst = 0.0;
+    for (int i = 0; i < n; i++) worst = fmax(worst, fabs(strided[i] - reference[i]));
+
+    return worst;
+}
+
+int main()
+{
+    double input[CHANNELS * STRIDE];
+    double output[CHANNELS * STRIDE];
+    double reference[SAMPLES];
+
+    srand(1);
+    for (int c = 0; c < CHANNELS; c++)
+        for (int i = 0; i < STRIDE; i++)
+            input[c * STRIDE + i] = 30.0 * sin(2 * M_PI * (2.0 + c) * i / SMP_FREQ) + ((double) rand() / RAND_MAX - 0.5);
+
+    struct { const char *name; double *coeffs; int stages; } designs[] = {
+        { "coeffs_hp", coeffs_hp, 1 },
+        { "coeffs_lp", coeffs_lp, 6 },
+        { "coeffs_lp, first 5 stages", coeffs_lp, 5 },  // no instantiation, the generic loop
+    };
+
+    double worst = 0.0;
+
+    for (int d = 0; d < 3; d++) {
+        // In two blocks, the state carries over between calls
+        FilterBank bank(designs[d].coeffs, designs[d].stages, CHANNELS, MAX_SAMPLES);
+        bank.process(input, output, SAMPLES / 2, STRIDE);
+        bank.process(input + SAMPLES / 2, output + SAMPLES / 2, SAMPLES - SAMPLES / 2, STRIDE);
+
+        for (int c = 0; c < CHANNELS; c++) {
+            filterIIR filter(designs[d].coeffs, designs[d].stages);
+            filter.RunIIRBiquadForm2(input + c * STRIDE, reference, SAMPLES, 1);
+            worst = fmax(worst, compare(output + c * STRIDE, reference, SAMPLES));
+        }
+
+        // Forward runs take blocks longer than max samples, filtfilt refuses them
+        FilterBank bank_short(designs[d].coeffs, designs[d].stages, CHANNELS, SAMPLES / 2);
+        bank_short.process(input, output, SAMPLES, STRIDE);
+
+        for (int c = 0; c < CHANNELS; c++) {
+            filterIIR filter(designs[d].coeffs, designs[d].stages);
+            filter.RunIIRBiquadForm2(input + c * STRIDE, reference, SAMPLES, 1);
+            worst = fmax(worst, compare(output + c * STRIDE, reference, SAMPLES));
+        }
+
+        if (bank_short.filtfilt(input, output, SAMPLES, STRIDE) != -1) {
+            std::cout << "filtfilt took " << SAMPLES << " samples into a bank of " << SAMPLES / 2 << " FAILED\n";
+            return 1;
+        }
+
+        FilterBank bank_filtfilt(designs[d].coeffs, designs[d].stages, CHANNELS, MAX_SAMPLES);
+        if (bank_filtfilt.filtfilt(input, output, SAMPLES, STRIDE)) {
+            std::cout << "filtfilt refused " << SAMPLES << " samples FAILED\n";
+            return 1;
+        }
+
+        for (int c = 0; c < CHANNELS; c++) {
+            filterIIR filter(designs[d].coeffs, designs[d].stages);
+            filter.filtfilt(input + c * STRIDE, reference, SAMPLES);
+            worst = fmax(worst, compare(output + c * STRIDE, reference, SAMPLES));
+        }
+    }
+
+    std::cout << "Largest difference to filterIIR: " << worst << (worst < TOLERANCE ? " OK\n" : " FAILED\n");
+
+    return worst < TOLERANCE ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#   FilterBank against filterIIR check with strided channels, part of the project OpenLD.
+#   Build and run from this directory:
+#       qmake && make && ./filterBankCheck
+
+TARGET = filterBankCheck
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+SOURCES += filterBankCheck.cpp \
+        ../filterBank.cpp \
+        ../filterIIR.cpp \
+        ../workspace.cpp \
+        ../IIR_Coeffs.cpp
+
+HEADERS += ../filterBank.h \
+        ../filterIIR.h \
+        ../workspace.h
@@ -0,0 +1,119 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+/* THROUGHPUT AND ACCURACY OF THE FIXED-POINT CASCADES AGAINST THE DOUBLE PATH
+ *
+ * Filters a synthetic EEG-like recording of raw counts through each shipped design,
+ * once with FilterBank on physical (double) values and once with FixedFilterBank on
+ * the counts, and prints samples per second of both and the signal to error ratio
+ * of the fixed-point output.
+ */
+
+#include "../filterBank.h"
+#include "../fixedFilterBank.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <math.h>
+
+extern double coeffs_hp[];
+extern double coeffs_hp_EOG[];
+extern double coeffs_lp[];
+
+const double ADS1299_SCALE = 0.02235174445530706111277;
+const int SMP_FREQ = 250;
+const int CHANNELS = 8;
+const int BLOCK = SMP_FREQ;
+const int SECONDS = 600;
+const int GUARD_BITS = 6;
+
+static double seconds_Since(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+    const int total = SMP_FREQ * SECONDS;
+    int32_t *counts = new int32_t[CHANNELS * total];
+    double *physical = new double[CHANNELS * total];
+
+    // 2 Hz delta, 10 Hz alpha and a slow electrode drift, plus noise, in microvolts
+    srand(1);
+    for (int c = 0; c < CHANNELS; c++)
+        for (int i = 0; i < total; i++) {
+            double t = (double) i / SMP_FREQ;
+            double uV = 40.0 * sin(2 * M_PI * 2.0 * t + c) + 20.0 * sin(2 * M_PI * 10.0 * t) +
+                        200.0 * sin(2 * M_PI * 0.02 * t) + 5.0 * ((double) rand() / RAND_MAX - 0.5);
+            counts[c * total + i] = (int32_t) lround(uV / ADS1299_SCALE);
+            physical[c * total + i] = counts[c * total + i] * ADS1299_SCALE;
+        }
+
+    struct { const char *name; double *coeffs; int stages; } designs[] = {
+        { "coeffs_hp", coeffs_hp, 1 },
+        { "coeffs_lp", coeffs_lp, 6 },
+        { "coeffs_hp_EOG", coeffs_hp_EOG, 18 },
+    };
+
+    std::cout << std::setw(16) << "design" << std::setw(16) << "double MS/s"
+              << std::setw(16) << "fixed MS/s" << std::setw(16) << "SER dB" << "\n";
+
+    for (int d = 0; d < 3; d++) {
+        double *reference = new double[CHANNELS * total];
+        int32_t *fixed = new int32_t[CHANNELS * total];
+
+        // Both paths run block by block, as in the live analysis
+        FilterBank bank(designs[d].coeffs, designs[d].stages, CHANNELS, BLOCK);
+        clock_t start = clock();
+        for (int i = 0; i < total; i += BLOCK) bank.process(physical + i, reference + i, BLOCK, total);
+        double time_double = seconds_Since(start);
+
+        FixedFilterBank fixed_bank(designs[d].coeffs, designs[d].stages, CHANNELS, GUARD_BITS);
+        start = clock();
+        for (int i = 0; i < total; i += BLOCK) fixed_bank.process(counts + i, fixed + i, BLOCK, total);
+        double time_fixed = seconds_Since(start);
+
+        // Physical scaling applied once, afterwards
+        double signal = 0.0, error = 0.0;
+        for (int i = 0; i < CHANNELS * total; i++) {
+            double value = fixed[i] * ADS1299_SCALE * fixed_bank.output_Scale();
+            signal += reference[i] * reference[i];
+            error += (value - reference[i]) * (value - reference[i]);
+        }
+
+        std::cout << std::setw(16) << designs[d].name
+                  << std::setw(16) << std::fixed << std::setprecision(2) << CHANNELS * (double) total / time_double / 1e6
+                  << std::setw(16) << CHANNELS * (double) total / time_fixed / 1e6
+                  << std::setw(16) << std::setprecision(1) << 10.0 * log10(signal / error) << "\n";
+
+        delete[] reference;
+        delete[] fixed;
+    }
+
+    delete[] counts;
+    delete[] physical;
+
+    return 0;
+}
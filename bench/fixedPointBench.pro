@@ -0,0 +1,22 @@
+#   Fixed-point against double IIR cascade benchmark, part of the project OpenLD.
+#   Build and run from this directory:
+#       qmake && make && ./fixedPointBench
+
+TARGET = fixedPointBench
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += fixedPointBench.cpp \
+        ../fixedFilterBank.cpp \
+        ../filterBank.cpp \
+        ../workspace.cpp \
+        ../IIR_Coeffs.cpp
+
+HEADERS += ../fixedFilterBank.h \
+        ../filterBank.h \
+        ../workspace.h
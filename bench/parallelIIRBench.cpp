@@ -0,0 +1,155 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+/* WHOLE-NIGHT FILTERING: PARALLELIIR AGAINST THE SEQUENTIAL CASCADE
+ *
+ * Filters a synthetic 8 hour, 6 channel night at the analysis rate through
+ * hp_EOG and then lp, as tools/bdfFilter does, once channel by channel with
+ * filterIIR::RunIIRBiquadForm2 and once with ParallelIIR on 1, 2, 4, ... threads
+ * up to the number of cores, causal and zero phase. Prints the wall time of
+ * each and returns 1 if ParallelIIR differs from the sequential cascade.
+ */
+
+#include "../parallelIIR.h"
+#include "../filterIIR.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <cstdlib>
+#include <math.h>
+
+extern double coeffs_hp_EOG[];
+extern double coeffs_lp[];
+
+const int SMP_FREQ = 250;
+const int CHANNELS = 6;
+const long long SAMPLES = SMP_FREQ * 3600LL * 8;
+// Rounding on a 30 mV offset, far below a BDF step of 0.02 uV
+const double TOLERANCE = 1e-6;
+
+static double seconds_Since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Channel by channel, a fresh cascade per design and direction
+static void sequential(const double *input, double *output, int zero_phase)
+{
+    const double *designs[2] = { coeffs_hp_EOG, coeffs_lp };
+    const int stages[2] = { 18, 6 };
+    double *temp = new double[SAMPLES];
+
+    for (int c = 0; c < CHANNELS; c++) {
+        double *y = output + c * SAMPLES;
+        for (long long i = 0; i < SAMPLES; i++) y[i] = input[c * SAMPLES + i];
+
+        for (int d = 0; d < 2; d++) {
+            filterIIR forward(designs[d], stages[d]);
+            forward.RunIIRBiquadForm2(y, y, (int) SAMPLES);
+            if (!zero_phase) continue;
+
+            // Step -1 reads backwards, the result comes out reversed
+            filterIIR backward(designs[d], stages[d]);
+            backward.RunIIRBiquadForm2(y, temp, (int) SAMPLES, -1);
+            for (long long i = 0; i < SAMPLES; i++) y[i] = temp[SAMPLES - 1 - i];
+        }
+    }
+
+    delete[] temp;
+}
+
+static void parallel(const double *input, double *output, int zero_phase, int threads)
+{
+    ParallelIIR hp_EOG(coeffs_hp_EOG, 18, threads);
+    ParallelIIR lp(coeffs_lp, 6, threads);
+
+    if (zero_phase) {
+        hp_EOG.filtfilt(input, output, SAMPLES, CHANNELS, SAMPLES);
+        lp.filtfilt(output, output, SAMPLES, CHANNELS, SAMPLES);
+    } else {
+        hp_EOG.filter(input, output, SAMPLES, CHANNELS, SAMPLES);
+        lp.filter(output, output, SAMPLES, CHANNELS, SAMPLES);
+    }
+}
+
+static double difference(const double *a, const double *b, long long n)
+{
+    double worst = 0.0;
+    for (long long i = 0; i < n; i++) worst = fmax(worst, fabs(a[i] - b[i]));
+
+    return worst;
+}
+
+int main()
+{
+    double *input = new double[CHANNELS * SAMPLES];
+    double *before = new double[CHANNELS * SAMPLES];
+    double *after = new double[CHANNELS * SAMPLES];
+    int cores = (int) std::thread::hardware_concurrency();
+    if (cores < 1) cores = 1;
+
+    // Eye movements, 10 Hz alpha and an electrode drift around a DC offset, plus noise, in microvolts
+    srand(1);
+    for (int c = 0; c < CHANNELS; c++)
+        for (long long i = 0; i < SAMPLES; i++) {
+            double t = (double) i / SMP_FREQ;
+            input[c * SAMPLES + i] = 30000.0 + 80.0 * sin(2 * M_PI * 0.7 * t + c) + 20.0 * sin(2 * M_PI * 10.0 * t) +
+                                     300.0 * sin(2 * M_PI * 0.002 * t) + 5.0 * ((double) rand() / RAND_MAX - 0.5);
+        }
+
+    std::cout << CHANNELS << " channels x " << SAMPLES / SMP_FREQ / 3600 << " h at " << SMP_FREQ
+              << " Hz, hp_EOG then lp, " << cores << " cores\n";
+    std::cout << std::setw(12) << "" << std::setw(14) << "sequential";
+    for (int t = 1; t < cores * 2; t *= 2) std::cout << std::setw(10) << std::min(t, cores) << " thr";
+    std::cout << "  (s)\n";
+
+    double worst = 0.0;
+
+    for (int zero_phase = 0; zero_phase < 2; zero_phase++) {
+        std::cout << std::setw(12) << (zero_phase ? "filtfilt" : "filter") << std::fixed << std::setprecision(3);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sequential(input, before, zero_phase);
+        std::cout << std::setw(14) << seconds_Since(start);
+
+        for (int t = 1; t < cores * 2; t *= 2) {
+            start = std::chrono::steady_clock::now();
+            parallel(input, after, zero_phase, std::min(t, cores));
+            std::cout << std::setw(14) << seconds_Since(start);
+
+            worst = fmax(worst, difference(before, after, CHANNELS * SAMPLES));
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << "Largest difference sequential/parallel: " << std::scientific << worst << (worst < TOLERANCE ? " OK\n" : " FAILED\n");
+
+    delete[] input;
+    delete[] before;
+    delete[] after;
+
+    return worst < TOLERANCE ? 0 : 1;
+}
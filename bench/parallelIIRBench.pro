@@ -0,0 +1,24 @@
+#   Whole-night ParallelIIR against the sequential cascade, part of the project OpenLD.
+#   Build and run from this directory:
+#       qmake && make && ./parallelIIRBench
+
+TARGET = parallelIIRBench
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+# For Linux
+# LIBS     += -lpthread
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += parallelIIRBench.cpp \
+        ../parallelIIR.cpp \
+        ../filterIIR.cpp \
+        ../IIR_Coeffs.cpp
+
+HEADERS += ../parallelIIR.h \
+        ../filterIIR.h \
+        ../biquadCascade.h
@@ -0,0 +1,115 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+/* QIIR STAGE CHECK: THE FIXED-POINT CHAIN AGAINST THE DOUBLE ONE IN THE PIPELINE
+ *
+ * Runs the same recording of raw counts through two pipelines, one with the
+ * causal iir= stages and one with qiir= (FixedFilterBank on the counts), fused
+ * over two channels, and checks the qiir windows match to within the fixed-point
+ * error. Also checks a qiir stage after another stage is refused.
+ */
+
+#include "../pipeline.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <math.h>
+
+const double ADS1299_SCALE = 0.02235174445530706111277;
+const int SMP_FREQ = 250;
+const int CHANNELS = 2;
+const int WINDOW_BLOCKS = 2;
+const int SECONDS = 120;
+const double MIN_SER_DB = 60.0;
+
+static int load(Pipeline &pipeline, const char *config)
+{
+    char labels[CHANNELS][50] = { "Fpz", "EOG_L" };
+    std::istringstream stream(config);
+
+    return pipeline.load(stream, labels, CHANNELS);
+}
+
+int main()
+{
+    int failed = 0;
+
+    Pipeline reference(SMP_FREQ, SMP_FREQ, WINDOW_BLOCKS), fixed(SMP_FREQ, SMP_FREQ, WINDOW_BLOCKS);
+    if (load(reference, "Fpz iir=hp filtfilt=lp output=EEG\nEOG_L iir=hp filtfilt=lp output=EOG1\n") ||
+            load(fixed, "Fpz qiir=hp filtfilt=lp output=EEG\nEOG_L qiir=hp filtfilt=lp output=EOG1\n")) {
+        std::cout << "load: " << reference.error() << fixed.error() << "\n";
+        return 1;
+    }
+
+    // 2 Hz delta, 10 Hz alpha and a slow electrode drift, plus noise, in counts
+    int *block = new int[CHANNELS * SMP_FREQ];
+    double signal = 0.0, error = 0.0;
+    srand(1);
+
+    for (int b = 0; b < SECONDS; b++) {
+        for (int c = 0; c < CHANNELS; c++)
+            for (int i = 0; i < SMP_FREQ; i++) {
+                double t = b + (double) i / SMP_FREQ;
+                double uV = 40.0 * sin(2 * M_PI * 2.0 * t + c) + 20.0 * sin(2 * M_PI * 10.0 * t) +
+                            200.0 * sin(2 * M_PI * 0.02 * t) + 5.0 * ((double) rand() / RAND_MAX - 0.5);
+                block[c * SMP_FREQ + i] = (int) lround(uV / ADS1299_SCALE);
+            }
+
+        int ready = reference.push_Block(block, SMP_FREQ, ADS1299_SCALE);
+        if (fixed.push_Block(block, SMP_FREQ, ADS1299_SCALE) != ready) {
+            std::cout << "windows out of step\n";
+            return 1;
+        }
+        if (!ready) continue;
+
+        for (int role = PIPELINE_EEG; role <= PIPELINE_EOG1; role++)
+            for (int i = 0; i < fixed.output_Length(role); i++) {
+                double d = fixed.output(role)[i] - reference.output(role)[i];
+                signal += reference.output(role)[i] * reference.output(role)[i];
+                error += d * d;
+            }
+    }
+
+    double ser = 10.0 * log10(signal / error);
+    std::cout << "qiir against iir: " << ser << " dB";
+    if (ser < MIN_SER_DB) {
+        std::cout << " FAILED\n";
+        failed = 1;
+    } else {
+        std::cout << " OK\n";
+    }
+
+    // Counts only exist before the first stage
+    Pipeline late(SMP_FREQ, SMP_FREQ, WINDOW_BLOCKS);
+    if (!load(late, "Fpz notch=60,1 qiir=hp output=EEG\n")) {
+        std::cout << "qiir after notch accepted FAILED\n";
+        failed = 1;
+    } else {
+        std::cout << "qiir after notch refused: " << late.error() << " OK\n";
+    }
+
+    delete[] block;
+
+    return failed;
+}
@@ -0,0 +1,27 @@
+#   Fixed-point qiir= stage against iir= in the pipeline, part of the project OpenLD.
+#   Build and run from this directory:
+#       qmake && make && ./pipelineCheck
+
+TARGET = pipelineCheck
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+SOURCES += pipelineCheck.cpp \
+        ../pipeline.cpp \
+        ../filterBank.cpp \
+        ../fixedFilterBank.cpp \
+        ../workspace.cpp \
+        ../polyphaseDecimator.cpp \
+        ../mainsNotch.cpp \
+        ../overlapSaveFIR.cpp \
+        ../IIR_Coeffs.cpp
+
+HEADERS += ../pipeline.h \
+        ../filterBank.h \
+        ../fixedFilterBank.h \
+        ../workspace.h \
+        ../polyphaseDecimator.h \
+        ../mainsNotch.h \
+        ../overlapSaveFIR.h
@@ -0,0 +1,93 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+/* THE MODEL DOCUMENTED IN SLEEPMODEL.H, LOADED AND RUN
+ *
+ * Takes the example model out of the comment in sleepModel.h (the lines from
+ * "sleepmodel" after "For example" up to the next blank comment line), loads it
+ * and checks it scores N3 on high delta and REM on EOG activity, so the documented
+ * format can not drift from what SleepModel::load accepts.
+ * Returns 1 on failure. The header is ../sleepModel.h unless given as argument.
+ */
+
+#include "../sleepModel.h"
+#include "../sleepStager.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+static int run(SleepModel &model, double delta, double eog)
+{
+    for (int i = 0; i < model.input_Size(); i++) model.input()[i] = 0;
+    model.input()[SLEEP_FEATURE_BAND + SLEEP_DELTA] = delta;
+    model.input()[SLEEP_FEATURE_EOG] = eog;
+
+    return model.predict();
+}
+
+int main(int argc, char *argv[])
+{
+    std::ifstream header(argc > 1 ? argv[1] : "../sleepModel.h");
+    if (!header.is_open()) {
+        std::cout << "Can not open sleepModel.h FAILED\n";
+        return 1;
+    }
+
+    // Comment lines are " * " and the example is indented further
+    std::string line, example;
+    int found = 0;
+    while (std::getline(header, line)) {
+        if (line.find("For example") != std::string::npos) found = 1;
+        else if (found == 1 && line.find("sleepmodel") != std::string::npos) found = 2;
+
+        if (found == 2) {
+            if (line.size() <= 3) break;
+            example += line.substr(3) + "\n";
+        }
+    }
+
+    SleepModel model;
+    std::istringstream text(example);
+    if (found != 2 || model.load(text)) {
+        std::cout << "Documented example does not load: " << model.error() << " FAILED\n";
+        return 1;
+    }
+
+    if (model.input_Kind() != SLEEP_MODEL_FEATURES || model.input_Size() != SLEEP_FEATURES ||
+            model.output_Size() != SLEEP_STAGES) {
+        std::cout << "Documented example has the wrong shape FAILED\n";
+        return 1;
+    }
+
+    const char *names[SLEEP_STAGES] = { "W", "N1", "N2", "N3", "REM" };
+    int n2 = run(model, 10, 0), n3 = run(model, 40, 0), rem = run(model, 10, 5);
+    std::cout << "Documented example: " << names[n2] << ", " << names[n3] << ", " << names[rem];
+
+    int ok = (n2 == SLEEP_N2 && n3 == SLEEP_N3 && rem == SLEEP_REM);
+    std::cout << (ok ? " OK\n" : " FAILED\n");
+
+    return ok ? 0 : 1;
+}
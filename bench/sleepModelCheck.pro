@@ -0,0 +1,17 @@
+#   Loads the sleep model documented in sleepModel.h, part of the project OpenLD.
+#   Build and run from this directory:
+#       qmake && make && ./sleepModelCheck
+
+TARGET = sleepModelCheck
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+SOURCES += sleepModelCheck.cpp \
+        ../sleepModel.cpp \
+        ../workspace.cpp
+
+HEADERS += ../sleepModel.h \
+        ../sleepStager.h \
+        ../workspace.h
@@ -0,0 +1,56 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef BIQUADCASCADE_H
+#define BIQUADCASCADE_H
+
+/* ONE IIR BIQUAD SECTION, SHARED BY THE CASCADES
+ *
+ * Sections are evaluated in transposed direct form II. FilterBank runs them through
+ * run_Cascade<# of stages>, instantiated for the shipped designs (see filterBank.cpp),
+ * so the section loop is unrolled; ParallelIIR and the stimulus scheduler call
+ * biquad_Section() directly on their own delay lines.
+ *
+ * HOW TO USE
+    y = biquad_Section(section coefficients, s1, s2, x);  // s1, s2 carry over to the next sample
+ *
+ */
+
+/* IIR coefficient layout:
+    => b0, b1, b2, a1, a2
+       ...
+*/
+
+// One transposed direct form II section
+template <typename T>
+inline T biquad_Section(const T *coeffs, T &s1, T &s2, T x)
+{
+    T y = coeffs[0] * x + s1;
+    s1 = coeffs[1] * x - coeffs[3] * y + s2;
+    s2 = coeffs[2] * x - coeffs[4] * y;
+
+    return y;
+}
+
+#endif // BIQUADCASCADE_H
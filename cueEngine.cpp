@@ -0,0 +1,653 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+
+#include "cueEngine.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iterator>
+
+#ifdef OPENLD_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+#ifdef OPENLD_WINMM
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+const int CUE_PERIOD_DIVISIONS = 4; // Periods per buffer of the paced and WinMM sinks
+const double CUE_WINMM_MIN_LATENCY_SEC = 0.04;
+
+#ifdef OPENLD_WINMM
+// One header per period of the buffer, done ones signal the event
+struct WaveOut {
+    HWAVEOUT device;
+    HANDLE event;
+    WAVEHDR headers[CUE_PERIOD_DIVISIONS];
+    std::vector<short> data;
+    int next;
+};
+#endif
+
+static inline unsigned read_LE(const unsigned char *data, int bytes)
+{
+    unsigned value = 0;
+    for (int i = bytes - 1; i >= 0; i--) value = (value << 8) | data[i];
+
+    return value;
+}
+
+static void put_LE(FILE *file, unsigned value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) fputc((value >> (8 * i)) & 0xff, file);
+}
+
+// 16 bit PCM header, the sizes are patched when the file is closed
+static void write_WAV_Header(FILE *file, int rate, int channels, long long frames)
+{
+    unsigned data_size = (unsigned) (frames * channels * 2);
+
+    fwrite("RIFF", 1, 4, file);
+    put_LE(file, 36 + data_size, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    put_LE(file, 16, 4);
+    put_LE(file, 1, 2);
+    put_LE(file, channels, 2);
+    put_LE(file, rate, 4);
+    put_LE(file, rate * channels * 2, 4);
+    put_LE(file, channels * 2, 2);
+    put_LE(file, 16, 2);
+    fwrite("data", 1, 4, file);
+    put_LE(file, data_size, 4);
+}
+
+CueEngine::CueEngine()
+{
+    m_sink = CUE_SINK_NULL;
+    m_rate = m_channels = 0;
+    m_period_frames = m_buffer_frames = 0;
+    m_running = 0;
+    m_frames = 0;
+    m_stream_start = 0;
+    m_epoch = std::chrono::steady_clock::now();
+
+    m_pcm = NULL;
+    m_wave = NULL;
+    m_file = NULL;
+    m_file_frames = 0;
+
+    for (int i = 0; i < CUE_REQUESTS; i++) m_requests[i].id = -1;
+    for (int i = 0; i < CUE_VOICES; i++) m_voices[i].cue = -1;
+    m_onset_head = m_onset_count = 0;
+    m_next_request = 0;
+
+    m_Fs = 0;
+    m_transport = 0;
+    m_clock_second = -1;
+    m_clock_offset = 0;
+}
+
+CueEngine::~CueEngine()
+{
+    close();
+}
+
+int CueEngine::default_Sink()
+{
+#if defined(OPENLD_ALSA)
+    return CUE_SINK_ALSA;
+#elif defined(OPENLD_WINMM)
+    return CUE_SINK_WINMM;
+#else
+    return CUE_SINK_NULL;
+#endif
+}
+
+int CueEngine::open(int sink, const std::string &device, int rate, int channels, double latency_sec)
+{
+    close();
+    m_error.clear();
+
+    if (rate <= 0 || channels <= 0 || latency_sec <= 0) {
+        m_error = "bad rate, channels or latency";
+        return -1;
+    }
+
+    m_sink = sink;
+    m_rate = rate;
+    m_channels = channels;
+
+    if (sink == CUE_SINK_ALSA) {
+#ifdef OPENLD_ALSA
+        snd_pcm_t *pcm;
+        int err = snd_pcm_open(&pcm, device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+        if (err >= 0) {
+            err = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16, SND_PCM_ACCESS_RW_INTERLEAVED,
+                                     channels, rate, 1, (unsigned) (latency_sec * 1e6));
+            if (err < 0) snd_pcm_close(pcm);
+        }
+        if (err < 0) {
+            m_error = "can not open " + device + ": " + snd_strerror(err);
+            return -1;
+        }
+
+        snd_pcm_uframes_t buffer_size, period_size;
+        snd_pcm_get_params(pcm, &buffer_size, &period_size);
+        m_buffer_frames = (int) buffer_size;
+        m_period_frames = (int) period_size;
+        m_pcm = pcm;
+#else
+        m_error = "built without ALSA (OPENLD_ALSA)";
+        return -1;
+#endif
+    } else if (sink == CUE_SINK_WINMM) {
+#ifdef OPENLD_WINMM
+        UINT id = WAVE_MAPPER;
+        if (device != "default") id = (UINT) atoi(device.c_str());
+
+        WAVEFORMATEX format;
+        memset(&format, 0, sizeof(format));
+        format.wFormatTag = WAVE_FORMAT_PCM;
+        format.nChannels = (WORD) channels;
+        format.nSamplesPerSec = rate;
+        format.wBitsPerSample = 16;
+        format.nBlockAlign = (WORD) (channels * 2);
+        format.nAvgBytesPerSec = rate * channels * 2;
+
+        WaveOut *wave = new WaveOut;
+        wave->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+        MMRESULT err = waveOutOpen(&wave->device, id, &format, (DWORD_PTR) wave->event, 0, CALLBACK_EVENT);
+        if (err != MMSYSERR_NOERROR) {
+            char text[MAXERRORLENGTH];
+            waveOutGetErrorTextA(err, text, sizeof(text));
+            CloseHandle(wave->event);
+            delete wave;
+            m_error = "can not open " + device + ": " + text;
+            return -1;
+        }
+
+        if (latency_sec < CUE_WINMM_MIN_LATENCY_SEC) latency_sec = CUE_WINMM_MIN_LATENCY_SEC;
+        m_period_frames = (int) (latency_sec * rate / CUE_PERIOD_DIVISIONS + 0.5);
+        m_buffer_frames = m_period_frames * CUE_PERIOD_DIVISIONS;
+
+        wave->data.assign(m_buffer_frames * channels, 0);
+        for (int i = 0; i < CUE_PERIOD_DIVISIONS; i++) {
+            WAVEHDR &header = wave->headers[i];
+            memset(&header, 0, sizeof(header));
+            header.lpData = (LPSTR) &wave->data[i * m_period_frames * channels];
+            header.dwBufferLength = m_period_frames * channels * 2;
+            waveOutPrepareHeader(wave->device, &header, sizeof(header));
+        }
+        wave->next = 0;
+        m_wave = wave;
+#else
+        m_error = "built without WinMM (OPENLD_WINMM)";
+        return -1;
+#endif
+    } else {
+        m_period_frames = (int) (latency_sec * rate / CUE_PERIOD_DIVISIONS + 0.5);
+        if (m_period_frames < 16) m_period_frames = 16;
+        m_buffer_frames = m_period_frames * CUE_PERIOD_DIVISIONS;
+
+        if (sink == CUE_SINK_FILE) {
+            m_file = fopen(device.c_str(), "wb");
+            if (!m_file) {
+                m_error = "can not create " + device;
+                return -1;
+            }
+            write_WAV_Header(m_file, rate, channels, 0);
+            m_file_frames = 0;
+
+        } else if (sink != CUE_SINK_NULL) {
+            m_error = "unknown sink";
+            return -1;
+        }
+    }
+
+    m_mix.assign(m_period_frames, 0);
+    m_period.assign(m_period_frames * m_channels, 0);
+    m_frames = 0;
+    m_stream_start = now();
+
+    m_running = 1;
+    m_thread = std::thread(&CueEngine::run, this);
+
+    return 0;
+}
+
+void CueEngine::close()
+{
+    if (m_running) {
+        m_running = 0;
+        m_thread.join();
+    }
+
+#ifdef OPENLD_ALSA
+    if (m_pcm) {
+        snd_pcm_drain((snd_pcm_t *) m_pcm);
+        snd_pcm_close((snd_pcm_t *) m_pcm);
+    }
+#endif
+    m_pcm = NULL;
+
+#ifdef OPENLD_WINMM
+    if (m_wave) {
+        WaveOut *wave = (WaveOut *) m_wave;
+
+        // Let what is queued play out, like the drain above
+        for (int i = 0; i < CUE_PERIOD_DIVISIONS; i++)
+            for (int wait = 0; wait < 10 && (wave->headers[i].dwFlags & WHDR_INQUEUE); wait++)
+                WaitForSingleObject(wave->event, 100);
+
+        waveOutReset(wave->device);
+        for (int i = 0; i < CUE_PERIOD_DIVISIONS; i++)
+            waveOutUnprepareHeader(wave->device, &wave->headers[i], sizeof(WAVEHDR));
+        waveOutClose(wave->device);
+        CloseHandle(wave->event);
+        delete wave;
+    }
+#endif
+    m_wave = NULL;
+
+    if (m_file) {
+        fseek(m_file, 0, SEEK_SET);
+        write_WAV_Header(m_file, m_rate, m_channels, m_file_frames);
+        fclose(m_file);
+        m_file = NULL;
+    }
+}
+
+// Decodes a WAV file to mono at the output rate, the cue # or -1
+int CueEngine::load(const std::string &path)
+{
+    m_error.clear();
+    if (!m_rate) {
+        m_error = "open a sink before loading cues";
+        return -1;
+    }
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        m_error = "can not open " + path;
+        return -1;
+    }
+    std::vector<unsigned char> wav((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (wav.size() < 12 || memcmp(&wav[0], "RIFF", 4) || memcmp(&wav[8], "WAVE", 4)) {
+        m_error = path + " is not a WAV file";
+        return -1;
+    }
+
+    int format = 0, channels = 0, rate = 0, bits = 0;
+    const unsigned char *data = NULL;
+    size_t data_size = 0;
+
+    for (size_t pos = 12; pos + 8 <= wav.size(); ) {
+        const unsigned char *chunk = &wav[pos];
+        size_t size = read_LE(chunk + 4, 4);
+        size_t left = wav.size() - pos - 8;
+        if (size > left) size = left;
+
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+            format = read_LE(chunk + 8, 2);
+            channels = read_LE(chunk + 10, 2);
+            rate = read_LE(chunk + 12, 4);
+            bits = read_LE(chunk + 22, 2);
+            if (format == 0xFFFE && size >= 26) format = read_LE(chunk + 32, 2); // WAVE_FORMAT_EXTENSIBLE
+        } else if (!memcmp(chunk, "data", 4)) {
+            data = chunk + 8;
+            data_size = size;
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    if (!data || channels < 1 || rate < 1 ||
+            !((format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) || (format == 3 && bits == 32))) {
+        m_error = path + ": only 8/16/24/32 bit PCM and 32 bit float WAV files are supported";
+        return -1;
+    }
+
+    // Mix down to mono, full scale at +-1
+    int bytes = bits / 8;
+    size_t frames = data_size / (channels * bytes);
+    std::vector<double> mono(frames + 1, 0.0);
+
+    for (size_t i = 0; i < frames; i++) {
+        double sum = 0;
+        for (int c = 0; c < channels; c++) {
+            const unsigned char *sample = data + (i * channels + c) * bytes;
+            unsigned raw = read_LE(sample, bytes);
+
+            if (format == 3) {
+                float value;
+                memcpy(&value, &raw, sizeof(value));
+                sum += value;
+            } else if (bits == 8) {
+                sum += ((int) raw - 128) / 128.0;
+            } else {
+                // Sign extend from the top bit of the sample
+                long long value = raw;
+                if (value & (1LL << (bits - 1))) value -= (1LL << bits);
+                sum += value / (double) (1LL << (bits - 1));
+            }
+        }
+        mono[i] = sum / channels;
+    }
+
+    // Linear interpolation to the output rate, cues are short and band limited enough
+    size_t length = (size_t) ((double) frames * m_rate / rate);
+    std::vector<short> cue(length);
+
+    for (size_t i = 0; i < length; i++) {
+        double position = (double) i * rate / m_rate;
+        size_t j = (size_t) position;
+        double value = mono[j] + (position - j) * (mono[j + 1] - mono[j]);
+
+        value = floor(value * 32767.0 + 0.5);
+        cue[i] = (short) (value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_cues.push_back(cue);
+
+    return (int) m_cues.size() - 1;
+}
+
+double CueEngine::now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+void CueEngine::set_Sample_Clock(int Fs, double transport_sec)
+{
+    m_Fs = Fs;
+    m_transport = transport_sec;
+    m_clock_second = -1;
+}
+
+// The last of `samples` samples was read at `arrival`
+void CueEngine::sync(long long samples, double arrival)
+{
+    if (m_Fs <= 0 || samples <= 0) return;
+
+    long long second = (samples - 1) / m_Fs;
+    double offset = arrival - (double) (samples - 1) / m_Fs;
+
+    if (second != m_clock_second) {
+        for (long long s = m_clock_second + 1; s <= second && s <= m_clock_second + 10; s++)
+            m_clock_ring[s % 10] = HUGE_VAL;
+        if (m_clock_second < 0 || second - m_clock_second >= 10)
+            for (int i = 0; i < 10; i++) m_clock_ring[i] = HUGE_VAL;
+        m_clock_second = second;
+    }
+
+    double &entry = m_clock_ring[second % 10];
+    if (offset < entry) entry = offset;
+
+    double earliest = HUGE_VAL;
+    for (int i = 0; i < 10; i++)
+        if (m_clock_ring[i] < earliest) earliest = m_clock_ring[i];
+
+    m_clock_offset = earliest - m_transport;
+}
+
+// When an EEG sample was taken on now()'s clock, -1 without a sample clock
+double CueEngine::sample_Time(double sample) const
+{
+    return (m_clock_second < 0) ? -1 : m_clock_offset + sample / m_Fs;
+}
+
+double CueEngine::time_Sample(double time) const
+{
+    return (m_clock_second < 0) ? -1 : (time - m_clock_offset) * m_Fs;
+}
+
+int CueEngine::play(int cue)
+{
+    return schedule(cue, now());
+}
+
+// The request #, -1 for an unknown cue or when all requests are taken
+int CueEngine::schedule(int cue, double time)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (cue < 0 || cue >= (int) m_cues.size()) return -1;
+
+    for (int i = 0; i < CUE_REQUESTS; i++) {
+        if (m_requests[i].id >= 0) continue;
+
+        m_requests[i].id = m_next_request;
+        m_requests[i].cue = cue;
+        m_requests[i].time = time;
+        m_next_request = (m_next_request + 1) & 0x7fffffff;
+        return m_requests[i].id;
+    }
+
+    return -1;
+}
+
+int CueEngine::schedule_Sample(int cue, double sample)
+{
+    if (m_clock_second < 0) return -1;
+
+    return schedule(cue, sample_Time(sample));
+}
+
+// -1 once the cue has started (or was never requested)
+int CueEngine::cancel(int request)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    for (int i = 0; i < CUE_REQUESTS; i++) {
+        if (m_requests[i].id == request && request >= 0) {
+            m_requests[i].id = -1;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int CueEngine::onset(CueOnset &result)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (!m_onset_count) return 0;
+
+        result = m_onsets[m_onset_head];
+        m_onset_head = (m_onset_head + 1) % CUE_ONSETS;
+        m_onset_count--;
+    }
+
+    result.sample = time_Sample(result.time);
+    return 1;
+}
+
+void CueEngine::run()
+{
+    while (m_running) {
+        double start = period_Time();
+        if (!m_running) break;
+
+        mix_Period(start);
+        if (write_Period()) break;
+
+        m_frames += m_period_frames;
+    }
+}
+
+// When the first frame of the next period leaves the DAC, once there is room for it
+double CueEngine::period_Time()
+{
+#ifdef OPENLD_ALSA
+    if (m_pcm) {
+        snd_pcm_t *pcm = (snd_pcm_t *) m_pcm;
+        snd_pcm_sframes_t avail;
+
+        while (m_running && (avail = snd_pcm_avail_update(pcm)) < m_period_frames) {
+            if (avail < 0) snd_pcm_recover(pcm, (int) avail, 1);
+            else snd_pcm_wait(pcm, 100);
+        }
+
+        snd_pcm_sframes_t delay;
+        if (snd_pcm_delay(pcm, &delay) < 0) delay = 0;
+
+        return now() + (double) delay / m_rate;
+    }
+#endif
+
+#ifdef OPENLD_WINMM
+    if (m_wave) {
+        WaveOut *wave = (WaveOut *) m_wave;
+        while (m_running && (wave->headers[wave->next].dwFlags & WHDR_INQUEUE))
+            WaitForSingleObject(wave->event, 100);
+
+        // Frames written less frames played, the position wraps at 32 bits like the difference
+        MMTIME position;
+        position.wType = TIME_SAMPLES;
+        DWORD delay = 0;
+        if (waveOutGetPosition(wave->device, &position, sizeof(position)) == MMSYSERR_NOERROR &&
+                position.wType == TIME_SAMPLES)
+            delay = (DWORD) m_frames - position.u.sample;
+        if (delay > (DWORD) m_buffer_frames) delay = 0;
+
+        return now() + (double) delay / m_rate;
+    }
+#endif
+
+    // Paced like a device playing from a buffer of m_buffer_frames
+    double start = m_stream_start + (double) m_frames / m_rate;
+    double late = now() - start;
+
+    if (late > 0) {
+        // Behind, restart the stream from now as a device would after an underrun
+        m_stream_start += late;
+        start += late;
+    } else if (-late > latency()) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(-late - latency()));
+    }
+
+    return start;
+}
+
+// Starts every request due in this period on its frame and mixes the voices
+void CueEngine::mix_Period(double start)
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    double end = start + (double) m_period_frames / m_rate;
+
+    for (int r = 0; r < CUE_REQUESTS; r++) {
+        Request &request = m_requests[r];
+        if (request.id < 0 || request.time >= end) continue;
+
+        int voice = -1;
+        for (int v = 0; v < CUE_VOICES && voice < 0; v++)
+            if (m_voices[v].cue < 0) voice = v;
+        if (voice < 0) continue; // Waits for a voice to end
+
+        long offset = 0;
+        if (request.time > start) offset = (long) floor((request.time - start) * m_rate + 0.5);
+        if (offset >= m_period_frames) offset = m_period_frames - 1;
+
+        m_voices[voice].cue = request.cue;
+        m_voices[voice].position = -offset;
+
+        if (m_onset_count < CUE_ONSETS) {
+            CueOnset &onset = m_onsets[(m_onset_head + m_onset_count++) % CUE_ONSETS];
+            onset.cue = request.cue;
+            onset.request = request.id;
+            onset.time = start + (double) offset / m_rate;
+            onset.sample = -1;
+        }
+        request.id = -1;
+    }
+
+    for (int i = 0; i < m_period_frames; i++) m_mix[i] = 0;
+
+    for (int v = 0; v < CUE_VOICES; v++) {
+        Voice &voice = m_voices[v];
+        if (voice.cue < 0) continue;
+
+        const std::vector<short> &cue = m_cues[voice.cue];
+        long length = (long) cue.size();
+
+        for (int i = 0; i < m_period_frames; i++, voice.position++)
+            if (voice.position >= 0 && voice.position < length) m_mix[i] += cue[voice.position];
+
+        if (voice.position >= length) voice.cue = -1;
+    }
+
+    for (int i = 0; i < m_period_frames; i++) {
+        int value = m_mix[i] > 32767 ? 32767 : (m_mix[i] < -32768 ? -32768 : m_mix[i]);
+        for (int c = 0; c < m_channels; c++) m_period[i * m_channels + c] = (short) value;
+    }
+}
+
+int CueEngine::write_Period()
+{
+#ifdef OPENLD_ALSA
+    if (m_pcm) {
+        snd_pcm_t *pcm = (snd_pcm_t *) m_pcm;
+        const short *data = &m_period[0];
+        snd_pcm_sframes_t left = m_period_frames;
+
+        while (left > 0) {
+            snd_pcm_sframes_t written = snd_pcm_writei(pcm, data, left);
+            if (written < 0) {
+                if (snd_pcm_recover(pcm, (int) written, 1) < 0) return -1;
+                continue;
+            }
+            data += written * m_channels;
+            left -= written;
+        }
+        return 0;
+    }
+#endif
+
+#ifdef OPENLD_WINMM
+    if (m_wave) {
+        WaveOut *wave = (WaveOut *) m_wave;
+        WAVEHDR &header = wave->headers[wave->next];
+
+        memcpy(header.lpData, &m_period[0], m_period.size() * sizeof(short));
+        if (waveOutWrite(wave->device, &header, sizeof(header)) != MMSYSERR_NOERROR) return -1;
+        wave->next = (wave->next + 1) % CUE_PERIOD_DIVISIONS;
+        return 0;
+    }
+#endif
+
+    // Past the most a WAV file holds, it keeps the start and the sink only paces
+    if (m_file && (m_file_frames + m_period_frames) * m_channels * 2 <= CUE_WAV_MAX_BYTES) {
+        for (size_t i = 0; i < m_period.size(); i++) put_LE(m_file, (unsigned short) m_period[i], 2);
+        m_file_frames += m_period_frames;
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+
+#ifndef CUEENGINE_H
+#define CUEENGINE_H
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* LOW-LATENCY AUDIO CUES, SCHEDULED ON THE EEG SAMPLE CLOCK
+ *
+ * Plays short sound cues (alarms, closed-loop stimuli) with a known onset:
+ *   - Cues are WAV files (8/16/24/32 bit PCM or 32 bit float, any rate and channel
+ *     count), decoded, mixed down to mono and resampled to the output rate once at
+ *     load(), so starting one is a copy from memory.
+ *   - An output thread mixes up to CUE_VOICES cues into periods of a few
+ *     milliseconds and writes them to the sink:
+ *       CUE_SINK_ALSA  an ALSA device (e.g. "default", "hw:0,0"), buffer of about
+ *                      the latency given to open(); only when built with OPENLD_ALSA
+ *       CUE_SINK_WINMM a Windows waveOut device ("default" or its # from 0), buffer
+ *                      of the latency but at least 40 ms, which WinMM needs to play
+ *                      without gaps; only when built with OPENLD_WINMM
+ *       CUE_SINK_NULL  nothing, paced in real time like a device
+ *       CUE_SINK_FILE  a 16 bit WAV file at the path given, paced in real time, so
+ *                      headless runs can check where the cues ended up. It stops
+ *                      growing at CUE_WAV_MAX_BYTES, 6.2 h at 48000 hz stereo but
+ *                      74 h at 8000 hz mono
+ *   - Just before a period is mixed, the time its first frame leaves the DAC is
+ *     known from the frames still queued in front of it (snd_pcm_delay, or the
+ *     frames written less waveOutGetPosition), so a cue scheduled for a given time
+ *     starts on the frame closest to it. That time is its onset, reported back with
+ *     onset(); a cue scheduled too late starts on the first frame still free and
+ *     reports when that was. WinMM's position is where the Windows mixer is, so
+ *     the mixer's own latency after it is part of the output latency to measure.
+ *   - Times are seconds on now()'s monotonic clock. The EEG sample clock is tied to
+ *     it by sync(): the samples received so far and when they were read. The earliest
+ *     (arrival - sample time) of the last 10 s, less the transport latency, is when
+ *     sample 0 was taken, so cues can be scheduled on, and onsets reported as, EEG
+ *     samples.
+ *
+ * HOW TO USE
+    1. Initialize object and open a sink, -1 on error (see error()):
+        CueEngine.open(CueEngine::default_Sink(), "default", output rate, output channels, latency s);
+    2. Load the cues, the cue # or -1 on error:
+        cue = CueEngine.load("cue.wav");
+    3. (Optional) Tie the EEG sample clock in, with the transport latency (s):
+        CueEngine.set_Sample_Clock(Sampling Frequency, latency);
+        and after every burst of samples: CueEngine.sync(samples so far, CueEngine.now() when read);
+    4. Start a cue, the request # or -1 if all CUE_REQUESTS are taken:
+        CueEngine.play(cue);                           // as soon as possible
+        CueEngine.schedule(cue, time);                 // at now() time
+        CueEngine.schedule_Sample(cue, EEG sample);    // in step with an EEG sample
+        CueEngine.cancel(request) RETURNS -1 when it has already started
+    5. WHILE CueEngine.onset(result) RETURNS 1: result holds a cue that started
+    6. CueEngine.close() (or delete it)
+ *
+ */
+
+enum { CUE_SINK_NULL, CUE_SINK_FILE, CUE_SINK_ALSA, CUE_SINK_WINMM };
+
+const int CUE_VOICES = 4;     // Cues sounding at once
+const int CUE_REQUESTS = 8;   // Cues waiting to start
+const int CUE_ONSETS = 16;    // Onsets waiting for onset()
+const long long CUE_WAV_MAX_BYTES = 0xFFFFFFFFLL - 36; // Audio a WAV file's 32 bit sizes hold
+
+struct CueOnset {
+    int cue;
+    int request;
+    double time;        // s on now()'s clock, first frame leaving the DAC
+    double sample;      // EEG sample at that time, -1 without a sample clock
+};
+
+class CueEngine
+{
+public:
+    CueEngine();
+    ~CueEngine();
+
+    // The device sink this was built with, CUE_SINK_NULL without one
+    static int default_Sink();
+
+    int open(int sink, const std::string &device, int rate, int channels, double latency_sec);
+    void close();
+    int load(const std::string &path);
+
+    double now() const;
+
+    void set_Sample_Clock(int Fs, double transport_sec);
+    void sync(long long samples, double arrival);
+    double sample_Time(double sample) const;
+    double time_Sample(double time) const;
+
+    int play(int cue);
+    int schedule(int cue, double time);
+    int schedule_Sample(int cue, double sample);
+    int cancel(int request);
+    int onset(CueOnset &result);
+
+    int rate() const { return m_rate; }
+    double latency() const { return (double) m_buffer_frames / m_rate; }
+    const std::string &error() const { return m_error; }
+
+private:
+    CueEngine(const CueEngine &);
+    CueEngine &operator=(const CueEngine &);
+
+    void run();
+    double period_Time();
+    int write_Period();
+    void mix_Period(double start);
+
+    int m_sink;
+    int m_rate, m_channels;
+    int m_period_frames, m_buffer_frames;
+    std::string m_error;
+
+    // Decoded cues, mono at the output rate
+    std::vector<std::vector<short> > m_cues;
+
+    struct Request {
+        int id;         // -1 when free
+        int cue;
+        double time;
+    };
+
+    struct Voice {
+        int cue;        // -1 when silent
+        long position;  // Frame of the cue, negative until it starts
+    };
+
+    // Shared with the output thread
+    std::mutex m_lock;
+    Request m_requests[CUE_REQUESTS];
+    CueOnset m_onsets[CUE_ONSETS];
+    int m_onset_head, m_onset_count;
+    int m_next_request;
+
+    // Output thread only, the cues while holding m_lock
+    Voice m_voices[CUE_VOICES];
+    std::vector<int> m_mix;
+    std::vector<short> m_period;
+    long long m_frames;
+
+    std::thread m_thread;
+    std::atomic<int> m_running;
+    std::chrono::steady_clock::time_point m_epoch;
+    double m_stream_start;
+
+    // Sink handles
+    void *m_pcm;
+    void *m_wave;   // WinMM device, its buffers and their event
+    FILE *m_file;
+    long long m_file_frames;
+
+    // EEG sample clock: earliest (arrival - sample time) of each of the last seconds
+    int m_Fs;
+    double m_transport;
+    double m_clock_ring[10];
+    long long m_clock_second;
+    double m_clock_offset;
+
+};
+
+#endif // CUEENGINE_H
@@ -39,8 +39,43 @@
 #include "edflib.h"
 
 
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+typedef SRWLOCK edflib_mutex_t;
+typedef HANDLE  edflib_thread_t;
+
+#define EDFLIB_MUTEX_INIT(m)     InitializeSRWLock(m)
+#define EDFLIB_MUTEX_DESTROY(m)
+#define EDFLIB_MUTEX_LOCK(m)     AcquireSRWLockExclusive(m)
+#define EDFLIB_MUTEX_UNLOCK(m)   ReleaseSRWLockExclusive(m)
+
+#else
+
+#include <pthread.h>
+
+typedef pthread_mutex_t edflib_mutex_t;
+typedef pthread_t       edflib_thread_t;
+
+#define EDFLIB_MUTEX_INIT(m)     pthread_mutex_init(m, NULL)
+#define EDFLIB_MUTEX_DESTROY(m)  pthread_mutex_destroy(m)
+#define EDFLIB_MUTEX_LOCK(m)     pthread_mutex_lock(m)
+#define EDFLIB_MUTEX_UNLOCK(m)   pthread_mutex_unlock(m)
+
+#endif
+
+
 #define EDFLIB_VERSION 110
-#define EDFLIB_MAXFILES 64
+
+/* initial size of the handle table, it grows (doubles) on demand */
+#define EDFLIB_HDRLIST_INITIAL_SIZE 64
 
 
 #if defined(__APPLE__) || defined(__MACH__) || defined(__APPLE_CC__)
@@ -81,6 +116,9 @@
 /* bytes in datarecord for EDF annotations, must be a multiple of three and two */
 #define EDFLIB_ANNOTATION_BYTES 114
 
+/* number of datarecords scanned per step by the lazy and background annotation scanners */
+#define EDFLIB_ANNOT_SCAN_CHUNK 1024
+
 
 
 struct edfparamblock{
@@ -145,17 +183,44 @@ struct edfhdrblock{
         long long annots_in_file;
         int       total_annot_bytes;
         int       eq_sf;
+        int       flush_interval;
         struct edfparamblock *edfparam;
+        struct edf_annotationblock *annotationslist;
+        struct edf_annotationblock *annotationslist_tail;
+        struct edf_annotationblock *annot_cursor;
+        long long annot_cursor_n;
+        int       annot_read_mode;
+        long long annot_scan_record;
+        long long annot_scan_elapsedtime;
+        int       annot_scan_done;
+        int       annot_scan_error;
+        int       annot_scan_stop;
+        int       annot_thread_running;
+        edflib_thread_t annot_thread;
+        FILE      *annot_file_hdl;
+        edflib_mutex_t annot_lock;
+        struct edf_segmentblock *segments;
+        int       nr_segments;
+        int       segments_allocated;
+        struct edf_write_annotationblock *write_annotationslist;
+        struct edf_write_annotationblock *write_annotationslist_tail;
       };
 
 
+/* one entry per contiguous run of datarecords in a discontinuous file */
+struct edf_segmentblock{
+        long long datarecord;
+        long long onset;
+       };
+
+
 struct edf_annotationblock{
         long long onset;
         char duration[16];
         char annotation[EDFLIB_MAX_ANNOTATION_LEN + 1];
         struct edf_annotationblock *former_annotation;
         struct edf_annotationblock *next_annotation;
-       } *annotationslist[EDFLIB_MAXFILES];
+       };
 
 
 struct edf_write_annotationblock{
@@ -164,19 +229,46 @@ struct edf_write_annotationblock{
         char annotation[EDFLIB_WRITE_MAX_ANNOTATION_LEN + 1];
         struct edf_write_annotationblock *former_annotation;
         struct edf_write_annotationblock *next_annotation;
-       } *write_annotationslist[EDFLIB_MAXFILES];
+       };
+
 
+/* The handle table. All per-file state (including the annotation lists) lives in the */
+/* edfhdrblock of that handle, so the only shared state is this table and its counters. */
+/* Lookups take the lock shared, open and close take it exclusive. The lock is never */
+/* held during file I/O, so readers working on different handles never block each other. */
 
 static int files_open=0;
 
-static struct edfhdrblock *hdrlist[EDFLIB_MAXFILES];
+static int hdrlist_size=0;
+
+static struct edfhdrblock **hdrlist=NULL;
+
+#ifdef _WIN32
+
+static SRWLOCK hdrlist_lock = SRWLOCK_INIT;
+
+#define EDFLIB_HDRLIST_LOCK_SHARED()      AcquireSRWLockShared(&hdrlist_lock)
+#define EDFLIB_HDRLIST_UNLOCK_SHARED()    ReleaseSRWLockShared(&hdrlist_lock)
+#define EDFLIB_HDRLIST_LOCK_EXCLUSIVE()   AcquireSRWLockExclusive(&hdrlist_lock)
+#define EDFLIB_HDRLIST_UNLOCK_EXCLUSIVE() ReleaseSRWLockExclusive(&hdrlist_lock)
+
+#else
+
+static pthread_rwlock_t hdrlist_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+#define EDFLIB_HDRLIST_LOCK_SHARED()      pthread_rwlock_rdlock(&hdrlist_lock)
+#define EDFLIB_HDRLIST_UNLOCK_SHARED()    pthread_rwlock_unlock(&hdrlist_lock)
+#define EDFLIB_HDRLIST_LOCK_EXCLUSIVE()   pthread_rwlock_wrlock(&hdrlist_lock)
+#define EDFLIB_HDRLIST_UNLOCK_EXCLUSIVE() pthread_rwlock_unlock(&hdrlist_lock)
+
+#endif
 
 
 struct edfhdrblock * edflib_check_edf_file(FILE *, int *);
 int edflib_is_integer_number(char *);
 int edflib_is_number(char *);
 long long edflib_get_long_duration(char *);
-int edflib_get_annotations(struct edfhdrblock *, int, int);
+int edflib_get_annotations(struct edfhdrblock *, FILE *, long long);
 int edflib_is_duration_number(char *);
 int edflib_is_onset_number(char *);
 long long edflib_get_long_time(char *);
@@ -191,16 +283,287 @@ int edflib_sprint_int_number_nonlocalized(char *, int, int, int);
 int edflib_sprint_ll_number_nonlocalized(char *, long long, int, int);
 int edflib_fprint_int_number_nonlocalized(FILE *, int, int, int);
 int edflib_fprint_ll_number_nonlocalized(FILE *, long long, int, int);
+static struct edfhdrblock * edflib_get_hdr(int);
+static int edflib_alloc_handle(struct edfhdrblock *, const char *);
+static void edflib_release_handle(int);
+static void edflib_free_annotations(struct edfhdrblock *);
+static void edflib_free_annotation_chain(struct edf_annotationblock *);
+static int edflib_start_annotation_thread(struct edfhdrblock *);
+static int edflib_add_segment(struct edfhdrblock *, long long, long long);
+static long long edflib_time_to_sample(struct edfhdrblock *, int, long long);
+static void edflib_stop_annotation_thread(struct edfhdrblock *);
+
+
+
+
+
+static struct edfhdrblock * edflib_get_hdr(int handle)
+{
+  struct edfhdrblock *hdr=NULL;
+
+
+  if(handle<0)
+  {
+    return(NULL);
+  }
+
+  EDFLIB_HDRLIST_LOCK_SHARED();
+
+  if(handle<hdrlist_size)
+  {
+    hdr = hdrlist[handle];
+  }
+
+  EDFLIB_HDRLIST_UNLOCK_SHARED();
+
+  return(hdr);
+}
+
+
+/* registers hdr under path and returns its handle, or a negative errorcode */
+/* the check for an already opened path and the insert are one atomic step */
+static int edflib_alloc_handle(struct edfhdrblock *hdr, const char *path)
+{
+  int i, handle=-1,
+      new_size;
 
+  struct edfhdrblock **new_list;
 
 
+  EDFLIB_HDRLIST_LOCK_EXCLUSIVE();
+
+  for(i=0; i<hdrlist_size; i++)
+  {
+    if(hdrlist[i]==NULL)
+    {
+      if(handle<0)
+      {
+        handle = i;
+      }
+    }
+    else if(!(strcmp(path, hdrlist[i]->path)))
+    {
+      EDFLIB_HDRLIST_UNLOCK_EXCLUSIVE();
+
+      return(EDFLIB_FILE_ALREADY_OPENED);
+    }
+  }
+
+  if(handle<0)
+  {
+    if(hdrlist_size)
+    {
+      new_size = hdrlist_size * 2;
+    }
+    else
+    {
+      new_size = EDFLIB_HDRLIST_INITIAL_SIZE;
+    }
+
+    new_list = (struct edfhdrblock **)realloc(hdrlist, sizeof(struct edfhdrblock *) * new_size);
+    if(new_list==NULL)
+    {
+      EDFLIB_HDRLIST_UNLOCK_EXCLUSIVE();
+
+      return(EDFLIB_MALLOC_ERROR);
+    }
+
+    for(i=hdrlist_size; i<new_size; i++)
+    {
+      new_list[i] = NULL;
+    }
+
+    handle = hdrlist_size;
+
+    hdrlist = new_list;
+
+    hdrlist_size = new_size;
+  }
+
+  strcpy(hdr->path, path);
+
+  hdrlist[handle] = hdr;
+
+  files_open++;
+
+  EDFLIB_HDRLIST_UNLOCK_EXCLUSIVE();
+
+  return(handle);
+}
+
+
+static void edflib_release_handle(int handle)
+{
+  EDFLIB_HDRLIST_LOCK_EXCLUSIVE();
+
+  if((handle>=0)&&(handle<hdrlist_size)&&(hdrlist[handle]!=NULL))
+  {
+    hdrlist[handle] = NULL;
+
+    files_open--;
+  }
+
+  EDFLIB_HDRLIST_UNLOCK_EXCLUSIVE();
+}
+
+
+static void edflib_free_annotation_chain(struct edf_annotationblock *annot)
+{
+  struct edf_annotationblock *next;
+
+
+  while(annot)
+  {
+    next = annot->next_annotation;
+
+    free(annot);
+
+    annot = next;
+  }
+}
+
+
+static void edflib_free_annotations(struct edfhdrblock *hdr)
+{
+  struct edf_write_annotationblock *annot2;
+
+
+  edflib_free_annotation_chain(hdr->annotationslist);
+
+  hdr->annotationslist = NULL;
+  hdr->annotationslist_tail = NULL;
+  hdr->annot_cursor = NULL;
+  hdr->annot_cursor_n = 0LL;
+
+  if(hdr->write_annotationslist!=NULL)
+  {
+    annot2 = hdr->write_annotationslist;
+
+    while(annot2->next_annotation)
+    {
+      annot2 = annot2->next_annotation;
+
+      free(annot2->former_annotation);
+    }
+
+    free(annot2);
+
+    hdr->write_annotationslist = NULL;
+    hdr->write_annotationslist_tail = NULL;
+  }
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI edflib_annotation_thread(LPVOID arg)
+#else
+static void * edflib_annotation_thread(void *arg)
+#endif
+{
+  int stop;
+
+  struct edfhdrblock *hdr;
+
+
+  hdr = (struct edfhdrblock *)arg;
+
+  while(1)
+  {
+    EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+    stop = hdr->annot_scan_stop || hdr->annot_scan_done;
+
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+    if(stop)
+    {
+      break;
+    }
+
+    if(edflib_get_annotations(hdr, hdr->annot_file_hdl, EDFLIB_ANNOT_SCAN_CHUNK))
+    {
+      EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+      hdr->annot_scan_error = 1;
+
+      hdr->annot_scan_done = 1;
+
+      EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+      break;
+    }
+  }
+
+  return(0);
+}
+
+
+/* starts scanning the remaining datarecords in a thread with its own file pointer */
+/* returns 0 on success, -1 if the thread could not be started (the caller then scans on demand) */
+static int edflib_start_annotation_thread(struct edfhdrblock *hdr)
+{
+  hdr->annot_file_hdl = fopeno(hdr->path, "rb");
+  if(hdr->annot_file_hdl==NULL)
+  {
+    return(-1);
+  }
+
+#ifdef _WIN32
+  hdr->annot_thread = CreateThread(NULL, 0, edflib_annotation_thread, hdr, 0, NULL);
+  if(hdr->annot_thread==NULL)
+#else
+  if(pthread_create(&hdr->annot_thread, NULL, edflib_annotation_thread, hdr))
+#endif
+  {
+    fclose(hdr->annot_file_hdl);
+
+    hdr->annot_file_hdl = NULL;
+
+    return(-1);
+  }
+
+  hdr->annot_thread_running = 1;
+
+  return(0);
+}
+
+
+static void edflib_stop_annotation_thread(struct edfhdrblock *hdr)
+{
+  if(!(hdr->annot_thread_running))
+  {
+    return;
+  }
+
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+  hdr->annot_scan_stop = 1;
+
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+#ifdef _WIN32
+  WaitForSingleObject(hdr->annot_thread, INFINITE);
+  CloseHandle(hdr->annot_thread);
+#else
+  pthread_join(hdr->annot_thread, NULL);
+#endif
+
+  fclose(hdr->annot_file_hdl);
+
+  hdr->annot_file_hdl = NULL;
+
+  hdr->annot_thread_running = 0;
+}
 
 
 int edflib_is_file_used(const char *path)
 {
   int i, file_used=0;
 
-  for(i=0; i<EDFLIB_MAXFILES; i++)
+
+  EDFLIB_HDRLIST_LOCK_SHARED();
+
+  for(i=0; i<hdrlist_size; i++)
   {
     if(hdrlist[i]!=NULL)
     {
@@ -213,32 +576,51 @@ int edflib_is_file_used(const char *path)
     }
   }
 
+  EDFLIB_HDRLIST_UNLOCK_SHARED();
+
   return(file_used);
 }
 
 
 int edflib_get_number_of_open_files()
 {
-  return(files_open);
+  int n;
+
+
+  EDFLIB_HDRLIST_LOCK_SHARED();
+
+  n = files_open;
+
+  EDFLIB_HDRLIST_UNLOCK_SHARED();
+
+  return(n);
 }
 
 
 int edflib_get_handle(int file_number)
 {
-  int i, file_count=0;
+  int i, file_count=0,
+      handle=-1;
+
 
-  for(i=0; i<EDFLIB_MAXFILES; i++)
+  EDFLIB_HDRLIST_LOCK_SHARED();
+
+  for(i=0; i<hdrlist_size; i++)
   {
     if(hdrlist[i]!=NULL)
     {
       if(file_count++ == file_number)
       {
-        return(i);
+        handle = i;
+
+        break;
       }
     }
   }
 
-  return(-1);
+  EDFLIB_HDRLIST_UNLOCK_SHARED();
+
+  return(handle);
 }
 
 
@@ -246,14 +628,13 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
 {
   int i, j,
       channel,
+      handle,
       edf_error;
 
   FILE *file;
 
   struct edfhdrblock *hdr;
 
-  struct edf_annotationblock *annot;
-
 
   if(read_annotations<0)
   {
@@ -262,7 +643,7 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
     return(-1);
   }
 
-  if(read_annotations>2)
+  if(read_annotations>EDFLIB_READ_ANNOTATIONS_BACKGROUND)
   {
     edfhdr->filetype = EDFLIB_INVALID_READ_ANNOTS_VALUE;
 
@@ -271,26 +652,13 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
 
   memset(edfhdr, 0, sizeof(struct edf_hdr_struct));
 
-  if(files_open>=EDFLIB_MAXFILES)
+  if(edflib_is_file_used(path))
   {
-    edfhdr->filetype = EDFLIB_MAXFILES_REACHED;
+    edfhdr->filetype = EDFLIB_FILE_ALREADY_OPENED;
 
     return(-1);
   }
 
-  for(i=0; i<EDFLIB_MAXFILES; i++)
-  {
-    if(hdrlist[i]!=NULL)
-    {
-      if(!(strcmp(path, hdrlist[i]->path)))
-      {
-        edfhdr->filetype = EDFLIB_FILE_ALREADY_OPENED;
-
-        return(-1);
-      }
-    }
-  }
-
   file = fopeno(path, "rb");
   if(file==NULL)
   {
@@ -309,32 +677,17 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
     return(-1);
   }
 
-  if(hdr->discontinuous)
-  {
-    edfhdr->filetype = EDFLIB_FILE_IS_DISCONTINUOUS;
-
-    free(hdr->edfparam);
-    free(hdr);
-
-    fclose(file);
-
-    return(-1);
-  }
-
   hdr->writemode = 0;
 
-  for(i=0; i<EDFLIB_MAXFILES; i++)
+  /* the onsets of the datarecords of a discontinuous file are only known after scanning */
+  /* the timekeeping TAL's, so at least scan them on demand */
+  if((hdr->discontinuous)&&(read_annotations==EDFLIB_DO_NOT_READ_ANNOTATIONS))
   {
-    if(hdrlist[i]==NULL)
-    {
-      hdrlist[i] = hdr;
-
-      edfhdr->handle = i;
-
-      break;
-    }
+    read_annotations = EDFLIB_READ_ANNOTATIONS_LAZY;
   }
 
+  EDFLIB_MUTEX_INIT(&hdr->annot_lock);
+
   if((hdr->edf)&&(!(hdr->edfplus)))
   {
     edfhdr->filetype = EDFLIB_FILETYPE_EDF;
@@ -363,9 +716,9 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
   edfhdr->starttime_hour = hdr->starttime_hour;
   edfhdr->starttime_second = hdr->starttime_second;
   edfhdr->starttime_minute = hdr->starttime_minute;
-  edfhdr->starttime_subsecond = hdr->starttime_offset;
   edfhdr->datarecords_in_file = hdr->datarecords;
   edfhdr->datarecord_duration = hdr->long_data_record_duration;
+  edfhdr->discontinuous = hdr->discontinuous;
 
   if((!(hdr->edfplus))&&(!(hdr->bdfplus)))
   {
@@ -395,30 +748,30 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
     strcpy(edfhdr->equipment, hdr->plus_equipment);
     strcpy(edfhdr->recording_additional, hdr->plus_recording_additional);
 
-    annotationslist[edfhdr->handle] = NULL;
-
-    if((read_annotations==EDFLIB_READ_ANNOTATIONS)||(read_annotations==EDFLIB_READ_ALL_ANNOTATIONS))
+    if(read_annotations!=EDFLIB_DO_NOT_READ_ANNOTATIONS)
     {
-      if(edflib_get_annotations(hdr, edfhdr->handle, read_annotations))
-      {
-        edfhdr->filetype = EDFLIB_FILE_CONTAINS_FORMAT_ERRORS;
-
-        if(annotationslist[edfhdr->handle])
-        {
-          annot = annotationslist[edfhdr->handle];
+      hdr->annot_read_mode = read_annotations;
 
-          while(annot->next_annotation)
-          {
-            annot = annot->next_annotation;
+      /* the lazy modes only scan the first datarecord now, it holds the subsecond starttime */
+      if((read_annotations==EDFLIB_READ_ANNOTATIONS_LAZY)||(read_annotations==EDFLIB_READ_ANNOTATIONS_BACKGROUND))
+      {
+        edf_error = edflib_get_annotations(hdr, file, 1LL);
+      }
+      else
+      {
+        edf_error = edflib_get_annotations(hdr, file, -1LL);
+      }
 
-            free(annot->former_annotation);
-          }
+      if(edf_error)
+      {
+        edfhdr->filetype = EDFLIB_FILE_CONTAINS_FORMAT_ERRORS;
 
-          free(annot);
-        }
+        edflib_free_annotations(hdr);
 
         fclose(file);
 
+        EDFLIB_MUTEX_DESTROY(&hdr->annot_lock);
+        free(hdr->segments);
         free(hdr->edfparam);
         free(hdr);
 
@@ -427,25 +780,38 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
     }
   }
 
-  if(annotationslist[edfhdr->handle])
+  if(hdr->annot_read_mode==EDFLIB_DO_NOT_READ_ANNOTATIONS)
   {
-    hdr->annots_in_file++;
+    hdr->annot_scan_done = 1;
+  }
 
-    annot = annotationslist[edfhdr->handle];
+  edfhdr->starttime_subsecond = hdr->starttime_offset;
 
-    while(annot->next_annotation)
-    {
-      hdr->annots_in_file++;
+  edfhdr->annotations_in_file = hdr->annots_in_file;
 
-      annot = annot->next_annotation;
-    }
-  }
+  handle = edflib_alloc_handle(hdr, path);
+  if(handle<0)
+  {
+    edfhdr->filetype = handle;
 
-  edfhdr->annotations_in_file = hdr->annots_in_file;
+    edflib_free_annotations(hdr);
 
-  strcpy(hdr->path, path);
+    fclose(file);
 
-  files_open++;
+    EDFLIB_MUTEX_DESTROY(&hdr->annot_lock);
+    free(hdr->segments);
+    free(hdr->edfparam);
+    free(hdr);
+
+    return(-1);
+  }
+
+  edfhdr->handle = handle;
+
+  if((hdr->annot_read_mode==EDFLIB_READ_ANNOTATIONS_BACKGROUND)&&(!(hdr->annot_scan_done)))
+  {
+    edflib_start_annotation_thread(hdr);
+  }
 
   j = 0;
 
@@ -479,8 +845,6 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
 
 int edfclose_file(int handle)
 {
-  struct edf_annotationblock *annot;
-
   struct edf_write_annotationblock *annot2;
 
   int i, j, n, p,
@@ -495,23 +859,12 @@ int edfclose_file(int handle)
   struct edfhdrblock *hdr;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   if(hdr->writemode)
   {
     if(hdr->datarecords == 0LL)
@@ -521,7 +874,7 @@ int edfclose_file(int handle)
         return(-1);
       }
 
-      annot2 = write_annotationslist[handle];
+      annot2 = hdr->write_annotationslist;
 
       while(annot2)
       {
@@ -557,7 +910,7 @@ int edfclose_file(int handle)
       }
     }
 
-    annot2 = write_annotationslist[handle];
+    annot2 = hdr->write_annotationslist;
 
     datarecords = 0LL;
 
@@ -672,213 +1025,563 @@ int edfclose_file(int handle)
 
     fclose(hdr->file_hdl);
 
-    if(write_annotationslist[handle]!=NULL)
-    {
-      annot2 = write_annotationslist[handle];
+    edflib_free_annotations(hdr);
 
-      while(annot2->next_annotation)
-      {
-        annot2 = annot2->next_annotation;
+    free(hdr->edfparam);
 
-        free(annot2->former_annotation);
-      }
+    edflib_release_handle(handle);
 
-      free(annot2);
-    }
+    free(hdr);
+
+    return(0);
+  }
+  else
+  {
+    edflib_stop_annotation_thread(hdr);
+
+    edflib_free_annotations(hdr);
+
+    fclose(hdr->file_hdl);
+
+    EDFLIB_MUTEX_DESTROY(&hdr->annot_lock);
+
+    free(hdr->segments);
 
     free(hdr->edfparam);
 
+    edflib_release_handle(handle);
+
     free(hdr);
 
-    hdrlist[handle] = NULL;
+    return(0);
+  }
 
-    files_open--;
+  return(-1); /* we never reach this line */
+}
 
-    return(0);
+
+long long edfseek(int handle, int edfsignal, long long offset, int whence)
+{
+  struct edfhdrblock *hdr;
+
+  long long smp_in_file;
+
+  int channel;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
+  {
+    return(-1);
   }
-  else
+
+  if(edfsignal<0)
   {
-    if(annotationslist[handle]!=NULL)
-    {
-      annot = annotationslist[handle];
+    return(-1);
+  }
+
+  if(hdr->writemode)
+  {
+    return(-1);
+  }
+
+  if(edfsignal>=(hdr->edfsignals - hdr->nr_annot_chns))
+  {
+    return(-1);
+  }
+
+  channel = hdr->mapped_signals[edfsignal];
+
+  smp_in_file = hdr->edfparam[channel].smp_per_record * hdr->datarecords;
+
+  if(whence==EDFSEEK_SET)
+  {
+    hdr->edfparam[channel].sample_pntr = offset;
+  }
+
+  if(whence==EDFSEEK_CUR)
+  {
+    hdr->edfparam[channel].sample_pntr += offset;
+  }
+
+  if(whence==EDFSEEK_END)
+  {
+    hdr->edfparam[channel].sample_pntr =
+      (hdr->edfparam[channel].smp_per_record * hdr->datarecords) + offset;
+  }
+
+  if(hdr->edfparam[channel].sample_pntr > smp_in_file)
+  {
+    hdr->edfparam[channel].sample_pntr = smp_in_file;
+  }
+
+  if(hdr->edfparam[channel].sample_pntr < 0LL)
+  {
+    hdr->edfparam[channel].sample_pntr = 0LL;
+  }
+
+  return(hdr->edfparam[channel].sample_pntr);
+}
+
+
+long long edftell(int handle, int edfsignal)
+{
+  struct edfhdrblock *hdr;
+
+  int channel;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
+  {
+    return(-1);
+  }
+
+  if(edfsignal<0)
+  {
+    return(-1);
+  }
+
+  if(hdr->writemode)
+  {
+    return(-1);
+  }
+
+  if(edfsignal>=(hdr->edfsignals - hdr->nr_annot_chns))
+  {
+    return(-1);
+  }
+
+  channel = hdr->mapped_signals[edfsignal];
+
+  return(hdr->edfparam[channel].sample_pntr);
+}
+
+
+void edfrewind(int handle, int edfsignal)
+{
+  struct edfhdrblock *hdr;
+
+  int channel;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
+  {
+    return;
+  }
+
+  if(edfsignal<0)
+  {
+    return;
+  }
+
+  if(hdr->writemode)
+  {
+    return;
+  }
+
+  if(edfsignal>=(hdr->edfsignals - hdr->nr_annot_chns))
+  {
+    return;
+  }
+
+  channel = hdr->mapped_signals[edfsignal];
+
+  hdr->edfparam[channel].sample_pntr = 0LL;
+}
+
+
+long long edfseek_time(int handle, int edfsignal, long long time)
+{
+  struct edfhdrblock *hdr;
+
+  int channel;
+
+  long long smp_in_file,
+            sample;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
+  {
+    return(-1);
+  }
+
+  if(edfsignal<0)
+  {
+    return(-1);
+  }
+
+  if(hdr->writemode)
+  {
+    return(-1);
+  }
 
-      while(annot->next_annotation)
-      {
-        annot = annot->next_annotation;
+  if(edfsignal>=(hdr->edfsignals - hdr->nr_annot_chns))
+  {
+    return(-1);
+  }
 
-        free(annot->former_annotation);
-      }
+  channel = hdr->mapped_signals[edfsignal];
 
-      free(annot);
+  while(1)
+  {
+    sample = edflib_time_to_sample(hdr, channel, time);
+    if(sample!=-2LL)
+    {
+      break;
     }
 
-    fclose(hdr->file_hdl);
-
-    free(hdr->edfparam);
+    /* the index does not reach that far yet, a background scan must be waited for, */
+    /* a lazy scan is continued here */
+    if(hdr->annot_thread_running)
+    {
+      return(-1);
+    }
 
-    free(hdr);
+    if(edf_scan_annotations(handle, EDFLIB_ANNOT_SCAN_CHUNK)<0)
+    {
+      return(-1);
+    }
+  }
 
-    hdrlist[handle] = NULL;
+  if(sample<0LL)
+  {
+    return(-1);
+  }
 
-    files_open--;
+  smp_in_file = hdr->edfparam[channel].smp_per_record * hdr->datarecords;
 
-    return(0);
+  if(sample > smp_in_file)
+  {
+    sample = smp_in_file;
   }
 
-  return(-1); /* we never reach this line */
+  hdr->edfparam[channel].sample_pntr = sample;
+
+  return(sample);
 }
 
 
-long long edfseek(int handle, int edfsignal, long long offset, int whence)
+long long edf_get_datarecord_onset(int handle, long long datarecord)
 {
-  long long smp_in_file;
+  struct edfhdrblock *hdr;
 
-  int channel;
+  int lo, hi, mid;
 
+  long long onset;
 
-  if(handle<0)
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(handle>=EDFLIB_MAXFILES)
+  if(hdr->writemode)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]==NULL)
+  if((datarecord<0LL)||(datarecord>=hdr->datarecords))
   {
     return(-1);
   }
 
-  if(edfsignal<0)
+  if(!(hdr->discontinuous))
   {
-    return(-1);
+    return(hdr->starttime_offset + (datarecord * hdr->long_data_record_duration));
   }
 
-  if(hdrlist[handle]->writemode)
+  while(1)
   {
-    return(-1);
+    EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+    if((datarecord<hdr->annot_scan_record)||(hdr->annot_scan_done))
+    {
+      break;
+    }
+
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+    if(hdr->annot_thread_running)
+    {
+      return(-1);
+    }
+
+    if(edf_scan_annotations(handle, EDFLIB_ANNOT_SCAN_CHUNK)<0)
+    {
+      return(-1);
+    }
   }
 
-  if(edfsignal>=(hdrlist[handle]->edfsignals - hdrlist[handle]->nr_annot_chns))
+  if(!(hdr->nr_segments))
   {
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
     return(-1);
   }
 
-  channel = hdrlist[handle]->mapped_signals[edfsignal];
-
-  smp_in_file = hdrlist[handle]->edfparam[channel].smp_per_record * hdrlist[handle]->datarecords;
+  lo = 0;
+  hi = hdr->nr_segments - 1;
 
-  if(whence==EDFSEEK_SET)
+  while(lo<hi)
   {
-    hdrlist[handle]->edfparam[channel].sample_pntr = offset;
-  }
+    mid = (lo + hi + 1) / 2;
 
-  if(whence==EDFSEEK_CUR)
-  {
-    hdrlist[handle]->edfparam[channel].sample_pntr += offset;
+    if(hdr->segments[mid].datarecord<=datarecord)
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
   }
 
-  if(whence==EDFSEEK_END)
+  onset = hdr->segments[lo].onset + ((datarecord - hdr->segments[lo].datarecord) * hdr->long_data_record_duration);
+
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+  return(onset);
+}
+
+
+int edf_get_number_of_segments(int handle)
+{
+  struct edfhdrblock *hdr;
+
+  int n;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
-    hdrlist[handle]->edfparam[channel].sample_pntr =
-      (hdrlist[handle]->edfparam[channel].smp_per_record * hdrlist[handle]->datarecords) + offset;
+    return(-1);
   }
 
-  if(hdrlist[handle]->edfparam[channel].sample_pntr > smp_in_file)
+  if(hdr->writemode)
   {
-    hdrlist[handle]->edfparam[channel].sample_pntr = smp_in_file;
+    return(-1);
   }
 
-  if(hdrlist[handle]->edfparam[channel].sample_pntr < 0LL)
+  if(!(hdr->discontinuous))
   {
-    hdrlist[handle]->edfparam[channel].sample_pntr = 0LL;
+    return(1);
   }
 
-  return(hdrlist[handle]->edfparam[channel].sample_pntr);
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+  n = hdr->nr_segments;
+
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+  return(n);
 }
 
 
-long long edftell(int handle, int edfsignal)
+int edf_get_segment(int handle, int n, long long *datarecord, long long *onset)
 {
-  int channel;
+  struct edfhdrblock *hdr;
 
 
-  if(handle<0)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(handle>=EDFLIB_MAXFILES)
+  if(hdr->writemode)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]==NULL)
+  if(n<0)
   {
     return(-1);
   }
 
-  if(edfsignal<0)
+  if(!(hdr->discontinuous))
   {
-    return(-1);
+    if(n)
+    {
+      return(-1);
+    }
+
+    *datarecord = 0LL;
+
+    *onset = hdr->starttime_offset;
+
+    return(0);
   }
 
-  if(hdrlist[handle]->writemode)
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+  if(n>=hdr->nr_segments)
   {
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
     return(-1);
   }
 
-  if(edfsignal>=(hdrlist[handle]->edfsignals - hdrlist[handle]->nr_annot_chns))
+  *datarecord = hdr->segments[n].datarecord;
+
+  *onset = hdr->segments[n].onset;
+
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+  return(0);
+}
+
+
+static int edflib_add_segment(struct edfhdrblock *hdr, long long datarecord, long long onset)
+{
+  int new_size;
+
+  struct edf_segmentblock *new_segments;
+
+
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+  if(hdr->nr_segments>=hdr->segments_allocated)
   {
-    return(-1);
+    if(hdr->segments_allocated)
+    {
+      new_size = hdr->segments_allocated * 2;
+    }
+    else
+    {
+      new_size = 16;
+    }
+
+    new_segments = (struct edf_segmentblock *)realloc(hdr->segments, sizeof(struct edf_segmentblock) * new_size);
+    if(new_segments==NULL)
+    {
+      EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+      return(-1);
+    }
+
+    hdr->segments = new_segments;
+
+    hdr->segments_allocated = new_size;
   }
 
-  channel = hdrlist[handle]->mapped_signals[edfsignal];
+  hdr->segments[hdr->nr_segments].datarecord = datarecord;
 
-  return(hdrlist[handle]->edfparam[channel].sample_pntr);
+  hdr->segments[hdr->nr_segments].onset = onset;
+
+  hdr->nr_segments++;
+
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+  return(0);
 }
 
 
-void edfrewind(int handle, int edfsignal)
+/* Maps a time (relative to the starttime in the header) to a sample position of channel. */
+/* A time inside a gap maps to the first sample after the gap. Binary search over the */
+/* segments, so O(log segments). Returns -2 when the segment index does not cover the */
+/* time yet (the scan has not reached it), -1 in case of an error. */
+static long long edflib_time_to_sample(struct edfhdrblock *hdr, int channel, long long time)
 {
-  int channel;
+  int lo, hi, mid,
+      done;
 
+  long long smp_per_record,
+            dur,
+            datarecord,
+            segment_end,
+            offset;
 
-  if(handle<0)
+
+  smp_per_record = hdr->edfparam[channel].smp_per_record;
+
+  dur = hdr->long_data_record_duration;
+
+  if(!(hdr->discontinuous))
   {
-    return;
+    offset = time - hdr->starttime_offset;
+
+    if(offset<0LL)
+    {
+      offset = 0LL;
+    }
+
+    return(((offset / dur) * smp_per_record) + (((offset % dur) * smp_per_record) / dur));
   }
 
-  if(handle>=EDFLIB_MAXFILES)
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
+
+  done = hdr->annot_scan_done;
+
+  if(!(hdr->nr_segments))
   {
-    return;
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+    if(done)
+    {
+      return(-1);
+    }
+
+    return(-2);
   }
 
-  if(hdrlist[handle]==NULL)
+  if(time<hdr->segments[0].onset)
   {
-    return;
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+    return(0LL);
   }
 
-  if(edfsignal<0)
+  lo = 0;
+  hi = hdr->nr_segments - 1;
+
+  while(lo<hi)
   {
-    return;
+    mid = (lo + hi + 1) / 2;
+
+    if(hdr->segments[mid].onset<=time)
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
   }
 
-  if(hdrlist[handle]->writemode)
+  if((lo + 1)<hdr->nr_segments)
   {
-    return;
+    segment_end = hdr->segments[lo + 1].datarecord;
   }
-
-  if(edfsignal>=(hdrlist[handle]->edfsignals - hdrlist[handle]->nr_annot_chns))
+  else if(done)
   {
-    return;
+    segment_end = hdr->datarecords;
+  }
+  else
+  {
+    segment_end = hdr->annot_scan_record;
   }
 
-  channel = hdrlist[handle]->mapped_signals[edfsignal];
+  offset = time - hdr->segments[lo].onset;
+
+  datarecord = hdr->segments[lo].datarecord + (offset / dur);
+
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
+
+  if(datarecord>=segment_end)
+  {
+    if(((lo + 1)>=hdr->nr_segments)&&(!done))
+    {
+      return(-2);
+    }
+
+    return(segment_end * smp_per_record);
+  }
 
-  hdrlist[handle]->edfparam[channel].sample_pntr = 0LL;
+  return((datarecord * smp_per_record) + (((offset % dur) * smp_per_record) / dur));
 }
 
 
@@ -911,17 +1614,8 @@ int edfread_physical_samples(int handle, int edfsignal, int n, double *buf)
   FILE *file;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
@@ -931,17 +1625,17 @@ int edfread_physical_samples(int handle, int edfsignal, int n, double *buf)
     return(-1);
   }
 
-  if(hdrlist[handle]->writemode)
+  if(hdr->writemode)
   {
     return(-1);
   }
 
-  if(edfsignal>=(hdrlist[handle]->edfsignals - hdrlist[handle]->nr_annot_chns))
+  if(edfsignal>=(hdr->edfsignals - hdr->nr_annot_chns))
   {
     return(-1);
   }
 
-  channel = hdrlist[handle]->mapped_signals[edfsignal];
+  channel = hdr->mapped_signals[edfsignal];
 
   if(n<0LL)
   {
@@ -953,8 +1647,6 @@ int edfread_physical_samples(int handle, int edfsignal, int n, double *buf)
     return(0LL);
   }
 
-  hdr = hdrlist[handle];
-
   if(hdr->edf)
   {
     bytes_per_smpl = 2;
@@ -1095,17 +1787,8 @@ int edfread_digital_samples(int handle, int edfsignal, int n, int *buf)
   FILE *file;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
@@ -1115,17 +1798,17 @@ int edfread_digital_samples(int handle, int edfsignal, int n, int *buf)
     return(-1);
   }
 
-  if(hdrlist[handle]->writemode)
+  if(hdr->writemode)
   {
     return(-1);
   }
 
-  if(edfsignal>=(hdrlist[handle]->edfsignals - hdrlist[handle]->nr_annot_chns))
+  if(edfsignal>=(hdr->edfsignals - hdr->nr_annot_chns))
   {
     return(-1);
   }
 
-  channel = hdrlist[handle]->mapped_signals[edfsignal];
+  channel = hdr->mapped_signals[edfsignal];
 
   if(n<0LL)
   {
@@ -1137,8 +1820,6 @@ int edfread_digital_samples(int handle, int edfsignal, int n, int *buf)
     return(0LL);
   }
 
-  hdr = hdrlist[handle];
-
   if(hdr->edf)
   {
     bytes_per_smpl = 2;
@@ -1226,91 +1907,197 @@ int edfread_digital_samples(int handle, int edfsignal, int n, int *buf)
       {
         return(-1);
       }
-      var.four[2] = tmp;
+      var.four[2] = tmp;
+
+      if(var.four[2]&0x80)
+      {
+        var.four[3] = 0xff;
+      }
+      else
+      {
+        var.four[3] = 0x00;
+      }
+
+      buf[i] = var.one_signed;
+
+      sample_pntr++;
+    }
+  }
+
+  hdr->edfparam[channel].sample_pntr = sample_pntr;
+
+  return(n);
+}
+
+
+int edf_get_annotation(int handle, int n, struct edf_annotation_struct *annot)
+{
+  struct edfhdrblock *hdr;
+
+  long long i;
+
+  struct edf_annotationblock *list_annot;
+
+
+
+  memset(annot, 0, sizeof(struct edf_annotation_struct));
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
+  {
+    return(-1);
+  }
+
+  if(hdr->writemode)
+  {
+    return(-1);
+  }
+
+  if(n<0)
+  {
+    return(-1);
+  }
+
+  /* in lazy mode, scan only as far as needed to reach annotation n */
+  if(!(hdr->annot_thread_running))
+  {
+    while((n>=hdr->annots_in_file)&&(!(hdr->annot_scan_done)))
+    {
+      if(edf_scan_annotations(handle, EDFLIB_ANNOT_SCAN_CHUNK)<0)
+      {
+        return(-1);
+      }
+    }
+  }
 
-      if(var.four[2]&0x80)
-      {
-        var.four[3] = 0xff;
-      }
-      else
-      {
-        var.four[3] = 0x00;
-      }
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
 
-      buf[i] = var.one_signed;
+  if(n>=hdr->annots_in_file)
+  {
+    EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
 
-      sample_pntr++;
-    }
+    return(-1);
   }
 
-  hdr->edfparam[channel].sample_pntr = sample_pntr;
+  /* sequential queries continue from the last position instead of walking from the head */
+  if((hdr->annot_cursor!=NULL)&&(n>=hdr->annot_cursor_n))
+  {
+    list_annot = hdr->annot_cursor;
 
-  return(n);
-}
+    i = hdr->annot_cursor_n;
+  }
+  else
+  {
+    list_annot = hdr->annotationslist;
+
+    i = 0LL;
+  }
 
+  for(; i<n; i++)
+  {
+    list_annot = list_annot->next_annotation;
+  }
 
-int edf_get_annotation(int handle, int n, struct edf_annotation_struct *annot)
-{
-  int i;
+  hdr->annot_cursor = list_annot;
 
-  struct edf_annotationblock *list_annot;
+  hdr->annot_cursor_n = n;
 
+  annot->onset = list_annot->onset;
+  strcpy(annot->duration, list_annot->duration);
+  strcpy(annot->annotation, list_annot->annotation);
 
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
 
-  memset(annot, 0, sizeof(struct edf_annotation_struct));
+  return(0);
+}
 
-  if(handle<0)
+
+int edf_scan_annotations(int handle, long long datarecords)
+{
+  struct edfhdrblock *hdr;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(handle>=EDFLIB_MAXFILES)
+  if(hdr->writemode)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]==NULL)
+  if(hdr->annot_thread_running)
+  {
+    return(edf_get_annotation_scan_status(handle, NULL, NULL));
+  }
+
+  if(hdr->annot_scan_error)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->writemode)
+  if(hdr->annot_scan_done)
+  {
+    return(1);
+  }
+
+  if(edflib_get_annotations(hdr, hdr->file_hdl, datarecords))
   {
+    hdr->annot_scan_error = 1;
+
+    hdr->annot_scan_done = 1;
+
     return(-1);
   }
 
-  if(n<0)
+  return(hdr->annot_scan_done);
+}
+
+
+int edf_get_annotation_scan_status(int handle, long long *annotations, long long *datarecords_scanned)
+{
+  int status;
+
+  struct edfhdrblock *hdr;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(n>=hdrlist[handle]->annots_in_file)
+  if(hdr->writemode)
   {
     return(-1);
   }
 
-  list_annot = annotationslist[handle];
+  EDFLIB_MUTEX_LOCK(&hdr->annot_lock);
 
-  if(list_annot==NULL)
+  if(annotations!=NULL)
   {
-    return(-1);
+    *annotations = hdr->annots_in_file;
   }
 
-  for(i=0; i<n; i++)
+  if(datarecords_scanned!=NULL)
   {
-    if(list_annot->next_annotation==NULL)
-    {
-      return(-1);
-    }
+    *datarecords_scanned = hdr->annot_scan_record;
+  }
 
-    list_annot = list_annot->next_annotation;
+  if(hdr->annot_scan_error)
+  {
+    status = -1;
+  }
+  else
+  {
+    status = hdr->annot_scan_done;
   }
 
-  annot->onset = list_annot->onset;
-  strcpy(annot->duration, list_annot->duration);
-  strcpy(annot->annotation, list_annot->annotation);
+  EDFLIB_MUTEX_UNLOCK(&hdr->annot_lock);
 
-  return(0);
+  return(status);
 }
 
 
@@ -2916,11 +3703,15 @@ int edflib_version(void)
 }
 
 
-int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotations)
+/* Scans the TAL's of at most max_records datarecords, starting at edfhdr->annot_scan_record, */
+/* and appends the annotations found to the annotationslist of edfhdr. */
+/* The scan position is kept in edfhdr, so it can be resumed by a subsequent call. */
+/* inputfile can be a private file pointer, so a background scan does not move the file */
+/* position used by the read functions. New annotations are published under annot_lock. */
+int edflib_get_annotations(struct edfhdrblock *edfhdr, FILE *inputfile, long long max_records)
 {
-  int i, j, k, p, r=0, n,
-      edfsignals,
-      datarecords,
+  int j, k, p, r=0, n,
+      read_annotations,
       recordsize,
       discontinuous,
       *annot_ch,
@@ -2942,26 +3733,32 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
        *duration_in_txt;
 
 
-  long long data_record_duration,
+  long long i,
+            datarecords,
+            data_record_duration,
             elapsedtime,
-            time_tmp=0;
-
-  FILE *inputfile;
+            time_tmp=0,
+            new_annots=0;
 
   struct edfparamblock *edfparam;
 
   struct edf_annotationblock *new_annotation=NULL,
-                             *temp_annotation;
+                             *new_list=NULL,
+                             *new_list_tail=NULL;
 
-  inputfile = edfhdr->file_hdl;
-  edfsignals = edfhdr->edfsignals;
   recordsize = edfhdr->recordsize;
   edfparam = edfhdr->edfparam;
   nr_annot_chns = edfhdr->nr_annot_chns;
-  datarecords = edfhdr->datarecords;
   data_record_duration = edfhdr->long_data_record_duration;
   discontinuous = edfhdr->discontinuous;
   annot_ch = edfhdr->annot_ch;
+  read_annotations = edfhdr->annot_read_mode;
+
+  datarecords = edfhdr->annot_scan_record + max_records;
+  if((max_records<0LL)||(datarecords>edfhdr->datarecords))
+  {
+    datarecords = edfhdr->datarecords;
+  }
 
   if(edfhdr->edfplus)
   {
@@ -3011,7 +3808,7 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
     return(1);
   }
 
-  if(fseeko(inputfile, (long long)((edfsignals + 1) * 256), SEEK_SET))
+  if(fseeko(inputfile, (long long)edfhdr->hdrsize + (edfhdr->annot_scan_record * recordsize), SEEK_SET))
   {
     free(cnv_buf);
     free(scratchpad);
@@ -3020,12 +3817,13 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
     return(2);
   }
 
-  elapsedtime = 0;
+  elapsedtime = edfhdr->annot_scan_elapsedtime;
 
-  for(i=0; i<datarecords; i++)
+  for(i=edfhdr->annot_scan_record; i<datarecords; i++)
   {
     if(fread(cnv_buf, recordsize, 1, inputfile)!=1)
     {
+      edflib_free_annotation_chain(new_list);
       free(cnv_buf);
       free(scratchpad);
       free(time_in_txt);
@@ -3115,6 +3913,17 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
                   edfhdr->starttime_offset = time_tmp;
                 }
               }
+              if(discontinuous)
+              {
+                if((!i)||((time_tmp-elapsedtime)!=data_record_duration))
+                {
+                  if(edflib_add_segment(edfhdr, i, time_tmp))
+                  {
+                    error = 7;
+                    goto END;
+                  }
+                }
+              }
               elapsedtime = time_tmp;
               error = 0;
               break;
@@ -3177,6 +3986,7 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
                 new_annotation = (struct edf_annotationblock *)calloc(1, sizeof(struct edf_annotationblock));
                 if(new_annotation==NULL)
                 {
+                  edflib_free_annotation_chain(new_list);
                   free(cnv_buf);
                   free(scratchpad);
                   free(time_in_txt);
@@ -3200,20 +4010,21 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
 
                 new_annotation->onset = edflib_get_long_time(time_in_txt);
 
-                if(annotationslist[hdl]==NULL)
+                new_annotation->former_annotation = new_list_tail;
+
+                if(new_list==NULL)
                 {
-                  new_annotation->former_annotation = NULL;
-                  annotationslist[hdl] = new_annotation;
+                  new_list = new_annotation;
                 }
                 else
                 {
-                  temp_annotation = annotationslist[hdl];
-                  while(temp_annotation->next_annotation)  temp_annotation = temp_annotation->next_annotation;
-
-                  new_annotation->former_annotation = temp_annotation;
-                  temp_annotation->next_annotation = new_annotation;
+                  new_list_tail->next_annotation = new_annotation;
                 }
 
+                new_list_tail = new_annotation;
+
+                new_annots++;
+
                 if(read_annotations==EDFLIB_READ_ANNOTATIONS)
                 {
                   if(!(strncmp(new_annotation->annotation, "Recording ends", 14)))
@@ -3283,6 +4094,7 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
 
       if(error)
       {
+        edflib_free_annotation_chain(new_list);
         free(cnv_buf);
         free(scratchpad);
         free(time_in_txt);
@@ -3297,6 +4109,37 @@ int edflib_get_annotations(struct edfhdrblock *edfhdr, int hdl, int read_annotat
   free(time_in_txt);
   free(duration_in_txt);
 
+  edfhdr->annot_scan_elapsedtime = elapsedtime;
+
+  EDFLIB_MUTEX_LOCK(&edfhdr->annot_lock);
+
+  if(new_list!=NULL)
+  {
+    if(edfhdr->annotationslist==NULL)
+    {
+      edfhdr->annotationslist = new_list;
+    }
+    else
+    {
+      new_list->former_annotation = edfhdr->annotationslist_tail;
+
+      edfhdr->annotationslist_tail->next_annotation = new_list;
+    }
+
+    edfhdr->annotationslist_tail = new_list_tail;
+
+    edfhdr->annots_in_file += new_annots;
+  }
+
+  edfhdr->annot_scan_record = datarecords;
+
+  if(datarecords>=edfhdr->datarecords)
+  {
+    edfhdr->annot_scan_done = 1;
+  }
+
+  EDFLIB_MUTEX_UNLOCK(&edfhdr->annot_lock);
+
   return(0);
 }
 
@@ -3679,7 +4522,7 @@ void edflib_latin12utf8(char *latin1_str, int len)
 
 int edfopen_file_writeonly(const char *path, int filetype, int number_of_signals)
 {
-  int i, handle;
+  int handle;
 
   FILE *file;
 
@@ -3691,22 +4534,6 @@ int edfopen_file_writeonly(const char *path, int filetype, int number_of_signals
     return(EDFLIB_FILETYPE_ERROR);
   }
 
-  if(files_open>=EDFLIB_MAXFILES)
-  {
-    return(EDFLIB_MAXFILES_REACHED);
-  }
-
-  for(i=0; i<EDFLIB_MAXFILES; i++)
-  {
-    if(hdrlist[i]!=NULL)
-    {
-      if(!(strcmp(path, hdrlist[i]->path)))
-      {
-        return(EDFLIB_FILE_ALREADY_OPENED);
-      }
-    }
-  }
-
   if(number_of_signals<0)
   {
     return(EDFLIB_NUMBER_OF_SIGNALS_INVALID);
@@ -3735,42 +4562,30 @@ int edfopen_file_writeonly(const char *path, int filetype, int number_of_signals
 
   hdr->edfsignals = number_of_signals;
 
-  file = fopeno(path, "wb");
-  if(file==NULL)
+  /* claim the path before truncating the file, so an opened file can not be overwritten */
+  handle = edflib_alloc_handle(hdr, path);
+  if(handle<0)
   {
     free(hdr->edfparam);
 
     free(hdr);
 
-    return(EDFLIB_NO_SUCH_FILE_OR_DIRECTORY);
+    return(handle);
   }
 
-  hdr->file_hdl = file;
-
-  handle = -1;
-
-  for(i=0; i<EDFLIB_MAXFILES; i++)
+  file = fopeno(path, "wb");
+  if(file==NULL)
   {
-    if(hdrlist[i]==NULL)
-    {
-      hdrlist[i] = hdr;
+    edflib_release_handle(handle);
 
-      handle = i;
+    free(hdr->edfparam);
 
-      break;
-    }
-  }
+    free(hdr);
 
-  if(handle<0)
-  {
-    return(EDFLIB_MAXFILES_REACHED);
+    return(EDFLIB_NO_SUCH_FILE_OR_DIRECTORY);
   }
 
-  write_annotationslist[handle] = NULL;
-
-  strcpy(hdr->path, path);
-
-  files_open++;
+  hdr->file_hdl = file;
 
   if(filetype==EDFLIB_FILETYPE_EDFPLUS)
   {
@@ -3790,28 +4605,23 @@ int edfopen_file_writeonly(const char *path, int filetype, int number_of_signals
 
   hdr->nr_annot_chns = 1;
 
+  hdr->flush_interval = 1;
+
   return(handle);
 }
 
 
 int edf_set_samplefrequency(int handle, int edfsignal, int samplefrequency)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -3821,7 +4631,7 @@ int edf_set_samplefrequency(int handle, int edfsignal, int samplefrequency)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
@@ -3831,40 +4641,59 @@ int edf_set_samplefrequency(int handle, int edfsignal, int samplefrequency)
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  hdrlist[handle]->edfparam[edfsignal].smp_per_record = samplefrequency;
+  hdr->edfparam[edfsignal].smp_per_record = samplefrequency;
 
   return(0);
 }
 
 
-int edf_set_number_of_annotation_signals(int handle, int annot_signals)
+int edf_set_flush_interval(int handle, int datarecords)
 {
-  if(handle<0)
+  struct edfhdrblock *hdr;
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
+  {
+    return(-1);
+  }
+
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(handle>=EDFLIB_MAXFILES)
+  if(datarecords<1)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]==NULL)
+  hdr->flush_interval = datarecords;
+
+  return(0);
+}
+
+
+int edf_set_number_of_annotation_signals(int handle, int annot_signals)
+{
+  struct edfhdrblock *hdr;
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
@@ -3874,7 +4703,7 @@ int edf_set_number_of_annotation_signals(int handle, int annot_signals)
     return(-1);
   }
 
-  hdrlist[handle]->nr_annot_chns = annot_signals;
+  hdr->nr_annot_chns = annot_signals;
 
   return(0);
 }
@@ -3882,27 +4711,20 @@ int edf_set_number_of_annotation_signals(int handle, int annot_signals)
 
 int edf_set_datarecord_duration(int handle, int duration)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
@@ -3912,22 +4734,22 @@ int edf_set_datarecord_duration(int handle, int duration)
     return(-1);
   }
 
-  hdrlist[handle]->long_data_record_duration = (long long)duration * 100LL;
+  hdr->long_data_record_duration = (long long)duration * 100LL;
 
-  if(hdrlist[handle]->long_data_record_duration < (EDFLIB_TIME_DIMENSION * 10LL))
+  if(hdr->long_data_record_duration < (EDFLIB_TIME_DIMENSION * 10LL))
   {
-    hdrlist[handle]->long_data_record_duration /= 10LL;
+    hdr->long_data_record_duration /= 10LL;
 
-    hdrlist[handle]->long_data_record_duration *= 10LL;
+    hdr->long_data_record_duration *= 10LL;
   }
   else
   {
-    hdrlist[handle]->long_data_record_duration /= 100LL;
+    hdr->long_data_record_duration /= 100LL;
 
-    hdrlist[handle]->long_data_record_duration *= 100LL;
+    hdr->long_data_record_duration *= 100LL;
   }
 
-  hdrlist[handle]->data_record_duration = ((double)(hdrlist[handle]->long_data_record_duration)) / EDFLIB_TIME_DIMENSION;
+  hdr->data_record_duration = ((double)(hdr->long_data_record_duration)) / EDFLIB_TIME_DIMENSION;
 
   return(0);
 }
@@ -3948,38 +4770,27 @@ int edfwrite_digital_short_samples(int handle, short *buf)
   struct edfhdrblock *hdr;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->bdf == 1)
+  if(hdr->bdf == 1)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignal = hdr->signal_write_sequence_pos;
@@ -4054,7 +4865,10 @@ int edfwrite_digital_short_samples(int handle, short *buf)
 
     hdr->datarecords++;
 
-    fflush(file);
+    if(!(hdr->datarecords % hdr->flush_interval))
+    {
+      fflush(file);
+    }
   }
 
   return(0);
@@ -4076,33 +4890,22 @@ int edfwrite_digital_samples(int handle, int *buf)
   struct edfhdrblock *hdr;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignal = hdr->signal_write_sequence_pos;
@@ -4176,7 +4979,10 @@ int edfwrite_digital_samples(int handle, int *buf)
 
     hdr->datarecords++;
 
-    fflush(file);
+    if(!(hdr->datarecords % hdr->flush_interval))
+    {
+      fflush(file);
+    }
   }
 
   return(0);
@@ -4199,38 +5005,27 @@ int edf_blockwrite_digital_samples(int handle, int *buf)
   struct edfhdrblock *hdr;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->signal_write_sequence_pos)
+  if(hdr->signal_write_sequence_pos)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignals = hdr->edfsignals;
@@ -4302,7 +5097,10 @@ int edf_blockwrite_digital_samples(int handle, int *buf)
 
   hdr->datarecords++;
 
-  fflush(file);
+  if(!(hdr->datarecords % hdr->flush_interval))
+  {
+    fflush(file);
+  }
 
   return(0);
 }
@@ -4324,43 +5122,32 @@ int edf_blockwrite_digital_short_samples(int handle, short *buf)
   struct edfhdrblock *hdr;
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->signal_write_sequence_pos)
+  if(hdr->signal_write_sequence_pos)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->bdf == 1)
+  if(hdr->bdf == 1)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignals = hdr->edfsignals;
@@ -4432,7 +5219,10 @@ int edf_blockwrite_digital_short_samples(int handle, short *buf)
 
   hdr->datarecords++;
 
-  fflush(file);
+  if(!(hdr->datarecords % hdr->flush_interval))
+  {
+    fflush(file);
+  }
 
   return(0);
 }
@@ -4445,48 +5235,37 @@ int edf_blockwrite_digital_3byte_samples(int handle, void *buf)
        edfsignals,
        total_samples=0;
 
-  FILE *file;
-
-  struct edfhdrblock *hdr;
-
-
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  FILE *file;
 
-  if(hdrlist[handle]==NULL)
+  struct edfhdrblock *hdr;
+
+
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->signal_write_sequence_pos)
+  if(hdr->signal_write_sequence_pos)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->bdf != 1)
+  if(hdr->bdf != 1)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignals = hdr->edfsignals;
@@ -4528,7 +5307,10 @@ int edf_blockwrite_digital_3byte_samples(int handle, void *buf)
 
   hdr->datarecords++;
 
-  fflush(file);
+  if(!(hdr->datarecords % hdr->flush_interval))
+  {
+    fflush(file);
+  }
 
   return(0);
 }
@@ -4554,33 +5336,22 @@ int edfwrite_physical_samples(int handle, double *buf)
 
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignal = hdr->signal_write_sequence_pos;
@@ -4660,7 +5431,10 @@ int edfwrite_physical_samples(int handle, double *buf)
 
     hdr->datarecords++;
 
-    fflush(file);
+    if(!(hdr->datarecords % hdr->flush_interval))
+    {
+      fflush(file);
+    }
   }
 
   return(0);
@@ -4688,38 +5462,27 @@ int edf_blockwrite_physical_samples(int handle, double *buf)
 
 
 
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
-
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->signal_write_sequence_pos)
+  if(hdr->signal_write_sequence_pos)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edfsignals == 0)
+  if(hdr->edfsignals == 0)
   {
     return(-1);
   }
 
-  hdr = hdrlist[handle];
-
   file = hdr->file_hdl;
 
   edfsignals = hdr->edfsignals;
@@ -4797,7 +5560,10 @@ int edf_blockwrite_physical_samples(int handle, double *buf)
 
   hdr->datarecords++;
 
-  fflush(file);
+  if(!(hdr->datarecords % hdr->flush_interval))
+  {
+    fflush(file);
+  }
 
   return(0);
 }
@@ -5402,22 +6168,15 @@ int edflib_write_edf_header(struct edfhdrblock *hdr)
 
 int edf_set_label(int handle, int edfsignal, const char *label)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -5427,21 +6186,21 @@ int edf_set_label(int handle, int edfsignal, const char *label)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->edfparam[edfsignal].label, label, 16);
+  strncpy(hdr->edfparam[edfsignal].label, label, 16);
 
-  hdrlist[handle]->edfparam[edfsignal].label[16] = 0;
+  hdr->edfparam[edfsignal].label[16] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->edfparam[edfsignal].label);
+  edflib_remove_padding_trailing_spaces(hdr->edfparam[edfsignal].label);
 
   return(0);
 }
@@ -5449,22 +6208,15 @@ int edf_set_label(int handle, int edfsignal, const char *label)
 
 int edf_set_physical_dimension(int handle, int edfsignal, const char *phys_dim)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -5474,21 +6226,21 @@ int edf_set_physical_dimension(int handle, int edfsignal, const char *phys_dim)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->edfparam[edfsignal].physdimension, phys_dim, 8);
+  strncpy(hdr->edfparam[edfsignal].physdimension, phys_dim, 8);
 
-  hdrlist[handle]->edfparam[edfsignal].physdimension[8] = 0;
+  hdr->edfparam[edfsignal].physdimension[8] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->edfparam[edfsignal].physdimension);
+  edflib_remove_padding_trailing_spaces(hdr->edfparam[edfsignal].physdimension);
 
   return(0);
 }
@@ -5496,22 +6248,15 @@ int edf_set_physical_dimension(int handle, int edfsignal, const char *phys_dim)
 
 int edf_set_physical_maximum(int handle, int edfsignal, double phys_max)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -5521,17 +6266,17 @@ int edf_set_physical_maximum(int handle, int edfsignal, double phys_max)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  hdrlist[handle]->edfparam[edfsignal].phys_max = phys_max;
+  hdr->edfparam[edfsignal].phys_max = phys_max;
 
   return(0);
 }
@@ -5539,22 +6284,15 @@ int edf_set_physical_maximum(int handle, int edfsignal, double phys_max)
 
 int edf_set_physical_minimum(int handle, int edfsignal, double phys_min)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -5564,17 +6302,17 @@ int edf_set_physical_minimum(int handle, int edfsignal, double phys_min)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  hdrlist[handle]->edfparam[edfsignal].phys_min = phys_min;
+  hdr->edfparam[edfsignal].phys_min = phys_min;
 
   return(0);
 }
@@ -5582,22 +6320,15 @@ int edf_set_physical_minimum(int handle, int edfsignal, double phys_min)
 
 int edf_set_digital_maximum(int handle, int edfsignal, int dig_max)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -5607,12 +6338,12 @@ int edf_set_digital_maximum(int handle, int edfsignal, int dig_max)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edf)
+  if(hdr->edf)
   {
     if(dig_max > 32767)
     {
@@ -5627,12 +6358,12 @@ int edf_set_digital_maximum(int handle, int edfsignal, int dig_max)
     }
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  hdrlist[handle]->edfparam[edfsignal].dig_max = dig_max;
+  hdr->edfparam[edfsignal].dig_max = dig_max;
 
   return(0);
 }
@@ -5640,22 +6371,15 @@ int edf_set_digital_maximum(int handle, int edfsignal, int dig_max)
 
 int edf_set_digital_minimum(int handle, int edfsignal, int dig_min)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -5665,12 +6389,12 @@ int edf_set_digital_minimum(int handle, int edfsignal, int dig_min)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->edf)
+  if(hdr->edf)
   {
     if(dig_min < (-32768))
     {
@@ -5685,12 +6409,12 @@ int edf_set_digital_minimum(int handle, int edfsignal, int dig_min)
     }
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  hdrlist[handle]->edfparam[edfsignal].dig_min = dig_min;
+  hdr->edfparam[edfsignal].dig_min = dig_min;
 
   return(0);
 }
@@ -5698,36 +6422,29 @@ int edf_set_digital_minimum(int handle, int edfsignal, int dig_min)
 
 int edf_set_patientname(int handle, const char *patientname)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_patient_name, patientname, 80);
+  strncpy(hdr->plus_patient_name, patientname, 80);
 
-  hdrlist[handle]->plus_patient_name[80] = 0;
+  hdr->plus_patient_name[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_patient_name);
+  edflib_remove_padding_trailing_spaces(hdr->plus_patient_name);
 
   return(0);
 }
@@ -5735,36 +6452,29 @@ int edf_set_patientname(int handle, const char *patientname)
 
 int edf_set_patientcode(int handle, const char *patientcode)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_patientcode, patientcode, 80);
+  strncpy(hdr->plus_patientcode, patientcode, 80);
 
-  hdrlist[handle]->plus_patientcode[80] = 0;
+  hdr->plus_patientcode[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_patientcode);
+  edflib_remove_padding_trailing_spaces(hdr->plus_patientcode);
 
   return(0);
 }
@@ -5772,27 +6482,20 @@ int edf_set_patientcode(int handle, const char *patientcode)
 
 int edf_set_gender(int handle, int gender)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
@@ -5804,14 +6507,14 @@ int edf_set_gender(int handle, int gender)
 
   if(gender)
   {
-    hdrlist[handle]->plus_gender[0] = 'M';
+    hdr->plus_gender[0] = 'M';
   }
   else
   {
-    hdrlist[handle]->plus_gender[0] = 'F';
+    hdr->plus_gender[0] = 'F';
   }
 
-  hdrlist[handle]->plus_gender[1] = 0;
+  hdr->plus_gender[1] = 0;
 
   return(0);
 }
@@ -5819,27 +6522,20 @@ int edf_set_gender(int handle, int gender)
 
 int edf_set_birthdate(int handle, int birthdate_year, int birthdate_month, int birthdate_day)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
@@ -5851,9 +6547,9 @@ int edf_set_birthdate(int handle, int birthdate_year, int birthdate_month, int b
     return(-1);
   }
 
-  sprintf(hdrlist[handle]->plus_birthdate, "%02i.%02i.%02i%02i", birthdate_day, birthdate_month, birthdate_year / 100, birthdate_year % 100);
+  sprintf(hdr->plus_birthdate, "%02i.%02i.%02i%02i", birthdate_day, birthdate_month, birthdate_year / 100, birthdate_year % 100);
 
-  hdrlist[handle]->plus_birthdate[10] = 0;
+  hdr->plus_birthdate[10] = 0;
 
   return(0);
 }
@@ -5861,36 +6557,29 @@ int edf_set_birthdate(int handle, int birthdate_year, int birthdate_month, int b
 
 int edf_set_patient_additional(int handle, const char *patient_additional)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_patient_additional, patient_additional, 80);
+  strncpy(hdr->plus_patient_additional, patient_additional, 80);
 
-  hdrlist[handle]->plus_patient_additional[80] = 0;
+  hdr->plus_patient_additional[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_patient_additional);
+  edflib_remove_padding_trailing_spaces(hdr->plus_patient_additional);
 
   return(0);
 }
@@ -5898,36 +6587,29 @@ int edf_set_patient_additional(int handle, const char *patient_additional)
 
 int edf_set_admincode(int handle, const char *admincode)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_admincode, admincode, 80);
+  strncpy(hdr->plus_admincode, admincode, 80);
 
-  hdrlist[handle]->plus_admincode[80] = 0;
+  hdr->plus_admincode[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_admincode);
+  edflib_remove_padding_trailing_spaces(hdr->plus_admincode);
 
   return(0);
 }
@@ -5935,36 +6617,29 @@ int edf_set_admincode(int handle, const char *admincode)
 
 int edf_set_technician(int handle, const char *technician)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_technician, technician, 80);
+  strncpy(hdr->plus_technician, technician, 80);
 
-  hdrlist[handle]->plus_technician[80] = 0;
+  hdr->plus_technician[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_technician);
+  edflib_remove_padding_trailing_spaces(hdr->plus_technician);
 
   return(0);
 }
@@ -5972,36 +6647,29 @@ int edf_set_technician(int handle, const char *technician)
 
 int edf_set_equipment(int handle, const char *equipment)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_equipment, equipment, 80);
+  strncpy(hdr->plus_equipment, equipment, 80);
 
-  hdrlist[handle]->plus_equipment[80] = 0;
+  hdr->plus_equipment[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_equipment);
+  edflib_remove_padding_trailing_spaces(hdr->plus_equipment);
 
   return(0);
 }
@@ -6009,36 +6677,29 @@ int edf_set_equipment(int handle, const char *equipment)
 
 int edf_set_recording_additional(int handle, const char *recording_additional)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->plus_recording_additional, recording_additional, 80);
+  strncpy(hdr->plus_recording_additional, recording_additional, 80);
 
-  hdrlist[handle]->plus_recording_additional[80] = 0;
+  hdr->plus_recording_additional[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->plus_recording_additional);
+  edflib_remove_padding_trailing_spaces(hdr->plus_recording_additional);
 
   return(0);
 }
@@ -6047,27 +6708,20 @@ int edf_set_recording_additional(int handle, const char *recording_additional)
 int edf_set_startdatetime(int handle, int startdate_year, int startdate_month, int startdate_day,
                                       int starttime_hour, int starttime_minute, int starttime_second)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
@@ -6082,12 +6736,12 @@ int edf_set_startdatetime(int handle, int startdate_year, int startdate_month, i
     return(-1);
   }
 
-  hdrlist[handle]->startdate_year = startdate_year;
-  hdrlist[handle]->startdate_month = startdate_month;
-  hdrlist[handle]->startdate_day = startdate_day;
-  hdrlist[handle]->starttime_hour = starttime_hour;
-  hdrlist[handle]->starttime_minute = starttime_minute;
-  hdrlist[handle]->starttime_second = starttime_second;
+  hdr->startdate_year = startdate_year;
+  hdr->startdate_month = startdate_month;
+  hdr->startdate_day = startdate_day;
+  hdr->starttime_hour = starttime_hour;
+  hdr->starttime_minute = starttime_minute;
+  hdr->starttime_second = starttime_second;
 
   return(0);
 }
@@ -6095,28 +6749,20 @@ int edf_set_startdatetime(int handle, int startdate_year, int startdate_month, i
 
 int edfwrite_annotation_utf8(int handle, long long onset, long long duration, const char *description)
 {
-  int i;
-
-  struct edf_write_annotationblock *list_annot,
-                                   *tmp_annot;
+  struct edfhdrblock *hdr;
 
+  int i;
 
-  if(handle<0)
-  {
-    return(-1);
-  }
+  struct edf_write_annotationblock *list_annot;
 
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -6152,52 +6798,40 @@ int edfwrite_annotation_utf8(int handle, long long onset, long long duration, co
     }
   }
 
-  if(write_annotationslist[handle]==NULL)
+  /* appended at the tail, so a night of annotations does not walk the list every time */
+  if(hdr->write_annotationslist==NULL)
   {
-    write_annotationslist[handle] = list_annot;
+    hdr->write_annotationslist = list_annot;
   }
   else
   {
-    tmp_annot = write_annotationslist[handle];
-
-    while(tmp_annot->next_annotation!=NULL)
-    {
-      tmp_annot = tmp_annot->next_annotation;
-    }
-
-    tmp_annot->next_annotation = list_annot;
+    hdr->write_annotationslist_tail->next_annotation = list_annot;
 
-    list_annot->former_annotation = tmp_annot;
+    list_annot->former_annotation = hdr->write_annotationslist_tail;
   }
 
+  hdr->write_annotationslist_tail = list_annot;
+
   return(0);
 }
 
 
 int edfwrite_annotation_latin1(int handle, long long onset, long long duration, const char *description)
 {
-  struct edf_write_annotationblock *list_annot,
-                                   *tmp_annot;
-
-  char str[EDFLIB_WRITE_MAX_ANNOTATION_LEN + 1];
+  struct edfhdrblock *hdr;
 
+  struct edf_write_annotationblock *list_annot;
 
-  if(handle<0)
-  {
-    return(-1);
-  }
+  char str[EDFLIB_WRITE_MAX_ANNOTATION_LEN + 1];
 
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -6223,24 +6857,20 @@ int edfwrite_annotation_latin1(int handle, long long onset, long long duration,
   list_annot->next_annotation = NULL;
   list_annot->former_annotation = NULL;
 
-  if(write_annotationslist[handle]==NULL)
+  /* appended at the tail, so a night of annotations does not walk the list every time */
+  if(hdr->write_annotationslist==NULL)
   {
-    write_annotationslist[handle] = list_annot;
+    hdr->write_annotationslist = list_annot;
   }
   else
   {
-    tmp_annot = write_annotationslist[handle];
-
-    while(tmp_annot->next_annotation!=NULL)
-    {
-      tmp_annot = tmp_annot->next_annotation;
-    }
+    hdr->write_annotationslist_tail->next_annotation = list_annot;
 
-    tmp_annot->next_annotation = list_annot;
-
-    list_annot->former_annotation = tmp_annot;
+    list_annot->former_annotation = hdr->write_annotationslist_tail;
   }
 
+  hdr->write_annotationslist_tail = list_annot;
+
   return(0);
 }
 
@@ -6278,22 +6908,15 @@ void edflib_remove_padding_trailing_spaces(char *str)
 
 int edf_set_prefilter(int handle, int edfsignal, const char *prefilter)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -6303,21 +6926,21 @@ int edf_set_prefilter(int handle, int edfsignal, const char *prefilter)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->edfparam[edfsignal].prefilter, prefilter, 80);
+  strncpy(hdr->edfparam[edfsignal].prefilter, prefilter, 80);
 
-  hdrlist[handle]->edfparam[edfsignal].prefilter[80] = 0;
+  hdr->edfparam[edfsignal].prefilter[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->edfparam[edfsignal].prefilter);
+  edflib_remove_padding_trailing_spaces(hdr->edfparam[edfsignal].prefilter);
 
   return(0);
 }
@@ -6325,22 +6948,15 @@ int edf_set_prefilter(int handle, int edfsignal, const char *prefilter)
 
 int edf_set_transducer(int handle, int edfsignal, const char *transducer)
 {
-  if(handle<0)
-  {
-    return(-1);
-  }
-
-  if(handle>=EDFLIB_MAXFILES)
-  {
-    return(-1);
-  }
+  struct edfhdrblock *hdr;
 
-  if(hdrlist[handle]==NULL)
+  hdr = edflib_get_hdr(handle);
+  if(hdr==NULL)
   {
     return(-1);
   }
 
-  if(!(hdrlist[handle]->writemode))
+  if(!(hdr->writemode))
   {
     return(-1);
   }
@@ -6350,21 +6966,21 @@ int edf_set_transducer(int handle, int edfsignal, const char *transducer)
     return(-1);
   }
 
-  if(edfsignal>=hdrlist[handle]->edfsignals)
+  if(edfsignal>=hdr->edfsignals)
   {
     return(-1);
   }
 
-  if(hdrlist[handle]->datarecords)
+  if(hdr->datarecords)
   {
     return(-1);
   }
 
-  strncpy(hdrlist[handle]->edfparam[edfsignal].transducer, transducer, 80);
+  strncpy(hdr->edfparam[edfsignal].transducer, transducer, 80);
 
-  hdrlist[handle]->edfparam[edfsignal].transducer[80] = 0;
+  hdr->edfparam[edfsignal].transducer[80] = 0;
 
-  edflib_remove_padding_trailing_spaces(hdrlist[handle]->edfparam[edfsignal].transducer);
+  edflib_remove_padding_trailing_spaces(hdr->edfparam[edfsignal].transducer);
 
   return(0);
 }
@@ -64,19 +64,21 @@
 #define EDFLIB_MALLOC_ERROR                 -1
 #define EDFLIB_NO_SUCH_FILE_OR_DIRECTORY    -2
 #define EDFLIB_FILE_CONTAINS_FORMAT_ERRORS  -3
-#define EDFLIB_MAXFILES_REACHED             -4
+#define EDFLIB_MAXFILES_REACHED             -4   /* no longer returned, the number of open files is only limited by memory */
 #define EDFLIB_FILE_READ_ERROR              -5
 #define EDFLIB_FILE_ALREADY_OPENED          -6
 #define EDFLIB_FILETYPE_ERROR               -7
 #define EDFLIB_FILE_WRITE_ERROR             -8
 #define EDFLIB_NUMBER_OF_SIGNALS_INVALID    -9
-#define EDFLIB_FILE_IS_DISCONTINUOUS       -10
+#define EDFLIB_FILE_IS_DISCONTINUOUS       -10  /* no longer returned, EDF+D and BDF+D files can be read */
 #define EDFLIB_INVALID_READ_ANNOTS_VALUE   -11
 
 /* values for annotations */
 #define EDFLIB_DO_NOT_READ_ANNOTATIONS 0
 #define EDFLIB_READ_ANNOTATIONS        1
 #define EDFLIB_READ_ALL_ANNOTATIONS    2
+#define EDFLIB_READ_ANNOTATIONS_LAZY   3
+#define EDFLIB_READ_ANNOTATIONS_BACKGROUND 4
 
 /* the following defines are possible errors returned by edfopen_file_writeonly() */
 #define EDFLIB_NO_SIGNALS                  -20
@@ -98,6 +100,10 @@ extern "C" {
 /* For more info about the EDF and EDF+ format, visit: http://edfplus.info/specs/ */
 /* For more info about the BDF and BDF+ format, visit: http://www.teuniz.net/edfbrowser/bdfplus%20format%20description.html */
 
+/* Thread safety: every handle owns its own state (file pointer, sample position indicators, annotations). */
+/* Different threads may open, read, write and close different handles concurrently. */
+/* A single handle must not be used by more than one thread at the same time. */
+
 
 struct edf_param_struct{         /* this structure contains all the relevant EDF-signal parameters of one signal */
   char   label[17];              /* label (name) of the signal, null-terminated string */
@@ -146,6 +152,7 @@ struct edf_hdr_struct{                     /* this structure contains all the re
   long long datarecord_duration;                          /* duration of a datarecord expressed in units of 100 nanoSeconds */
   long long datarecords_in_file;                          /* number of datarecords in the file */
   long long annotations_in_file;                          /* number of annotations in the file */
+  int       discontinuous;                                /* 1 if the file is EDF+D or BDF+D (the datarecords can contain gaps), otherwise 0 */
   struct edf_param_struct signalparam[EDFLIB_MAXSIGNALS]; /* array of structs which contain the relevant signal parameters */
        };
 
@@ -163,9 +170,17 @@ int edfopen_file_readonly(const char *path, struct edf_hdr_struct *edfhdr, int r
 
 /* read_annotations must have one of the following values:      */
 /*   EDFLIB_DO_NOT_READ_ANNOTATIONS      annotations will not be read (this saves time when opening a very large EDFplus or BDFplus file */
+/*                                       for discontinuous files this behaves as EDFLIB_READ_ANNOTATIONS_LAZY, the datarecord */
+/*                                       onsets are needed to locate the gaps                                                    */
 /*   EDFLIB_READ_ANNOTATIONS             annotations will be read immediately, stops when an annotation has */
 /*                                       been found which contains the description "Recording ends"         */
 /*   EDFLIB_READ_ALL_ANNOTATIONS         all annotations will be read immediately                           */
+/*   EDFLIB_READ_ANNOTATIONS_LAZY        only the first datarecord is scanned when opening, the rest of the */
+/*                                       file is scanned on demand by edf_get_annotation() or edf_scan_annotations() */
+/*   EDFLIB_READ_ANNOTATIONS_BACKGROUND  only the first datarecord is scanned when opening, the rest of the */
+/*                                       file is scanned by a background thread using its own file pointer  */
+/* In the lazy and background modes, annotations_in_file only counts the annotations found in the first */
+/* datarecord, use edf_get_annotation_scan_status() to follow the progress of the scan */
 
 /* returns 0 on success, in case of an error it returns -1 and an errorcode will be set in the member "filetype" of struct edf_hdr_struct */
 /* This function is required if you want to read a file */
@@ -216,11 +231,55 @@ void edfrewind(int handle, int edfsignal);
 /* note that every signal has it's own independent sample position indicator and edfrewind() affects only one of them */
 
 
+long long edfseek_time(int handle, int edfsignal, long long time);
+
+/* Sets the sample position indicator for edfsignal to the sample recorded at time. */
+/* time is expressed in units of 100 nanoSeconds and relative to the starttime in the header (like the onset of an annotation). */
+/* For discontinuous files (EDF+D, BDF+D) the gaps are taken into account: a time inside a gap */
+/* moves the indicator to the first sample after the gap. The lookup is a binary search over the segments. */
+/* Returns the new sample position, or -1 in case of an error. When the file was opened with */
+/* EDFLIB_READ_ANNOTATIONS_BACKGROUND, -1 is also returned while the scan has not yet reached that time. */
+
+
+long long edf_get_datarecord_onset(int handle, long long datarecord);
+
+/* Returns the onset of datarecord (starting at 0) in units of 100 nanoSeconds, relative to the starttime in the header */
+/* or -1 in case of an error */
+
+
+int edf_get_number_of_segments(int handle);
+
+/* Returns the number of contiguous segments (runs of datarecords without a gap) found so far, or -1 in case of an error */
+/* A continuous file always has one segment */
+
+
+int edf_get_segment(int handle, int n, long long *datarecord, long long *onset);
+
+/* Stores the first datarecord and the onset (in units of 100 nanoSeconds) of segment n */
+/* Returns 0 on success, otherwise -1 */
+
+
 int edf_get_annotation(int handle, int n, struct edf_annotation_struct *annot);
 
 /* Fills the edf_annotation_struct with the annotation n, returns 0 on success, otherwise -1 */
 /* The string that describes the annotation/event is encoded in UTF-8 */
 /* To obtain the number of annotations in a file, check edf_hdr_struct -> annotations_in_file. */
+/* When the file was opened with EDFLIB_READ_ANNOTATIONS_LAZY, the file is scanned until annotation n is found. */
+/* When the file was opened with EDFLIB_READ_ANNOTATIONS_BACKGROUND, only the annotations found so far are returned. */
+
+
+int edf_scan_annotations(int handle, long long datarecords);
+
+/* Scans the annotations of the next datarecords datarecords (a negative value scans the rest of the file) */
+/* Only useful for files opened with EDFLIB_READ_ANNOTATIONS_LAZY */
+/* Returns 1 when the whole file has been scanned, 0 when there are datarecords left, -1 in case of an error */
+
+
+int edf_get_annotation_scan_status(int handle, long long *annotations, long long *datarecords_scanned);
+
+/* Stores the number of annotations found so far and the number of datarecords scanned so far */
+/* (both pointers can be NULL). Can be called from any thread while a background scan is running. */
+/* Returns 1 when the scan is complete, 0 when it is still in progress, -1 in case of an error */
 
 /*
 Notes:
@@ -292,7 +351,6 @@ int edfopen_file_writeonly(const char *path, int filetype, int number_of_signals
 /* in case of an error it returns a negative number corresponding to one of the following values: */
 /* EDFLIB_MALLOC_ERROR                */
 /* EDFLIB_NO_SUCH_FILE_OR_DIRECTORY   */
-/* EDFLIB_MAXFILES_REACHED            */
 /* EDFLIB_FILE_ALREADY_OPENED         */
 /* EDFLIB_NUMBER_OF_SIGNALS_INVALID   */
 /* This function is required if you want to write a file */
@@ -602,6 +660,15 @@ int edf_set_datarecord_duration(int handle, int duration);
 /* or set the samplefrequency to 1 Hz and the datarecord duration to 2 seconds. */
 /* Do not use this function, except when absolutely necessary! */
 
+int edf_set_flush_interval(int handle, int datarecords);
+
+/* Sets after how many datarecords the written data is flushed to disk. The default value is 1 (every datarecord). */
+/* A larger value reduces the number of flushes for long recordings, at the cost of losing at most */
+/* that many datarecords when the program is not closed properly. */
+/* Returns 0 on success, otherwise -1 */
+/* This function is optional and can be called only after opening a file in writemode */
+
+
 int edf_set_number_of_annotation_signals(int handle, int annot_signals);
 
 /* Sets the number of annotation signals. The default value is 1 */
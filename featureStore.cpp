@@ -0,0 +1,269 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "featureStore.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char FEATURE_MAGIC[4] = { 'O', 'L', 'D', 'F' };
+const int32_t FEATURE_VERSION = 3;  // 1 was remTuner's row cache, 2 had no saccade counts
+
+struct FeatureHeader {
+    char magic[4];
+    int32_t version;
+    int32_t block_rows;
+    int32_t columns;
+    int32_t bins;
+    int32_t rate;
+    int32_t window_samples;
+    int32_t fft_size;
+    int64_t rows;
+    char reserved[24];
+};
+
+FeatureStore::FeatureStore()
+{
+    m_rate = m_size_window = m_size_fft = m_bins = 0;
+    m_rows = 0;
+    m_block_size = 0;
+
+    m_file = NULL;
+    m_block = NULL;
+    m_block_fill = 0;
+
+    m_map = NULL;
+    m_map_size = 0;
+}
+
+FeatureStore::~FeatureStore()
+{
+    close();
+}
+
+int FeatureStore::set_Layout(int Fs, int size_window, int size_fft)
+{
+    if (Fs <= 0 || size_window <= 0 || size_fft <= 1) {
+        m_error = "bad rate, window or FFT size";
+        return -1;
+    }
+
+    m_rate = Fs;
+    m_size_window = size_window;
+    m_size_fft = size_fft;
+    m_bins = size_fft / 2;
+    m_block_size = (size_t) FEATURE_BLOCK_ROWS * (FEATURE_COLUMNS + m_bins);
+    return 0;
+}
+
+int FeatureStore::create(const std::string &path, int Fs, int size_window, int size_fft)
+{
+    close();
+    m_error.clear();
+
+    if (set_Layout(Fs, size_window, size_fft)) return -1;
+
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) {
+        m_error = "can not create " + path;
+        return -1;
+    }
+
+    m_block = new float[m_block_size];
+    m_block_fill = 0;
+    m_rows = 0;
+
+    return write_Header();
+}
+
+int FeatureStore::write_Header()
+{
+    FeatureHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FEATURE_MAGIC, 4);
+    header.version = FEATURE_VERSION;
+    header.block_rows = FEATURE_BLOCK_ROWS;
+    header.columns = FEATURE_COLUMNS;
+    header.bins = m_bins;
+    header.rate = m_rate;
+    header.window_samples = m_size_window;
+    header.fft_size = m_size_fft;
+    header.rows = m_rows;
+
+    if (fseek(m_file, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, m_file) != 1 ||
+        fseek(m_file, 0, SEEK_END) || fflush(m_file)) {
+        m_error = "can not write the feature file";
+        return -1;
+    }
+    return 0;
+}
+
+// Appends the block being filled, zero padded, and counts its rows in the header
+int FeatureStore::write_Block()
+{
+    if (!m_block_fill) return 0;
+
+    if (m_block_fill < FEATURE_BLOCK_ROWS) {
+        for (int c = 0; c < FEATURE_COLUMNS; c++)
+            memset(m_block + c * FEATURE_BLOCK_ROWS + m_block_fill, 0, (FEATURE_BLOCK_ROWS - m_block_fill) * sizeof(float));
+        float *spectra = m_block + FEATURE_COLUMNS * FEATURE_BLOCK_ROWS;
+        memset(spectra + (size_t) m_block_fill * m_bins, 0, (size_t) (FEATURE_BLOCK_ROWS - m_block_fill) * m_bins * sizeof(float));
+    }
+
+    if (fwrite(m_block, sizeof(float), m_block_size, m_file) != m_block_size) {
+        m_error = "can not write the feature file";
+        return -1;
+    }
+
+    m_rows += m_block_fill;
+    m_block_fill = 0;
+    return write_Header();
+}
+
+int FeatureStore::append(const double *features, const double *spectrum)
+{
+    if (!m_file) return -1;
+
+    for (int c = 0; c < FEATURE_COLUMNS; c++) m_block[c * FEATURE_BLOCK_ROWS + m_block_fill] = (float) features[c];
+
+    float *row = m_block + FEATURE_COLUMNS * FEATURE_BLOCK_ROWS + (size_t) m_block_fill * m_bins;
+    for (int i = 0; i < m_bins; i++) row[i] = (float) spectrum[i];
+
+    if (++m_block_fill == FEATURE_BLOCK_ROWS) return write_Block();
+    return 0;
+}
+
+int FeatureStore::open(const std::string &path)
+{
+    close();
+    m_error.clear();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        m_error = "can not open " + path;
+        return -1;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart >= (LONGLONG) sizeof(FeatureHeader)) {
+        m_map_size = (size_t) size.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping) {
+        m_map = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        m_error = "can not open " + path;
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (!fstat(file, &file_stat) && file_stat.st_size >= (off_t) sizeof(FeatureHeader)) {
+        m_map_size = (size_t) file_stat.st_size;
+        void *map = mmap(NULL, m_map_size, PROT_READ, MAP_SHARED, file, 0);
+        if (map != MAP_FAILED) m_map = (const char *) map;
+    }
+    ::close(file);
+#endif
+
+    if (!m_map) {
+        m_map_size = 0;
+        m_error = "can not map " + path;
+        return -1;
+    }
+
+    FeatureHeader header;
+    memcpy(&header, m_map, sizeof(header));
+
+    if (memcmp(header.magic, FEATURE_MAGIC, 4) || header.version != FEATURE_VERSION ||
+        header.block_rows != FEATURE_BLOCK_ROWS || header.columns != FEATURE_COLUMNS ||
+        set_Layout(header.rate, header.window_samples, header.fft_size) || header.bins != m_bins ||
+        header.rows < 0) {
+        close();
+        m_error = path + " is not a feature file of this version";
+        return -1;
+    }
+
+    // The header only counts blocks already on disk, a shorter file is damaged
+    size_t blocks = (size_t) ((header.rows + FEATURE_BLOCK_ROWS - 1) / FEATURE_BLOCK_ROWS);
+    if (sizeof(FeatureHeader) + blocks * m_block_size * sizeof(float) > m_map_size) {
+        close();
+        m_error = path + " is truncated";
+        return -1;
+    }
+
+    m_rows = (long) header.rows;
+    return 0;
+}
+
+void FeatureStore::close()
+{
+    if (m_file) {
+        write_Block();
+        fclose(m_file);
+        m_file = NULL;
+    }
+    delete[] m_block;
+    m_block = NULL;
+    m_block_fill = 0;
+
+    if (m_map) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_map);
+#else
+        munmap((void *) m_map, m_map_size);
+#endif
+        m_map = NULL;
+        m_map_size = 0;
+    }
+
+    m_rows = 0;
+}
+
+const float *FeatureStore::column(long row, int column) const
+{
+    const float *block = (const float *) (m_map + sizeof(FeatureHeader)) + (size_t) (row / FEATURE_BLOCK_ROWS) * m_block_size;
+    return block + column * FEATURE_BLOCK_ROWS + row % FEATURE_BLOCK_ROWS;
+}
+
+const float *FeatureStore::spectrum(long row) const
+{
+    const float *block = (const float *) (m_map + sizeof(FeatureHeader)) + (size_t) (row / FEATURE_BLOCK_ROWS) * m_block_size;
+    return block + FEATURE_COLUMNS * FEATURE_BLOCK_ROWS + (size_t) (row % FEATURE_BLOCK_ROWS) * m_bins;
+}
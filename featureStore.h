@@ -0,0 +1,124 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+#ifndef FEATURESTORE_H
+#define FEATURESTORE_H
+
+#include <stdio.h>
+#include <string>
+
+/* PER-WINDOW FEATURE AND SPECTRUM FILE, READ BACK MEMORY-MAPPED
+ *
+ * Keeps the spectrum and REM features of every analysis window so spectrograms,
+ * re-scoring and model training can use them later without recomputing FFTs.
+ * The file is columnar in fixed size blocks of FEATURE_BLOCK_ROWS windows: in a
+ * block, each feature column is one contiguous float run, followed by the spectra
+ * of the block one after the other. Every block has the same stride, so the place
+ * of any value is computed, not searched, and a reader only touches the pages of
+ * the columns it uses.
+ *
+ *     header (64 bytes, native byte order): "OLDF", version, block rows, columns, bins,
+ *                                           rate, window samples, FFT size, rows (int64)
+ *     block: [FEATURE_COLUMNS x FEATURE_BLOCK_ROWS floats][FEATURE_BLOCK_ROWS x bins floats]
+ *
+ * The writer fills one block in memory and appends it once full, then updates the
+ * row count in the header, so the live analysis only pays a sequential write every
+ * few minutes; a crash loses at most that block. close() appends the last,
+ * partial block.
+ *
+ * HOW TO USE
+    Writing:
+    1. Create the file, -1 on error (see error()):
+        FeatureStore.create(path, Sampling Frequency, Window size, FFT size);
+    2. Every window, with FEATURE_COLUMNS values and the FFT size / 2 bins of fft_power_Spectrum:
+        FeatureStore.append(features, spectrum);
+    3. FeatureStore.close() (or delete it)
+    Reading:
+    1. Map the file, -1 on error:
+        FeatureStore.open(path);
+    2. For rows 0 to FeatureStore.rows() - 1:
+        FeatureStore.value(row, FEATURE_SEFD), FeatureStore.spectrum(row)
+        or FeatureStore.column(row, FEATURE_SEFD), contiguous to the end of the block of row
+ *
+ */
+
+// Time is the second the window ends at, from the start of the recording.
+// Saccades are the SaccadeDetector events that ended in the window, at the live limits
+enum { FEATURE_TIME, FEATURE_SEFD, FEATURE_RP, FEATURE_AP, FEATURE_EOG_IP, FEATURE_SACCADES, FEATURE_COLUMNS };
+
+// 256 windows, about 8.5 minutes of 2 second windows
+const int FEATURE_BLOCK_ROWS = 256;
+
+class FeatureStore
+{
+public:
+    FeatureStore();
+    ~FeatureStore();
+
+    int create(const std::string &path, int Fs, int size_window, int size_fft);
+    int append(const double *features, const double *spectrum);
+
+    int open(const std::string &path);
+    void close();
+
+    long rows() const { return m_rows; }
+    int bins() const { return m_bins; }
+    int rate() const { return m_rate; }
+    int window_Samples() const { return m_size_window; }
+    int fft_Size() const { return m_size_fft; }
+
+    float value(long row, int column) const { return *this->column(row, column); }
+    const float *column(long row, int column) const;
+    const float *spectrum(long row) const;
+
+    const std::string &error() const { return m_error; }
+
+private:
+    FeatureStore(const FeatureStore &);
+    FeatureStore &operator=(const FeatureStore &);
+
+    int set_Layout(int Fs, int size_window, int size_fft);
+    int write_Header();
+    int write_Block();
+
+    int m_rate, m_size_window, m_size_fft, m_bins;
+    long m_rows;
+    size_t m_block_size;        // floats per block
+
+    // Writing: the block being filled
+    FILE *m_file;
+    float *m_block;
+    int m_block_fill;
+
+    // Reading: the mapped file
+    const char *m_map;
+    size_t m_map_size;
+
+    std::string m_error;
+
+};
+
+#endif // FEATURESTORE_H
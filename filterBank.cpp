@@ -0,0 +1,194 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "filterBank.h"
+#include "biquadCascade.h"
+
+// Number of passes in each direction of filtfilt, same as filterIIR::filtfilt
+const int FILTFILT_PASSES = 20;
+
+/* IIR coefficient layout:
+    => b0, b1, b2, a1, a2
+       ...
+*/
+
+FilterBank::FilterBank(const double *iirCoeffs, int stages, int channels, int max_samples, Workspace *workspace)
+{
+    m_iirCoeffs = iirCoeffs;
+    m_stages = stages;
+    m_channels = channels;
+    m_max_samples = max_samples;
+
+    if (workspace) {
+        m_state = workspace->take(m_stages * 2 * m_channels);
+        m_temp = workspace->take(m_channels * m_max_samples);
+        m_owns_memory = false;
+    } else {
+        m_state = new double[m_stages * 2 * m_channels];
+        m_temp = new double[m_channels * m_max_samples];
+        m_owns_memory = true;
+    }
+
+    reset();
+}
+
+int FilterBank::workspace_Size(int stages, int channels, int max_samples)
+{
+    return Workspace::size_Of(stages * 2 * channels) + Workspace::size_Of(channels * max_samples);
+}
+
+void FilterBank::reset()
+{
+    for (int i = 0; i < m_stages * 2 * m_channels; i++) m_state[i] = 0.0;
+}
+
+// Transposed form 2 Biquad, every stage of Group neighbouring channels per sample, so the
+// independent recursions of the channels overlap. The delay lines live in locals for the
+// whole call and go back to state once at the end.
+template <int Stages, int Group>
+static void run_Channels(const double *coeffs, double *state, int channels, int first,
+                         const double *input, int in_stride, double *output, int out_stride, int num_samples, int step)
+{
+    double s1[Stages][Group], s2[Stages][Group];
+    int start = (step > 0) ? 0 : num_samples - 1;
+
+    for (int k = 0; k < Stages; k++)
+        for (int g = 0; g < Group; g++) {
+            s1[k][g] = state[k * 2 * channels + first + g];
+            s2[k][g] = state[k * 2 * channels + channels + first + g];
+        }
+
+    for (int j = 0, n = start; j < num_samples; j++, n += step) {
+        double x[Group];
+        for (int g = 0; g < Group; g++) x[g] = input[(first + g) * in_stride + n];
+
+        for (int k = 0; k < Stages; k++)
+            for (int g = 0; g < Group; g++) x[g] = biquad_Section(coeffs + k * 5, s1[k][g], s2[k][g], x[g]);
+
+        for (int g = 0; g < Group; g++) output[(first + g) * out_stride + j] = x[g];
+    }
+
+    for (int k = 0; k < Stages; k++)
+        for (int g = 0; g < Group; g++) {
+            state[k * 2 * channels + first + g] = s1[k][g];
+            state[k * 2 * channels + channels + first + g] = s2[k][g];
+        }
+}
+
+// Stages is the compile-time stage count of a shipped design. The coefficients are copied
+// to the stack first, so the section loop reads them from memory the output stores can not alias.
+template <int Stages>
+static void run_Cascade(const double *iirCoeffs, double *state, int channels,
+                        const double *input, int in_stride, double *output, int out_stride, int num_samples, int step)
+{
+    double coeffs[Stages * 5];
+    for (int i = 0; i < Stages * 5; i++) coeffs[i] = iirCoeffs[i];
+
+    // An odd count ends on a group of three rather than a lone channel
+    int c = 0;
+    for (; channels - c > 3; c += 2)
+        run_Channels<Stages, 2>(coeffs, state, channels, c, input, in_stride, output, out_stride, num_samples, step);
+    if (channels - c == 3)
+        run_Channels<Stages, 3>(coeffs, state, channels, c, input, in_stride, output, out_stride, num_samples, step);
+    else if (channels - c == 2)
+        run_Channels<Stages, 2>(coeffs, state, channels, c, input, in_stride, output, out_stride, num_samples, step);
+    else
+        run_Channels<Stages, 1>(coeffs, state, channels, c, input, in_stride, output, out_stride, num_samples, step);
+}
+
+// Any other stage count: one stage at a time over the whole block, each in locals
+static void run_Stages(const double *iirCoeffs, double *state, int stages, int channels,
+                       const double *input, int in_stride, double *output, int out_stride, int num_samples, int step)
+{
+    int start = (step > 0) ? 0 : num_samples - 1;
+
+    for (int c = 0; c < channels; c++) {
+        double *y = output + c * out_stride;
+
+        for (int k = 0; k < stages; k++) {
+            double coeffs[5];
+            for (int i = 0; i < 5; i++) coeffs[i] = iirCoeffs[k * 5 + i];
+            double s1 = state[k * 2 * channels + c], s2 = state[k * 2 * channels + channels + c];
+
+            // The first stage reads the input in its direction, later ones refilter y in place
+            const double *x = k ? y : input + c * in_stride + start;
+            int x_step = k ? 1 : step;
+
+            for (int j = 0; j < num_samples; j++) y[j] = biquad_Section(coeffs, s1, s2, x[j * x_step]);
+
+            state[k * 2 * channels + c] = s1;
+            state[k * 2 * channels + channels + c] = s2;
+        }
+    }
+}
+
+// Dispatch to the instantiations of the designs we ship
+void FilterBank::run(const double *input, int in_stride, double *output, int out_stride, int num_samples, int step)
+{
+    switch (m_stages) {
+    case 1:
+        run_Cascade<1>(m_iirCoeffs, m_state, m_channels, input, in_stride, output, out_stride, num_samples, step);
+        break;
+    case 4:
+        run_Cascade<4>(m_iirCoeffs, m_state, m_channels, input, in_stride, output, out_stride, num_samples, step);
+        break;
+    case 6:
+        run_Cascade<6>(m_iirCoeffs, m_state, m_channels, input, in_stride, output, out_stride, num_samples, step);
+        break;
+    case 18:
+        run_Cascade<18>(m_iirCoeffs, m_state, m_channels, input, in_stride, output, out_stride, num_samples, step);
+        break;
+    default:
+        run_Stages(m_iirCoeffs, m_state, m_stages, m_channels, input, in_stride, output, out_stride, num_samples, step);
+        break;
+    }
+}
+
+// Forward runs go straight from input to output, so blocks of any length are fine
+void FilterBank::process(const double *input, double *output, int num_samples, int stride)
+{
+    run(input, stride, output, stride, num_samples, 1);
+}
+
+// Forward-backward filtering of every channel. The reverse passes index the data
+// backwards, so the caller's input is left untouched, and m_temp (channels packed at
+// m_max_samples) sits between the two directions so output may be the input itself.
+// A zero-phase pass can not be split into blocks, so longer signals are refused.
+int FilterBank::filtfilt(const double *input, double *output, int num_samples, int stride)
+{
+    if (num_samples > m_max_samples) return -1;
+
+    for (int i = 0; i < FILTFILT_PASSES; i++) run(input, stride, m_temp, m_max_samples, num_samples, -1);
+    for (int i = 0; i < FILTFILT_PASSES; i++) run(m_temp, m_max_samples, output, stride, num_samples, -1);
+
+    return 0;
+}
+
+FilterBank::~FilterBank()
+{
+    if (m_owns_memory) {
+        delete[] m_state;
+        delete[] m_temp;
+    }
+}
@@ -0,0 +1,83 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef FILTERBANK_H
+#define FILTERBANK_H
+
+#include "workspace.h"
+
+/* A BANK OF IDENTICAL IIR BIQUAD CASCADES, ONE PER CHANNEL
+ *
+ * Unlike sharing one filterIIR object between channels, every channel owns its
+ * own delay line, so no state leaks from one channel into the next.
+ * The state is stored struct-of-arrays: for each stage, s1 of all channels
+ * followed by s2 of all channels. A call loads it into locals once and writes
+ * it back at the end, so the sample loop touches only the signal in memory.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        FilterBank(IIR coefficients, # of stages, # of channels, max samples per call)
+        or, to carve the state from a pipeline workspace sized with FilterBank::workspace_Size():
+        FilterBank(IIR coefficients, # of stages, # of channels, max samples per call, &workspace)
+    2. Filter all channels at once, channel c starting at input + c * stride:
+        FilterBank.process(input, output, # of samples, stride)            // any # of samples
+        FilterBank.filtfilt(input, output, # of samples, stride)           // at most max samples,
+                                                                            // -1 and no output if longer
+ *
+ */
+
+class FilterBank
+{
+public:
+    FilterBank(const double *iirCoeffs, int stages, int channels, int max_samples, Workspace *workspace = 0);
+    ~FilterBank();
+
+    // Doubles a bank of this shape takes from a Workspace
+    static int workspace_Size(int stages, int channels, int max_samples);
+
+    // Input is never modified; output may be the input itself
+    void process(const double *input, double *output, int num_samples, int stride);
+    int filtfilt(const double *input, double *output, int num_samples, int stride);
+    void reset();
+
+    int channels() const { return m_channels; }
+
+private:
+    // Runs every channel through the cascade; step is +1 (forward) or -1 (reverse indexing).
+    // Reverse runs need an output separate from the input.
+    void run(const double *input, int in_stride, double *output, int out_stride, int num_samples, int step);
+
+    const double *m_iirCoeffs;
+    int m_stages;
+    int m_channels;
+    int m_max_samples;
+
+    // Transposed form 2 delay lines, [stage][s1 | s2][channel]
+    double *m_state;
+    double *m_temp;
+    bool m_owns_memory;
+
+};
+
+#endif // FILTERBANK_H
@@ -35,11 +35,18 @@
        ...
 */
 
-filterIIR::filterIIR(double *iirCoeffs, int stages)
+filterIIR::filterIIR(const double *iirCoeffs, int stages)
 {
 
     m_iirCoeffs = iirCoeffs;
     m_stages = stages;
+
+    buffer0 = new double[m_stages];
+    buffer1 = new double[m_stages];
+    buffer2 = new double[m_stages];
+    data_reversed = 0;
+    data_reversed_size = 0;
+
     for (int j = 0; j < m_stages; j++) { // Init the shift registers.
         buffer0[j] = 0.0;
         buffer1[j] = 0.0;
@@ -65,13 +72,15 @@ double filterIIR::SectCalcForm2(int k, double x)
 
 // Form 2 Biquad
 // This uses one set of shift registers, buffer0, buffer1, and buffer2 in the center.
-void filterIIR::RunIIRBiquadForm2(double *Input, double *Output, int NumSigPts)
+// Step = -1 runs over the input backwards, so reversing needs no copy.
+void filterIIR::RunIIRBiquadForm2(const double *Input, double *Output, int NumSigPts, int Step)
 {
     double y;
     int j, k;
+    const double *x = (Step < 0) ? Input + NumSigPts - 1 : Input;
 
-    for (j = 0; j < NumSigPts; j++) {
-        y = SectCalcForm2(0, Input[j]);
+    for (j = 0; j < NumSigPts; j++, x += Step) {
+        y = SectCalcForm2(0, *x);
         for (k = 1; k < m_stages; k++) {
             y = SectCalcForm2(k, y);
         }
@@ -80,15 +89,26 @@ void filterIIR::RunIIRBiquadForm2(double *Input, double *Output, int NumSigPts)
 }
 
 
-void filterIIR::filtfilt(double *data, double *data_out, int filter_size)
+// Reverse passes index backwards instead of reversing buffers, so data is left as it was
+// and data_out may be data itself.
+void filterIIR::filtfilt(const double *data, double *data_out, int filter_size)
 {
-    double data_reversed[10000];
+    if (filter_size > data_reversed_size) {
+        delete[] data_reversed;
+        data_reversed = new double[filter_size];
+        data_reversed_size = filter_size;
+    }
 
-    reverse(data, filter_size);
-    for (int i = 0; i < 20; i++) RunIIRBiquadForm2(data, data_reversed, filter_size);
+    for (int i = 0; i < 20; i++) RunIIRBiquadForm2(data, data_reversed, filter_size, -1);
+    for (int i = 0; i < 20; i++) RunIIRBiquadForm2(data_reversed, data_out, filter_size, -1);
+}
 
-    reverse(data_reversed, filter_size);
-    for (int i = 0; i < 20; i++) RunIIRBiquadForm2(data_reversed, data_out, filter_size);
+filterIIR::~filterIIR()
+{
+    delete[] buffer0;
+    delete[] buffer1;
+    delete[] buffer2;
+    delete[] data_reversed;
 }
 
 void filterIIR::reverse(double arr[], int count)
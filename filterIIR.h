@@ -25,17 +25,28 @@
 class filterIIR
 {
 public:
-    filterIIR(double *iirCoeffs, int stages);
+    filterIIR(const double *iirCoeffs, int stages);
+    ~filterIIR();
 
+    // Input is never modified. Output may be the same buffer as Input, except for Step = -1
+    // which reads Input backwards (from Input[NumSigPts - 1] down to Input[0])
     double SectCalcForm2(int k, double x);
-    void RunIIRBiquadForm2(double *Input, double *Output, int NumSigPts);
-    void filtfilt(double *data, double *data_out, int filter_size);
+    void RunIIRBiquadForm2(const double *Input, double *Output, int NumSigPts, int Step = 1);
+    void filtfilt(const double *data, double *data_out, int filter_size);
     void reverse(double arr[], int count);
 
 private:
-    double *m_iirCoeffs;
+    filterIIR(const filterIIR &);
+    filterIIR &operator=(const filterIIR &);
+
+    const double *m_iirCoeffs;
     int m_stages;
 
-    double buffer0[100], buffer1[100], buffer2[100];
+    // Shift registers, one per stage
+    double *buffer0, *buffer1, *buffer2;
+
+    // Scratch for filtfilt, grown only when a longer signal comes in
+    double *data_reversed;
+    int data_reversed_size;
 
  };
@@ -0,0 +1,144 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "fixedFilterBank.h"
+#include <math.h>
+
+// Coefficient fraction bits, |coefficient| < 2
+const int FIXED_COEFF_FRAC = 30;
+
+// Frequency grid used to find the peak gain of a section
+const int FIXED_GAIN_POINTS = 1024;
+
+static inline int32_t saturate(int64_t x)
+{
+    if (x > INT32_MAX) return INT32_MAX;
+    if (x < INT32_MIN) return INT32_MIN;
+    return (int32_t) x;
+}
+
+// Peak of |H(e^jw)| of one b0, b1, b2, a1, a2 section
+static double peak_Gain(const double *c)
+{
+    double peak = 0.0;
+
+    for (int i = 0; i <= FIXED_GAIN_POINTS; i++) {
+        double w = M_PI * i / FIXED_GAIN_POINTS;
+        double nr = c[0] + c[1] * cos(w) + c[2] * cos(2 * w), ni = -c[1] * sin(w) - c[2] * sin(2 * w);
+        double dr = 1.0 + c[3] * cos(w) + c[4] * cos(2 * w), di = -c[3] * sin(w) - c[4] * sin(2 * w);
+        double gain = sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+        if (gain > peak) peak = gain;
+    }
+
+    return peak;
+}
+
+FixedFilterBank::FixedFilterBank(const double *iirCoeffs, int stages, int channels, int shift)
+{
+    m_stages = stages;
+    m_channels = channels;
+    m_shift = shift;
+    m_gain = 1.0;
+
+    m_coeffs = new int32_t[m_stages * 5];
+    m_frac = new int[m_stages];
+    m_state = new int32_t[m_stages * 6 * m_channels];
+
+    for (int k = 0; k < m_stages; k++) {
+        double c[5];
+        for (int i = 0; i < 5; i++) c[i] = iirCoeffs[k * 5 + i];
+
+        // Gain staging: the numerator carries the section to a peak gain of one
+        double peak = peak_Gain(c);
+        if (peak > 0.0) {
+            for (int i = 0; i < 3; i++) c[i] /= peak;
+            m_gain *= peak;
+        }
+
+        // Drop fraction bits until the largest coefficient fits
+        double largest = 0.0;
+        for (int i = 0; i < 5; i++) largest = fmax(largest, fabs(c[i]));
+
+        m_frac[k] = FIXED_COEFF_FRAC;
+        while (m_frac[k] > 0 && largest * (double) (1LL << m_frac[k]) >= 2147483647.0) m_frac[k]--;
+
+        for (int i = 0; i < 5; i++)
+            m_coeffs[k * 5 + i] = (int32_t) llround(c[i] * (double) (1LL << m_frac[k]));
+    }
+
+    reset();
+}
+
+void FixedFilterBank::reset()
+{
+    for (int i = 0; i < m_stages * 6 * m_channels; i++) m_state[i] = 0;
+}
+
+// Direct form I with second order error feedback, channel loop innermost as in FilterBank.
+// The rounding remainders e1, e2 of the last two samples go back in as 2 e1 - e2,
+// putting a double zero of the noise transfer at DC where the poles of our designs sit.
+void FixedFilterBank::process(const int32_t *input, int32_t *output, int num_samples, int stride)
+{
+    for (int j = 0; j < num_samples; j++) {
+        for (int c = 0; c < m_channels; c++)
+            output[c * stride + j] = saturate((int64_t) input[c * stride + j] * (1 << m_shift));
+
+        for (int k = 0; k < m_stages; k++) {
+            const int32_t *coeffs = m_coeffs + k * 5;
+            int frac = m_frac[k];
+            int32_t *x1 = m_state + k * 6 * m_channels;
+            int32_t *x2 = x1 + m_channels;
+            int32_t *y1 = x2 + m_channels;
+            int32_t *y2 = y1 + m_channels;
+            int32_t *e1 = y2 + m_channels;
+            int32_t *e2 = e1 + m_channels;
+
+            for (int c = 0; c < m_channels; c++) {
+                int32_t x = output[c * stride + j];
+                int64_t acc = (int64_t) coeffs[0] * x + (int64_t) coeffs[1] * x1[c] + (int64_t) coeffs[2] * x2[c]
+                            - (int64_t) coeffs[3] * y1[c] - (int64_t) coeffs[4] * y2[c]
+                            + 2 * (int64_t) e1[c] - e2[c];
+
+                // Floor to the data format, keeping the remainder for the next samples
+                int64_t y = acc >> frac;
+                e2[c] = e1[c];
+                e1[c] = (int32_t) (acc & ((1LL << frac) - 1));
+
+                x2[c] = x1[c];
+                x1[c] = x;
+                y2[c] = y1[c];
+                y1[c] = saturate(y);
+
+                output[c * stride + j] = y1[c];
+            }
+        }
+    }
+}
+
+FixedFilterBank::~FixedFilterBank()
+{
+    delete[] m_coeffs;
+    delete[] m_frac;
+    delete[] m_state;
+}
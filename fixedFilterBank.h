@@ -0,0 +1,82 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef FIXEDFILTERBANK_H
+#define FIXEDFILTERBANK_H
+
+#include <stdint.h>
+
+/* FIXED-POINT IIR BIQUAD CASCADE ON RAW ADC COUNTS, ONE STATE PER CHANNEL
+ *
+ * For boards without a fast double precision FPU. Samples are 32-bit integers
+ * holding the 24-bit ADS1299 counts shifted up by `shift` guard bits, and each
+ * section is a direct form I biquad with Q30 coefficients (fewer fraction bits
+ * for a section with coefficients of 2 or more) and a 64-bit accumulator.
+ * The rounding error of every section is fed back into its next samples (second
+ * order noise shaping), which keeps the low frequency poles quiet, and results
+ * saturate instead of wrapping.
+ * Each section is scaled to a peak gain of one so no stage loses precision or
+ * overflows; the gain taken out is returned by output_Scale() together with
+ * the shift, so the physical scaling happens once, at feature extraction:
+ *     physical = output * ADS1299_SCALE * output_Scale()
+ *
+ * HOW TO USE
+    1. Initialize object:
+        FixedFilterBank(IIR coefficients, # of stages, # of channels, guard bits - 6 pref)
+    2. Filter raw counts of all channels, channel c starting at input + c * stride:
+        FixedFilterBank.process(input counts, output, # of samples, stride);
+ *
+ */
+
+class FixedFilterBank
+{
+public:
+    FixedFilterBank(const double *iirCoeffs, int stages, int channels, int shift);
+    ~FixedFilterBank();
+
+    void process(const int32_t *input, int32_t *output, int num_samples, int stride);
+    void reset();
+
+    // Physical units per output LSB, relative to one input count
+    double output_Scale() const { return m_gain / (double) (1 << m_shift); }
+
+private:
+    FixedFilterBank(const FixedFilterBank &);
+    FixedFilterBank &operator=(const FixedFilterBank &);
+
+    int m_stages;
+    int m_channels;
+    int m_shift;
+    double m_gain;
+
+    // b0, b1, b2, a1, a2 per stage in Q(m_frac[stage])
+    int32_t *m_coeffs;
+    int *m_frac;
+
+    // [stage][x1 | x2 | y1 | y2 | e1 | e2][channel]
+    int32_t *m_state;
+
+};
+
+#endif // FIXEDFILTERBANK_H
@@ -0,0 +1,213 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "mainsNotch.h"
+#include <math.h>
+
+// Largest deviation from the nominal mains frequency we follow, in Hz
+const double MAINS_TRACK_RANGE = 1.0;
+
+// Fraction of the measured deviation applied per second of reference signal
+const double MAINS_TRACK_GAIN = 0.25;
+
+// Only track when the fundamental holds at least this fraction of the piece's power
+const double MAINS_TRACK_MIN_POWER = 0.05;
+
+// Harmonics are placed below this fraction of Nyquist
+const double MAINS_NYQUIST_MARGIN = 0.95;
+
+const int MAINS_MAX_HARMONICS = 8;
+
+// process() works through longer blocks in pieces of this size
+const int MAINS_MAX_SAMPLES = 4096;
+
+MainsNotch::MainsNotch(int Fs, double mains_freq, int channels, double bandwidth)
+{
+    m_Fs = Fs;
+    m_channels = channels;
+    m_nominal_freq = mains_freq;
+    m_freq = mains_freq;
+    m_bandwidth = bandwidth;
+
+    m_harmonics = 0;
+    while (m_harmonics < MAINS_MAX_HARMONICS &&
+           (m_harmonics + 1) * (mains_freq + MAINS_TRACK_RANGE) < MAINS_NYQUIST_MARGIN * Fs / 2.0)
+        m_harmonics++;
+
+    // Keep at least one section so an empty design still passes the signal through
+    m_coeffs = new double[5 * (m_harmonics > 0 ? m_harmonics : 1)];
+    update_Coeffs();
+
+    m_max_samples = MAINS_MAX_SAMPLES;
+    m_bank = new FilterBank(m_coeffs, m_harmonics > 0 ? m_harmonics : 1, m_channels, m_max_samples);
+    m_bypass = new double[m_channels * m_max_samples];
+
+    m_enabled = new int[m_channels];
+    for (int i = 0; i < m_channels; i++) m_enabled[i] = 1;
+
+    // A phase step of up to pi between pieces is +-Fs / (2 * length) Hz, twice the range
+    m_track_length = (int) (Fs / (4.0 * MAINS_TRACK_RANGE));
+    if (m_track_length < 1) m_track_length = 1;
+    m_track_buffer = new double[m_track_length];
+    m_track_fill = 0;
+    m_track_gain = MAINS_TRACK_GAIN * m_track_length / Fs;
+
+    m_reference = -1;
+    m_osc_phase = 0.0;
+    m_prev_angle = 0.0;
+    m_prev_valid = 0;
+}
+
+void MainsNotch::set_Channel_Enabled(int channel, int enabled)
+{
+    if (channel >= 0 && channel < m_channels) m_enabled[channel] = enabled;
+}
+
+void MainsNotch::set_Tracking(int reference_channel)
+{
+    m_reference = (reference_channel < m_channels) ? reference_channel : -1;
+    m_track_fill = 0;
+    m_prev_valid = 0;
+}
+
+/* Notch at w = 2 pi f / Fs with pole radius r set by the bandwidth:
+ *   H(z) = g (1 - 2 cos(w) z^-1 + z^-2) / (1 - 2 r cos(w) z^-1 + r^2 z^-2)
+ * where g normalizes the gain at DC to one.
+ */
+void MainsNotch::update_Coeffs()
+{
+    double r = 1.0 - M_PI * m_bandwidth / m_Fs;
+
+    if (m_harmonics == 0) {
+        m_coeffs[0] = 1.0;
+        m_coeffs[1] = m_coeffs[2] = m_coeffs[3] = m_coeffs[4] = 0.0;
+        return;
+    }
+
+    for (int k = 0; k < m_harmonics; k++) {
+        double cw = cos(2.0 * M_PI * m_freq * (k + 1) / m_Fs);
+        double g = (1.0 - 2.0 * r * cw + r * r) / (2.0 - 2.0 * cw);
+
+        m_coeffs[k * 5 + 0] = g;
+        m_coeffs[k * 5 + 1] = -2.0 * cw * g;
+        m_coeffs[k * 5 + 2] = g;
+        m_coeffs[k * 5 + 3] = -2.0 * r * cw;
+        m_coeffs[k * 5 + 4] = r * r;
+    }
+}
+
+// Collects the reference into pieces of m_track_length, measuring each one once full,
+// so the step between two measurements is always the same number of samples
+void MainsNotch::track(const double *reference, int num_samples)
+{
+    for (int i = 0; i < num_samples; i++) {
+        m_track_buffer[m_track_fill++] = reference[i];
+
+        if (m_track_fill == m_track_length) {
+            measure_Phase();
+            m_track_fill = 0;
+        }
+    }
+}
+
+// Phase of the fundamental against an oscillator running at the current estimate.
+// A steady drift of that phase between pieces is the frequency error.
+void MainsNotch::measure_Phase()
+{
+    const double *reference = m_track_buffer;
+    int num_samples = m_track_length;
+    double step = 2.0 * M_PI * m_freq / m_Fs;
+    double re = 0.0, im = 0.0, power = 0.0, mean = 0.0;
+
+    for (int i = 0; i < num_samples; i++) mean += reference[i];
+    mean /= num_samples;
+
+    for (int i = 0; i < num_samples; i++) {
+        double x = reference[i] - mean;
+        double phase = m_osc_phase + step * i;
+        re += x * cos(phase);
+        im -= x * sin(phase);
+        power += x * x;
+    }
+
+    m_osc_phase = fmod(m_osc_phase + step * num_samples, 2.0 * M_PI);
+
+    // Power of a tone with this DFT amplitude, against the piece's power
+    double tone = 2.0 * (re * re + im * im) / num_samples;
+    if (power <= 0.0 || tone < MAINS_TRACK_MIN_POWER * power) {
+        m_prev_valid = 0;
+        return;
+    }
+
+    double angle = atan2(im, re);
+
+    if (m_prev_valid) {
+        double delta = angle - m_prev_angle;
+        while (delta > M_PI) delta -= 2.0 * M_PI;
+        while (delta < -M_PI) delta += 2.0 * M_PI;
+
+        // Pieces are back to back, so their centers are num_samples apart
+        m_freq += m_track_gain * delta * m_Fs / (2.0 * M_PI * num_samples);
+
+        if (m_freq > m_nominal_freq + MAINS_TRACK_RANGE) m_freq = m_nominal_freq + MAINS_TRACK_RANGE;
+        if (m_freq < m_nominal_freq - MAINS_TRACK_RANGE) m_freq = m_nominal_freq - MAINS_TRACK_RANGE;
+
+        update_Coeffs();
+    }
+
+    m_prev_angle = angle;
+    m_prev_valid = 1;
+}
+
+void MainsNotch::process(double *data, int num_samples, int stride)
+{
+    for (int start = 0; start < num_samples; start += m_max_samples) {
+        int n = num_samples - start;
+        if (n > m_max_samples) n = m_max_samples;
+
+        if (m_reference >= 0) track(data + m_reference * stride + start, n);
+
+        // Channels which are not notched are put back after the bank has run
+        for (int c = 0; c < m_channels; c++) {
+            if (m_enabled[c]) continue;
+            for (int i = 0; i < n; i++) m_bypass[c * m_max_samples + i] = data[c * stride + start + i];
+        }
+
+        m_bank->process(data + start, data + start, n, stride);
+
+        for (int c = 0; c < m_channels; c++) {
+            if (m_enabled[c]) continue;
+            for (int i = 0; i < n; i++) data[c * stride + start + i] = m_bypass[c * m_max_samples + i];
+        }
+    }
+}
+
+MainsNotch::~MainsNotch()
+{
+    delete m_bank;
+    delete[] m_coeffs;
+    delete[] m_enabled;
+    delete[] m_bypass;
+    delete[] m_track_buffer;
+}
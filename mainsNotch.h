@@ -0,0 +1,97 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef MAINSNOTCH_H
+#define MAINSNOTCH_H
+
+#include "filterBank.h"
+
+/* STREAMING MAINS NOTCH FOR THE FUNDAMENTAL AND ITS HARMONICS
+ *
+ * One notch biquad per harmonic below Nyquist, run per channel through a
+ * FilterBank so it shares the cascade kernel of the other IIR stages.
+ * With tracking on, the phase of the fundamental on the reference channel is
+ * measured on back-to-back pieces of a fixed length, whatever the block sizes,
+ * against a local oscillator, and the notch frequencies follow the measured mains
+ * frequency within MAINS_TRACK_RANGE Hz. The pieces are short enough (Fs / (4 *
+ * range) samples) that a phase step between two of them is unambiguous up to
+ * twice that range.
+ * Disabled channels pass through unchanged.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        MainsNotch(Sampling Frequency, mains frequency - 50 or 60, # of channels, notch bandwidth in Hz)
+    2. Optionally choose the channels and tracking:
+        MainsNotch.set_Channel_Enabled(channel, 0 or 1);
+        MainsNotch.set_Tracking(reference channel or -1 for fixed frequency);
+    3. Filter contiguous blocks in place, channel c starting at data + c * stride:
+        MainsNotch.process(data, # of samples, stride);
+ *
+ */
+
+class MainsNotch
+{
+public:
+    MainsNotch(int Fs, double mains_freq, int channels, double bandwidth);
+    ~MainsNotch();
+
+    void process(double *data, int num_samples, int stride);
+    void set_Channel_Enabled(int channel, int enabled);
+    void set_Tracking(int reference_channel);
+
+    // Currently tracked mains frequency
+    double frequency() const { return m_freq; }
+
+private:
+    MainsNotch(const MainsNotch &);
+    MainsNotch &operator=(const MainsNotch &);
+
+    void update_Coeffs();
+    void track(const double *reference, int num_samples);
+    void measure_Phase();
+
+    int m_Fs;
+    int m_channels;
+    int m_harmonics;
+    double m_nominal_freq, m_freq, m_bandwidth;
+
+    // b0, b1, b2, a1, a2 per harmonic, shared with m_bank
+    double *m_coeffs;
+    FilterBank *m_bank;
+    int *m_enabled;
+    double *m_bypass;
+    int m_max_samples;
+
+    // Frequency tracking, on pieces of m_track_length reference samples
+    int m_reference;
+    double *m_track_buffer;
+    int m_track_length, m_track_fill;
+    double m_track_gain;
+    double m_osc_phase;
+    double m_prev_angle;
+    int m_prev_valid;
+
+};
+
+#endif // MAINSNOTCH_H
@@ -0,0 +1,146 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "overlapSaveFIR.h"
+#include <math.h>
+
+OverlapSaveFIR::OverlapSaveFIR(const double *taps, int num_taps, int channels, int block_size)
+{
+    m_taps = num_taps;
+    m_channels = channels;
+    m_block = block_size;
+
+    // Smallest power of two holding a block plus the filter history
+    m_size_fft = 1;
+    while (m_size_fft < m_block + m_taps - 1) m_size_fft *= 2;
+
+    int bins = m_size_fft / 2 + 1;
+
+    m_time = (double *) fftw_malloc(sizeof(double) * m_size_fft * m_channels);
+    m_freq = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * bins * m_channels);
+    m_filter_fft = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * bins);
+    m_history = new double[(m_taps - 1) * m_channels + 1];
+
+    // One plan for all channels, frames m_size_fft apart
+    plan_forward = fftw_plan_many_dft_r2c(1, &m_size_fft, m_channels,
+                                          m_time, NULL, 1, m_size_fft,
+                                          m_freq, NULL, 1, bins, FFTW_MEASURE);
+    plan_inverse = fftw_plan_many_dft_c2r(1, &m_size_fft, m_channels,
+                                          m_freq, NULL, 1, bins,
+                                          m_time, NULL, 1, m_size_fft, FFTW_MEASURE);
+
+    // Filter spectrum, with the 1/N of the inverse transform folded in
+    fftw_plan plan_filter = fftw_plan_dft_r2c_1d(m_size_fft, m_time, m_filter_fft, FFTW_ESTIMATE);
+    for (int i = 0; i < m_size_fft; i++) m_time[i] = (i < m_taps) ? taps[i] / m_size_fft : 0.0;
+    fftw_execute(plan_filter);
+    fftw_destroy_plan(plan_filter);
+
+    reset();
+}
+
+void OverlapSaveFIR::reset()
+{
+    for (int i = 0; i < (m_taps - 1) * m_channels; i++) m_history[i] = 0.0;
+}
+
+int OverlapSaveFIR::process(const double *input, double *output, int num_samples, int stride)
+{
+    if (num_samples % m_block) return -1;
+
+    for (int start = 0; start < num_samples; start += m_block)
+        process_Block(input + start, output + start, stride);
+
+    return num_samples;
+}
+
+void OverlapSaveFIR::process_Block(const double *input, double *output, int stride)
+{
+    int bins = m_size_fft / 2 + 1;
+    int keep = m_taps - 1;
+
+    // Frame: [history | new block | zero padding]
+    for (int c = 0; c < m_channels; c++) {
+        double *frame = m_time + c * m_size_fft;
+        double *history = m_history + c * keep;
+        const double *x = input + c * stride;
+
+        for (int i = 0; i < keep; i++) frame[i] = history[i];
+        for (int i = 0; i < m_block; i++) frame[keep + i] = x[i];
+        for (int i = keep + m_block; i < m_size_fft; i++) frame[i] = 0.0;
+
+        // The tail of this frame is the history of the next one
+        for (int i = 0; i < keep; i++) history[i] = frame[m_block + i];
+    }
+
+    fftw_execute(plan_forward);
+
+    for (int c = 0; c < m_channels; c++) {
+        fftw_complex *X = m_freq + c * bins;
+        for (int k = 0; k < bins; k++) {
+            double re = X[k][0] * m_filter_fft[k][0] - X[k][1] * m_filter_fft[k][1];
+            double im = X[k][0] * m_filter_fft[k][1] + X[k][1] * m_filter_fft[k][0];
+            X[k][0] = re;
+            X[k][1] = im;
+        }
+    }
+
+    fftw_execute(plan_inverse);
+
+    // Samples from index (taps - 1) on are free of wrap-around
+    for (int c = 0; c < m_channels; c++) {
+        const double *frame = m_time + c * m_size_fft + keep;
+        double *y = output + c * stride;
+        for (int i = 0; i < m_block; i++) y[i] = frame[i];
+    }
+}
+
+void OverlapSaveFIR::design_Bandpass(double *taps, int num_taps, double Fs, double f_Low, double f_High)
+{
+    double center = (num_taps - 1) / 2.0;
+    double fl = f_Low / Fs;
+    double fh = (f_High >= Fs / 2.0) ? 0.5 : f_High / Fs;
+
+    for (int n = 0; n < num_taps; n++) {
+        double t = n - center;
+        double h;
+
+        // Difference of two ideal low passes; a cutoff at Nyquist is an impulse
+        if (t == 0.0) h = 2.0 * (fh - fl);
+        else h = (sin(2.0 * M_PI * fh * t) - sin(2.0 * M_PI * fl * t)) / (M_PI * t);
+
+        double window = (num_taps > 1) ? 0.42 - 0.5 * cos(2.0 * M_PI * n / (num_taps - 1)) +
+                                         0.08 * cos(4.0 * M_PI * n / (num_taps - 1)) : 1.0;
+        taps[n] = h * window;
+    }
+}
+
+OverlapSaveFIR::~OverlapSaveFIR()
+{
+    fftw_destroy_plan(plan_forward);
+    fftw_destroy_plan(plan_inverse);
+    fftw_free(m_time);
+    fftw_free(m_freq);
+    fftw_free(m_filter_fft);
+    delete[] m_history;
+}
@@ -0,0 +1,91 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef OVERLAPSAVEFIR_H
+#define OVERLAPSAVEFIR_H
+
+#include <fftw3.h>
+
+/* LONG LINEAR-PHASE FIR FILTERING BY FFT OVERLAP-SAVE
+ *
+ * Every block of new samples is appended to the last (taps - 1) samples of its
+ * channel, transformed, multiplied with the filter spectrum and transformed back;
+ * the samples not affected by circular wrap-around are the filter output.
+ * All channels are transformed together through one batched FFTW plan.
+ * The output is delayed by (taps - 1) / 2 samples, see delay(), and has no
+ * phase distortion otherwise - the streaming counterpart of filtfilt.
+ *
+ * HOW TO USE
+    1. Design taps, e.g. with OverlapSaveFIR::design_Bandpass(taps, # of taps, Fs, f_Low, f_High)
+    2. Initialize object:
+        OverlapSaveFIR(taps, # of taps, # of channels, block size)
+    3. Filter whole blocks, channel c starting at input + c * stride:
+        OverlapSaveFIR.process(input, output, # of samples - a multiple of the block size, stride);
+ *
+ */
+
+class OverlapSaveFIR
+{
+public:
+    OverlapSaveFIR(const double *taps, int num_taps, int channels, int block_size);
+    ~OverlapSaveFIR();
+
+    int process(const double *input, double *output, int num_samples, int stride);
+    void reset();
+
+    // Group delay of the filter in samples
+    int delay() const { return (m_taps - 1) / 2; }
+    int block_Size() const { return m_block; }
+
+    // Blackman windowed-sinc designs, f_Low = 0 gives a low pass and f_High >= Fs/2 a high pass.
+    // num_taps should be odd.
+    static void design_Bandpass(double *taps, int num_taps, double Fs, double f_Low, double f_High);
+
+private:
+    OverlapSaveFIR(const OverlapSaveFIR &);
+    OverlapSaveFIR &operator=(const OverlapSaveFIR &);
+
+    void process_Block(const double *input, double *output, int stride);
+
+    int m_taps;
+    int m_channels;
+    int m_block;
+    int m_size_fft;
+
+    // Filter spectrum
+    fftw_complex *m_filter_fft;
+
+    // Per channel frames of m_size_fft samples and their spectra, channel after channel
+    double *m_time;
+    fftw_complex *m_freq;
+
+    // Last (taps - 1) input samples of every channel
+    double *m_history;
+
+    fftw_plan plan_forward;
+    fftw_plan plan_inverse;
+
+};
+
+#endif // OVERLAPSAVEFIR_H
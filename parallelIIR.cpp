@@ -0,0 +1,219 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "parallelIIR.h"
+#include "biquadCascade.h"
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Chunks shorter than this are not worth a thread
+const long long PARALLEL_MIN_CHUNK = 16384;
+
+// Chunks per thread, so uneven chunks still balance out
+const int PARALLEL_CHUNKS_PER_THREAD = 2;
+
+// The zero-input correction stops once the state drops below this fraction of where it started
+const double PARALLEL_STATE_TOLERANCE = 1e-15;
+
+// Check the state size every this many samples during correction
+const int PARALLEL_DECAY_CHECK = 64;
+
+// Cascade state is s1, s2 of stage 0, then of stage 1, ...
+// input == NULL runs the cascade on zeros.
+static void run_Chunk(const double *coeffs, int stages, double *state,
+                      const double *input, double *output, long long n)
+{
+    for (long long j = 0; j < n; j++) {
+        double y = input ? input[j] : 0.0;
+        for (int k = 0; k < stages; k++) y = biquad_Section(coeffs + k * 5, state[k * 2], state[k * 2 + 1], y);
+        output[j] = y;
+    }
+}
+
+// Adds the zero-input response of state to output, stopping once it has died out
+static void add_Decay(const double *coeffs, int stages, double *state, double *output, long long n)
+{
+    int order = stages * 2;
+    double start = 0.0;
+    for (int i = 0; i < order; i++) start = fmax(start, fabs(state[i]));
+    if (start == 0.0) return;
+
+    for (long long j = 0; j < n; j++) {
+        double y = 0.0;
+        for (int k = 0; k < stages; k++) y = biquad_Section(coeffs + k * 5, state[k * 2], state[k * 2 + 1], y);
+        output[j] += y;
+
+        if (j % PARALLEL_DECAY_CHECK == PARALLEL_DECAY_CHECK - 1) {
+            double size = 0.0;
+            for (int i = 0; i < order; i++) size = fmax(size, fabs(state[i]));
+            if (size < PARALLEL_STATE_TOLERANCE * start) return;
+        }
+    }
+}
+
+// c = a * b for square matrices of size n
+static void mat_Mul(const double *a, const double *b, double *c, int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            double sum = 0.0;
+            for (int k = 0; k < n; k++) sum += a[i * n + k] * b[k * n + j];
+            c[i * n + j] = sum;
+        }
+}
+
+// Runs task(0) ... task(count - 1) on up to `threads` threads
+template <typename Task>
+static void run_Parallel(int threads, int count, Task task)
+{
+    std::atomic<int> next(0);
+    std::vector<std::thread> pool;
+
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) task(i);
+    };
+
+    for (int t = 1; t < threads && t < count; t++) pool.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+}
+
+ParallelIIR::ParallelIIR(const double *iirCoeffs, int stages, int threads)
+{
+    m_stages = stages;
+    m_order = stages * 2;
+    m_threads = threads > 0 ? threads : (int) std::thread::hardware_concurrency();
+    if (m_threads < 1) m_threads = 1;
+
+    m_iirCoeffs = new double[m_stages * 5];
+    for (int i = 0; i < m_stages * 5; i++) m_iirCoeffs[i] = iirCoeffs[i];
+
+    // Column j is where a unit state j ends up after one sample of zero input
+    m_transition = new double[m_order * m_order];
+    double *state = new double[m_order];
+    double y;
+
+    for (int j = 0; j < m_order; j++) {
+        for (int i = 0; i < m_order; i++) state[i] = (i == j) ? 1.0 : 0.0;
+        run_Chunk(m_iirCoeffs, m_stages, state, NULL, &y, 1);
+        for (int i = 0; i < m_order; i++) m_transition[i * m_order + j] = state[i];
+    }
+
+    delete[] state;
+}
+
+void ParallelIIR::filter(const double *input, double *output, long long num_samples, int channels, long long stride)
+{
+    int order = m_order;
+
+    long long chunk = (num_samples + (long long) m_threads * PARALLEL_CHUNKS_PER_THREAD - 1) /
+                      ((long long) m_threads * PARALLEL_CHUNKS_PER_THREAD);
+    if (chunk < PARALLEL_MIN_CHUNK) chunk = PARALLEL_MIN_CHUNK;
+    int chunks = (int) ((num_samples + chunk - 1) / chunk);
+    if (chunks < 1) return;
+
+    // Pass 1: every chunk of every channel from zero state, keeping the end states
+    std::vector<double> end_state((size_t) channels * chunks * order, 0.0);
+
+    run_Parallel(m_threads, channels * chunks, [&](int task) {
+        int c = task / chunks, i = task % chunks;
+        long long start = i * chunk;
+        long long n = (start + chunk > num_samples) ? num_samples - start : chunk;
+
+        run_Chunk(m_iirCoeffs, m_stages, &end_state[((size_t) c * chunks + i) * order],
+                  input + c * stride + start, output + c * stride + start, n);
+    });
+
+    if (chunks == 1) return;
+
+    // Transition over a whole chunk, by repeated squaring
+    std::vector<double> power(order * order), base(m_transition, m_transition + order * order), temp(order * order);
+    for (int i = 0; i < order; i++)
+        for (int j = 0; j < order; j++) power[i * order + j] = (i == j) ? 1.0 : 0.0;
+
+    for (long long e = chunk; e > 0; e >>= 1) {
+        if (e & 1) {
+            mat_Mul(&power[0], &base[0], &temp[0], order);
+            power.swap(temp);
+        }
+        mat_Mul(&base[0], &base[0], &temp[0], order);
+        base.swap(temp);
+    }
+
+    // Prefix over chunks: state entering chunk i + 1 = chunk transition * state entering i + end state of i
+    std::vector<double> entry_state((size_t) channels * chunks * order, 0.0);
+
+    for (int c = 0; c < channels; c++)
+        for (int i = 0; i + 1 < chunks; i++) {
+            const double *s = &entry_state[((size_t) c * chunks + i) * order];
+            const double *f = &end_state[((size_t) c * chunks + i) * order];
+            double *next = &entry_state[((size_t) c * chunks + i + 1) * order];
+
+            for (int r = 0; r < order; r++) {
+                double sum = f[r];
+                for (int k = 0; k < order; k++) sum += power[r * order + k] * s[k];
+                next[r] = sum;
+            }
+        }
+
+    // Pass 2: add the response to the entry state, every chunk but the first
+    run_Parallel(m_threads, channels * (chunks - 1), [&](int task) {
+        int c = task / (chunks - 1), i = task % (chunks - 1) + 1;
+        long long start = i * chunk;
+        long long n = (start + chunk > num_samples) ? num_samples - start : chunk;
+
+        add_Decay(m_iirCoeffs, m_stages, &entry_state[((size_t) c * chunks + i) * order],
+                  output + c * stride + start, n);
+    });
+}
+
+// Reverses every channel in place, channels in parallel
+static void reverse_Channels(int threads, double *data, long long num_samples, int channels, long long stride)
+{
+    run_Parallel(threads, channels, [&](int c) {
+        double *x = data + c * stride;
+        for (long long i = 0; i < num_samples / 2; i++) {
+            double temp = x[i];
+            x[i] = x[num_samples - i - 1];
+            x[num_samples - i - 1] = temp;
+        }
+    });
+}
+
+// Zero phase: forward, then backward over the reversed result
+void ParallelIIR::filtfilt(const double *input, double *output, long long num_samples, int channels, long long stride)
+{
+    filter(input, output, num_samples, channels, stride);
+    reverse_Channels(m_threads, output, num_samples, channels, stride);
+    filter(output, output, num_samples, channels, stride);
+    reverse_Channels(m_threads, output, num_samples, channels, stride);
+}
+
+ParallelIIR::~ParallelIIR()
+{
+    delete[] m_iirCoeffs;
+    delete[] m_transition;
+}
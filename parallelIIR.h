@@ -0,0 +1,71 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef PARALLELIIR_H
+#define PARALLELIIR_H
+
+/* MULTI-THREADED IIR BIQUAD CASCADE FOR OFFLINE FILTERING OF LONG RECORDINGS
+ *
+ * The cascade is linear, so a long signal is cut into chunks which are all
+ * filtered at once from zero state. The true state entering each chunk is then
+ * found from the chunk end states with the cascade's state transition matrix
+ * raised to the chunk length (a short sequential prefix over chunks), and a
+ * second parallel pass adds the zero-input response of that state to the
+ * chunk. Because the filter is stable that response dies out, so the
+ * correction pass stops as soon as the state is negligible.
+ * Chunks of all channels share one pool of worker threads.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        ParallelIIR(IIR coefficients, # of stages, # of threads - 0 for all cores)
+    2. Filter whole channels from zero state, channel c starting at data + c * stride (may be in place):
+        ParallelIIR.filter(input, output, # of samples, # of channels, stride);
+        ParallelIIR.filtfilt(input, output, # of samples, # of channels, stride);
+ *
+ */
+
+class ParallelIIR
+{
+public:
+    ParallelIIR(const double *iirCoeffs, int stages, int threads);
+    ~ParallelIIR();
+
+    void filter(const double *input, double *output, long long num_samples, int channels, long long stride);
+    void filtfilt(const double *input, double *output, long long num_samples, int channels, long long stride);
+
+private:
+    ParallelIIR(const ParallelIIR &);
+    ParallelIIR &operator=(const ParallelIIR &);
+
+    int m_stages;
+    int m_order;
+    int m_threads;
+    double *m_iirCoeffs;
+
+    // One sample state transition of the whole cascade, m_order x m_order
+    double *m_transition;
+
+};
+
+#endif // PARALLELIIR_H
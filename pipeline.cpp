@@ -0,0 +1,556 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "pipeline.h"
+#include "filterBank.h"
+#include "fixedFilterBank.h"
+#include "polyphaseDecimator.h"
+#include "mainsNotch.h"
+#include "overlapSaveFIR.h"
+#include <algorithm>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+// IIR Coefficients
+extern double coeffs_hp[];
+extern double coeffs_hp_EOG[];
+extern double coeffs_lp[];
+extern double coeffs_sigma[];
+extern double coeffs_slow[];
+
+enum { STEP_DECIMATE, STEP_NOTCH, STEP_IIR, STEP_QIIR, STEP_FIR, STEP_FILTFILT };
+
+const int PIPELINE_DECIMATOR_TAPS = 16;
+const double PIPELINE_NOTCH_BANDWIDTH = 1.0;
+const int PIPELINE_FIXED_GUARD_BITS = 6;
+
+static const struct {
+    const char *name;
+    double *coeffs;
+    int stages;
+} pipeline_designs[] = {
+    { "hp", coeffs_hp, 1 },
+    { "lp", coeffs_lp, 6 },
+    { "hp_EOG", coeffs_hp_EOG, 18 },
+    { "sigma", coeffs_sigma, 4 },
+    { "slow", coeffs_slow, 4 },
+};
+
+static const char *pipeline_outputs[PIPELINE_OUTPUTS] = { "EEG", "EOG1", "EOG2", "EMG" };
+
+// Splits "name=arguments"
+static std::string stage_Name(const std::string &stage)
+{
+    return stage.substr(0, stage.find('='));
+}
+
+static std::string stage_Arguments(const std::string &stage)
+{
+    size_t pos = stage.find('=');
+    return (pos == std::string::npos) ? std::string() : stage.substr(pos + 1);
+}
+
+static int find_Design(const std::string &name)
+{
+    for (int i = 0; i < (int) (sizeof(pipeline_designs) / sizeof(pipeline_designs[0])); i++)
+        if (name == pipeline_designs[i].name) return i;
+
+    return -1;
+}
+
+Pipeline::Pipeline(int Fs, int block_size, int window_blocks)
+{
+    m_Fs = Fs;
+    m_block_size = block_size;
+    m_window_blocks = window_blocks;
+    m_window_size = block_size * window_blocks;
+
+    m_workspace = 0;
+    m_block = 0;
+    m_counts = 0;
+    m_window[0] = m_window[1] = 0;
+    m_filled = 0;
+
+    for (int i = 0; i < PIPELINE_OUTPUTS; i++) m_role_slot[i] = -1;
+}
+
+int Pipeline::iir_Design(const std::string &name, const double **coeffs, int *stages)
+{
+    int design = find_Design(name);
+    if (design < 0) return -1;
+
+    *coeffs = pipeline_designs[design].coeffs;
+    *stages = pipeline_designs[design].stages;
+    return 0;
+}
+
+std::string Pipeline::default_Config(char labels[][50], int first, int channels,
+                                     int decimation, double mains_freq, double mains_bandwidth)
+{
+    const char *chains[PIPELINE_EMG] = { "filtfilt=hp", "filtfilt=hp_EOG", "filtfilt=hp_EOG" };
+    std::ostringstream config;
+
+    for (int i = 0; i < PIPELINE_EMG && first + i < channels; i++)
+        config << labels[first + i]
+               << " decimate=" << decimation
+               << " notch=" << mains_freq << "," << mains_bandwidth
+               << " " << chains[i] << " filtfilt=lp output=" << pipeline_outputs[i] << "\n";
+
+    return config.str();
+}
+
+int Pipeline::parse(std::istream &config, char labels[][50], int channels)
+{
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(config, line)) {
+        line_number++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream tokens(line);
+        std::string label, stage;
+        if (!(tokens >> label)) continue;
+
+        std::ostringstream where;
+        where << "line " << line_number << ": ";
+
+        Slot slot;
+        slot.channel = -1;
+        slot.role = -1;
+        slot.rate = m_Fs;
+        slot.block_length = m_block_size;
+
+        for (int i = 0; i < channels; i++)
+            if (label == labels[i]) slot.channel = i;
+
+        if (slot.channel < 0) {
+            m_error = where.str() + "no channel labelled " + label;
+            return -1;
+        }
+
+        for (size_t i = 0; i < m_slots.size(); i++)
+            if (m_slots[i].channel == slot.channel) {
+                m_error = where.str() + "channel " + label + " has two chains";
+                return -1;
+            }
+
+        while (tokens >> stage) {
+            std::string name = stage_Name(stage);
+
+            if (name == "output") {
+                for (int i = 0; i < PIPELINE_OUTPUTS; i++)
+                    if (stage_Arguments(stage) == pipeline_outputs[i]) slot.role = i;
+
+                if (slot.role < 0 || m_role_slot[slot.role] >= 0) {
+                    m_error = where.str() + "bad or repeated " + stage;
+                    return -1;
+                }
+                m_role_slot[slot.role] = 0; // Placeholder until the slots are sorted
+
+            } else if (name == "filtfilt") {
+                slot.window_stages.push_back(stage);
+
+            } else if (name == "qiir") {
+                if (!slot.block_stages.empty() || !slot.window_stages.empty()) {
+                    m_error = where.str() + stage + " filters the raw counts, it must be the first stage";
+                    return -1;
+                }
+                slot.block_stages.push_back(stage);
+
+            } else if (name == "decimate" || name == "notch" || name == "iir" || name == "fir") {
+                if (!slot.window_stages.empty()) {
+                    m_error = where.str() + stage + " streams, it can not follow a window stage";
+                    return -1;
+                }
+                slot.block_stages.push_back(stage);
+
+            } else {
+                m_error = where.str() + "unknown stage " + stage;
+                return -1;
+            }
+        }
+
+        m_slots.push_back(slot);
+    }
+
+    if (m_slots.empty()) {
+        m_error = "no channel chains configured";
+        return -1;
+    }
+
+    return 0;
+}
+
+static bool slot_Order(const std::vector<std::string> &a_block, const std::vector<std::string> &a_window,
+                       const std::vector<std::string> &b_block, const std::vector<std::string> &b_window)
+{
+    if (a_block != b_block) return a_block < b_block;
+    return a_window < b_window;
+}
+
+// Groups slots running the same stage at the same chain position, with the same
+// rate and block length, into one step. Slots are sorted by chain, so such slots are neighbours.
+int Pipeline::compile_Steps(int window)
+{
+    for (size_t position = 0; ; position++) {
+        int found = 0;
+
+        for (size_t s = 0; s < m_slots.size(); ) {
+            const std::vector<std::string> &stages = window ? m_slots[s].window_stages : m_slots[s].block_stages;
+            if (position >= stages.size()) {
+                s++;
+                continue;
+            }
+
+            int samples = window ? m_window_blocks * m_slots[s].block_length : m_slots[s].block_length;
+
+            size_t end = s + 1;
+            while (end < m_slots.size()) {
+                const std::vector<std::string> &next = window ? m_slots[end].window_stages : m_slots[end].block_stages;
+                int next_samples = window ? m_window_blocks * m_slots[end].block_length : m_slots[end].block_length;
+
+                if (position >= next.size() || next[position] != stages[position] ||
+                        m_slots[end].rate != m_slots[s].rate || next_samples != samples) break;
+                end++;
+            }
+
+            Step step;
+            step.stage = stages[position];
+            step.first = s;
+            step.count = end - s;
+            step.samples = samples;
+            step.index = position;
+            step.bank = 0;
+            step.fixed_bank = 0;
+            step.decimators = 0;
+            step.notch = 0;
+            step.fir = 0;
+
+            std::string name = stage_Name(step.stage);
+            std::string arguments = stage_Arguments(step.stage);
+
+            if (name == "decimate") {
+                int factor = 0;
+                if (sscanf(arguments.c_str(), "%d", &factor) != 1 || factor < 1 || samples % factor) {
+                    m_error = step.stage + ": factor must divide the " + std::to_string(samples) + " samples per block";
+                    return -1;
+                }
+                step.type = STEP_DECIMATE;
+                for (size_t i = s; i < end; i++) {
+                    m_slots[i].rate /= factor;
+                    m_slots[i].block_length /= factor;
+                }
+
+            } else if (name == "notch") {
+                step.type = STEP_NOTCH;
+            } else if (name == "fir") {
+                step.type = STEP_FIR;
+            } else {
+                step.type = (name == "iir") ? STEP_IIR : (name == "qiir") ? STEP_QIIR : STEP_FILTFILT;
+                if (find_Design(arguments) < 0) {
+                    m_error = step.stage + ": unknown design, use hp, lp, hp_EOG, sigma or slow";
+                    return -1;
+                }
+            }
+
+            if (window) m_window_steps.push_back(step);
+            else m_block_steps.push_back(step);
+
+            found = 1;
+            s = end;
+        }
+
+        if (!found) return 0;
+    }
+}
+
+int Pipeline::create_Step(Step &step, int rate)
+{
+    std::string arguments = stage_Arguments(step.stage);
+    int stride = (step.type == STEP_FILTFILT) ? m_window_size : m_block_size;
+
+    switch (step.type) {
+    case STEP_DECIMATE: {
+        int factor = 1;
+        sscanf(arguments.c_str(), "%d", &factor);
+        step.decimators = new PolyphaseDecimator *[step.count];
+        for (int i = 0; i < step.count; i++)
+            step.decimators[i] = new PolyphaseDecimator(factor, PIPELINE_DECIMATOR_TAPS);
+        break;
+    }
+    case STEP_NOTCH: {
+        double freq = 0.0, bandwidth = PIPELINE_NOTCH_BANDWIDTH;
+        if (sscanf(arguments.c_str(), "%lf,%lf", &freq, &bandwidth) < 1 || freq <= 0.0 || bandwidth <= 0.0) {
+            m_error = step.stage + ": expected notch=<Hz>[,<bandwidth Hz>]";
+            return -1;
+        }
+        step.notch = new MainsNotch(rate, freq, step.count, bandwidth);
+        step.notch->set_Tracking(0);
+        break;
+    }
+    case STEP_FIR: {
+        double low = 0.0, high = 0.0;
+        int taps = 0;
+        if (sscanf(arguments.c_str(), "%lf,%lf,%d", &low, &high, &taps) != 3 || taps < 1) {
+            m_error = step.stage + ": expected fir=<low Hz>,<high Hz>,<taps>";
+            return -1;
+        }
+        double *coeffs = new double[taps];
+        OverlapSaveFIR::design_Bandpass(coeffs, taps, rate, low, high);
+        step.fir = new OverlapSaveFIR(coeffs, taps, step.count, step.samples);
+        delete[] coeffs;
+        break;
+    }
+    case STEP_QIIR: {
+        int design = find_Design(arguments);
+        step.fixed_bank = new FixedFilterBank(pipeline_designs[design].coeffs, pipeline_designs[design].stages,
+                                              step.count, PIPELINE_FIXED_GUARD_BITS);
+        break;
+    }
+    default: {
+        int design = find_Design(arguments);
+        step.bank = new FilterBank(pipeline_designs[design].coeffs, pipeline_designs[design].stages,
+                                   step.count, stride, m_workspace);
+        break;
+    }
+    }
+
+    return 0;
+}
+
+int Pipeline::load(std::istream &config, char labels[][50], int channels)
+{
+    destroy();
+
+    if (parse(config, labels, channels)) return -1;
+
+    // Identical chains next to each other, in the order they were given otherwise
+    std::vector<int> order(m_slots.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return slot_Order(m_slots[a].block_stages, m_slots[a].window_stages,
+                          m_slots[b].block_stages, m_slots[b].window_stages);
+    });
+
+    std::vector<Slot> sorted;
+    for (size_t i = 0; i < order.size(); i++) sorted.push_back(m_slots[order[i]]);
+    m_slots.swap(sorted);
+
+    for (size_t i = 0; i < m_slots.size(); i++)
+        if (m_slots[i].role >= 0) m_role_slot[m_slots[i].role] = i;
+
+    if (compile_Steps(0) || compile_Steps(1)) return -1;
+
+    // Size the workspace: block rows, two window buffers and the filter bank states
+    int slots = m_slots.size();
+    int size = Workspace::size_Of(slots * m_block_size) + 2 * Workspace::size_Of(slots * m_window_size);
+
+    for (size_t i = 0; i < m_block_steps.size(); i++)
+        if (m_block_steps[i].type == STEP_IIR) {
+            int design = find_Design(stage_Arguments(m_block_steps[i].stage));
+            size += FilterBank::workspace_Size(pipeline_designs[design].stages, m_block_steps[i].count, m_block_size);
+        }
+    for (size_t i = 0; i < m_window_steps.size(); i++) {
+        int design = find_Design(stage_Arguments(m_window_steps[i].stage));
+        size += FilterBank::workspace_Size(pipeline_designs[design].stages, m_window_steps[i].count, m_window_size);
+    }
+
+    m_workspace = new Workspace(size);
+    m_block = m_workspace->take(slots * m_block_size);
+    m_window[0] = m_workspace->take(slots * m_window_size);
+    m_window[1] = m_workspace->take(slots * m_window_size);
+
+    for (size_t i = 0; i < m_block_steps.size(); i++)
+        if (m_block_steps[i].type == STEP_QIIR && !m_counts) m_counts = new int32_t[slots * m_block_size];
+
+    // Rates going into each block step
+    std::vector<int> rate(slots, m_Fs);
+
+    for (size_t i = 0; i < m_block_steps.size(); i++) {
+        Step &step = m_block_steps[i];
+        if (create_Step(step, rate[step.first])) return -1;
+
+        if (step.type == STEP_DECIMATE)
+            for (int s = step.first; s < step.first + step.count; s++) rate[s] /= step.decimators[0]->factor();
+    }
+    for (size_t i = 0; i < m_window_steps.size(); i++)
+        if (create_Step(m_window_steps[i], m_slots[m_window_steps[i].first].rate)) return -1;
+
+    m_filled = 0;
+
+    return 0;
+}
+
+int Pipeline::push_Block(const int *data, int stride, double scale)
+{
+    int slots = m_slots.size();
+
+    for (int s = 0; s < slots; s++) {
+        const int *x = data + m_slots[s].channel * stride;
+        double *row = m_block + s * m_block_size;
+        for (int i = 0; i < m_block_size; i++) row[i] = ((double) x[i]) * scale;
+    }
+
+    // Streaming stages, in place on the block rows
+    for (size_t i = 0; i < m_block_steps.size(); i++) {
+        Step &step = m_block_steps[i];
+        double *rows = m_block + step.first * m_block_size;
+
+        switch (step.type) {
+        case STEP_DECIMATE:
+            for (int s = 0; s < step.count; s++)
+                step.decimators[s]->process(rows + s * m_block_size, step.samples, rows + s * m_block_size);
+            break;
+        case STEP_NOTCH:
+            step.notch->process(rows, step.samples, m_block_size);
+            break;
+        case STEP_IIR:
+            step.bank->process(rows, rows, step.samples, m_block_size);
+            break;
+        case STEP_QIIR: {
+            // First stage, so the counts come straight from the input and are scaled once, afterwards
+            int32_t *counts = m_counts + step.first * m_block_size;
+            for (int s = 0; s < step.count; s++) {
+                const int *x = data + m_slots[step.first + s].channel * stride;
+                for (int j = 0; j < step.samples; j++) counts[s * m_block_size + j] = x[j];
+            }
+            step.fixed_bank->process(counts, counts, step.samples, m_block_size);
+
+            double fixed_scale = scale * step.fixed_bank->output_Scale();
+            for (int s = 0; s < step.count; s++)
+                for (int j = 0; j < step.samples; j++)
+                    rows[s * m_block_size + j] = counts[s * m_block_size + j] * fixed_scale;
+            break;
+        }
+        case STEP_FIR:
+            step.fir->process(rows, rows, step.samples, m_block_size);
+            break;
+        }
+    }
+
+    // Append the block to the analysis window
+    for (int s = 0; s < slots; s++) {
+        int length = m_slots[s].block_length;
+        const double *row = m_block + s * m_block_size;
+        double *window = m_window[0] + s * m_window_size + m_filled * length;
+        for (int i = 0; i < length; i++) window[i] = row[i];
+    }
+
+    if (++m_filled < m_window_blocks) return 0;
+    m_filled = 0;
+
+    // Window stages, alternating between the two window buffers
+    for (size_t i = 0; i < m_window_steps.size(); i++) {
+        Step &step = m_window_steps[i];
+        step.bank->filtfilt(m_window[step.index % 2] + step.first * m_window_size,
+                            m_window[(step.index + 1) % 2] + step.first * m_window_size,
+                            step.samples, m_window_size);
+    }
+
+    return 1;
+}
+
+double *Pipeline::output(int role) const
+{
+    int s = m_role_slot[role];
+    if (s < 0 || !m_window[0]) return NULL;
+
+    return m_window[m_slots[s].window_stages.size() % 2] + s * m_window_size;
+}
+
+int Pipeline::output_Rate(int role) const
+{
+    return (m_role_slot[role] < 0) ? 0 : m_slots[m_role_slot[role]].rate;
+}
+
+int Pipeline::output_Length(int role) const
+{
+    return (m_role_slot[role] < 0) ? 0 : m_slots[m_role_slot[role]].block_length * m_window_blocks;
+}
+
+double *Pipeline::block_Output(int role) const
+{
+    int s = m_role_slot[role];
+    if (s < 0 || !m_block) return NULL;
+
+    return m_block + s * m_block_size;
+}
+
+int Pipeline::block_Length(int role) const
+{
+    return (m_role_slot[role] < 0) ? 0 : m_slots[m_role_slot[role]].block_length;
+}
+
+int Pipeline::output_Channel(int role) const
+{
+    return (m_role_slot[role] < 0) ? -1 : m_slots[m_role_slot[role]].channel;
+}
+
+int Pipeline::uses_Channel(int channel) const
+{
+    for (size_t i = 0; i < m_slots.size(); i++)
+        if (m_slots[i].channel == channel) return 1;
+
+    return 0;
+}
+
+void Pipeline::destroy()
+{
+    std::vector<Step> *lists[2] = { &m_block_steps, &m_window_steps };
+
+    for (int l = 0; l < 2; l++) {
+        for (size_t i = 0; i < lists[l]->size(); i++) {
+            Step &step = (*lists[l])[i];
+            delete step.bank;
+            delete step.fixed_bank;
+            delete step.notch;
+            delete step.fir;
+            if (step.decimators) {
+                for (int s = 0; s < step.count; s++) delete step.decimators[s];
+                delete[] step.decimators;
+            }
+        }
+        lists[l]->clear();
+    }
+
+    m_slots.clear();
+    for (int i = 0; i < PIPELINE_OUTPUTS; i++) m_role_slot[i] = -1;
+
+    delete m_workspace;
+    m_workspace = 0;
+    m_block = 0;
+    delete[] m_counts;
+    m_counts = 0;
+    m_window[0] = m_window[1] = 0;
+    m_error.clear();
+}
+
+Pipeline::~Pipeline()
+{
+    destroy();
+}
@@ -0,0 +1,157 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "workspace.h"
+
+class FilterBank;
+class FixedFilterBank;
+class PolyphaseDecimator;
+class MainsNotch;
+class OverlapSaveFIR;
+
+/* PER-CHANNEL SIGNAL PROCESSING CHAINS, READ FROM A CONFIGURATION
+ *
+ * Every line names a channel label followed by its chain of stages:
+ *
+ *     # <channel label> <stage> <stage> ... output=<EEG|EOG1|EOG2|EMG>
+ *     Fpz  notch=60,1 filtfilt=hp filtfilt=lp output=EEG
+ *
+ * Streaming stages run on every block as it arrives:
+ *     decimate=<factor>                  polyphase anti-alias decimation
+ *     notch=<Hz>[,<bandwidth Hz>]        mains notch with harmonics, tracking the mains frequency
+ *     iir=<design>                       causal IIR cascade: hp, lp, hp_EOG, sigma or slow (see IIR_Coeffs.cpp)
+ *     qiir=<design>                      the same cascade in fixed point (FixedFilterBank) on the raw
+ *                                        counts, only as the first stage of a chain
+ *     fir=<low Hz>,<high Hz>,<taps>      linear phase FIR by overlap-save
+ * Window stages run once window_blocks blocks have been collected:
+ *     filtfilt=<design>                  zero phase IIR cascade
+ *
+ * load() compiles the chains once: channels are ordered by chain, and neighbours
+ * running the same stage at the same point are fused into one multi-channel step.
+ * All buffers and filter states come from one workspace, so push_Block() does
+ * not allocate.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        Pipeline(Sampling Frequency, samples per block, blocks per analysis window)
+    2. Compile a configuration against the channel labels, -1 on error (see error()):
+        Pipeline.load(config stream, channel labels, # of channels);
+            -> Pipeline::default_Config(labels, first channel, # of channels, decimation, mains Hz, bandwidth)
+               gives the standard EEG, EOG1 and EOG2 chains from the first channel on
+    3. Feed every block of raw samples, channel c at data + c * stride:
+        IF Pipeline.push_Block(data, stride, physical scale) RETURNS 1:
+            the window of each output is ready in Pipeline.output(PIPELINE_EEG), ...
+        After every call, Pipeline.block_Output(role) holds the block after the streaming stages
+ *
+ */
+
+enum { PIPELINE_EEG, PIPELINE_EOG1, PIPELINE_EOG2, PIPELINE_EMG, PIPELINE_OUTPUTS };
+
+class Pipeline
+{
+public:
+    Pipeline(int Fs, int block_size, int window_blocks);
+    ~Pipeline();
+
+    int load(std::istream &config, char labels[][50], int channels);
+    static std::string default_Config(char labels[][50], int first, int channels,
+                                      int decimation, double mains_freq, double mains_bandwidth);
+    // Coefficients of an IIR design by name (hp, lp, hp_EOG, sigma, slow), -1 if unknown
+    static int iir_Design(const std::string &name, const double **coeffs, int *stages);
+    const std::string &error() const { return m_error; }
+
+    int push_Block(const int *data, int stride, double scale);
+
+    // Windows of the channels marked output=..., NULL if not configured
+    double *output(int role) const;
+    int output_Rate(int role) const;
+    int output_Length(int role) const;
+
+    // Latest block of an output after the streaming stages, after every push_Block
+    double *block_Output(int role) const;
+    int block_Length(int role) const;
+
+    // Input channel an output is taken from, -1 if not configured
+    int output_Channel(int role) const;
+    int uses_Channel(int channel) const;
+
+private:
+    Pipeline(const Pipeline &);
+    Pipeline &operator=(const Pipeline &);
+
+    struct Slot {
+        int channel;
+        int role;
+        std::vector<std::string> block_stages, window_stages;
+
+        // Rate and samples per block after the streaming stages
+        int rate;
+        int block_length;
+    };
+
+    struct Step {
+        std::string stage;
+        int type;
+        int first, count;   // consecutive slots
+        int samples;        // per slot, going in
+        int index;          // position in the window chain, picks the ping-pong buffer
+        FilterBank *bank;
+        FixedFilterBank *fixed_bank;
+        PolyphaseDecimator **decimators;
+        MainsNotch *notch;
+        OverlapSaveFIR *fir;
+    };
+
+    int parse(std::istream &config, char labels[][50], int channels);
+    int compile_Steps(int window);
+    int create_Step(Step &step, int rate);
+    void destroy();
+
+    int m_Fs;
+    int m_block_size;
+    int m_window_blocks;
+    int m_window_size;
+
+    std::vector<Slot> m_slots;
+    std::vector<Step> m_block_steps, m_window_steps;
+    int m_role_slot[PIPELINE_OUTPUTS];
+
+    Workspace *m_workspace;
+    double *m_block;
+    int32_t *m_counts;  // raw count rows of the qiir chains
+    double *m_window[2];
+    int m_filled;
+
+    std::string m_error;
+
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,116 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "polyphaseDecimator.h"
+#include <math.h>
+
+// Pass band edge relative to the output Nyquist frequency
+const double DECIMATOR_CUTOFF = 0.9;
+
+PolyphaseDecimator::PolyphaseDecimator(int factor, int taps_per_phase)
+{
+    m_factor = (factor < 1) ? 1 : factor;
+    m_taps = (taps_per_phase < 1) ? 1 : taps_per_phase;
+
+    m_coeffs = new double[m_factor * m_taps];
+    m_delay = new double[m_factor * m_taps * 2];
+
+    design_Filter();
+    reset();
+}
+
+void PolyphaseDecimator::design_Filter()
+{
+    int length = m_factor * m_taps;
+    double fc = DECIMATOR_CUTOFF * 0.5 / m_factor;
+    double center = (length - 1) / 2.0;
+    double *h = new double[length];
+    double sum = 0.0;
+
+    for (int n = 0; n < length; n++) {
+        double t = n - center;
+        double sinc = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        double window = (length > 1) ? 0.42 - 0.5 * cos(2.0 * M_PI * n / (length - 1)) +
+                                       0.08 * cos(4.0 * M_PI * n / (length - 1)) : 1.0;
+        h[n] = sinc * window;
+        sum += h[n];
+    }
+
+    // Unity gain at DC, then split into branches
+    for (int n = 0; n < length; n++) m_coeffs[(n % m_factor) * m_taps + n / m_factor] = h[n] / sum;
+
+    delete[] h;
+}
+
+void PolyphaseDecimator::reset()
+{
+    for (int i = 0; i < m_factor * m_taps * 2; i++) m_delay[i] = 0.0;
+    m_pos = 0;
+    m_phase = 0;
+}
+
+/*
+ * y[m] = sum over branches p of sum over l of h[l * factor + p] * x[(m - l) * factor - p]
+ * Input x[n] belongs to branch p = (-n) mod factor; the output is ready when branch 0 is fed.
+ */
+int PolyphaseDecimator::process(const double *input, int num_samples, double *output)
+{
+    int out = 0;
+
+    if (m_factor == 1) {
+        for (int i = 0; i < num_samples; i++) output[i] = input[i];
+        return num_samples;
+    }
+
+    for (int i = 0; i < num_samples; i++) {
+        // Branch p delay line: m_delay + p * m_taps * 2, newest sample at m_pos
+        double *line = m_delay + m_phase * m_taps * 2;
+        line[m_pos] = input[i];
+        line[m_pos + m_taps] = input[i];
+
+        if (m_phase == 0) {
+            double y = 0.0;
+            for (int p = 0; p < m_factor; p++) {
+                const double *coeffs = m_coeffs + p * m_taps;
+                const double *x = m_delay + p * m_taps * 2 + m_pos + m_taps;
+                for (int l = 0; l < m_taps; l++) y += coeffs[l] * x[-l];
+            }
+            output[out++] = y;
+
+            // Next sample goes to branch factor - 1 and the lines advance together
+            m_phase = m_factor - 1;
+            if (++m_pos == m_taps) m_pos = 0;
+        } else {
+            m_phase--;
+        }
+    }
+
+    return out;
+}
+
+PolyphaseDecimator::~PolyphaseDecimator()
+{
+    delete[] m_coeffs;
+    delete[] m_delay;
+}
@@ -0,0 +1,78 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef POLYPHASEDECIMATOR_H
+#define POLYPHASEDECIMATOR_H
+
+/* ANTI-ALIASED INTEGER DECIMATION, STREAMING ACROSS BLOCKS
+ *
+ * A windowed-sinc (Blackman) low pass of factor * taps_per_phase taps is split into
+ * `factor` polyphase branches. Every input sample is pushed into exactly one
+ * branch, and an output is formed once per `factor` inputs, so each input
+ * sample costs taps_per_phase multiplies instead of the full filter length.
+ * Branch delay lines and the commutator position carry over between calls,
+ * so a signal may be fed in blocks of any size.
+ * A factor of 1 passes samples through untouched.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        PolyphaseDecimator(decimation factor, taps per phase - 16 pref)
+    2. Feed a block, output holds at least (# of samples + factor - 1) / factor:
+        # of outputs = PolyphaseDecimator.process(input, # of samples, output);
+ *
+ */
+
+class PolyphaseDecimator
+{
+public:
+    PolyphaseDecimator(int factor, int taps_per_phase);
+    ~PolyphaseDecimator();
+
+    int process(const double *input, int num_samples, double *output);
+    void reset();
+
+    int factor() const { return m_factor; }
+
+private:
+    PolyphaseDecimator(const PolyphaseDecimator &);
+    PolyphaseDecimator &operator=(const PolyphaseDecimator &);
+
+    void design_Filter();
+
+    int m_factor;
+    int m_taps;
+
+    // Branch p holds h[p], h[p + factor], h[p + 2 * factor], ...
+    double *m_coeffs;
+
+    // Branch delay lines, stored twice over so a window of m_taps is always contiguous
+    double *m_delay;
+    int m_pos;
+
+    // Branch the next input sample goes to
+    int m_phase;
+
+};
+
+#endif // POLYPHASEDECIMATOR_H
@@ -31,17 +31,24 @@ const int f_Max = 35;
 #define BIN_TO_FREQ(x, N_FFT, Fs) int(x * Fs/N_FFT)
 
 
-remDetect::remDetect(int Fs, int size_fft, int size_window, int epoch_in_sec)
+remDetect::remDetect(int Fs, int size_fft, int size_window, int epoch_in_sec, int hop_in_sec)
 {
     // Set private size values
     m_Fs = Fs;
     m_size_fft = size_fft;
     m_size_window = size_window;
     m_Epoch = epoch_in_sec * Fs / m_size_window;
+    if (m_Epoch < 1) m_Epoch = 1;
+
+    // No hop means non-overlapping epochs, and the hop can not be longer than the epoch
+    m_Hop = hop_in_sec * Fs / m_size_window;
+    if (m_Hop < 1 || m_Hop > m_Epoch) m_Hop = m_Epoch;
 
     // Set counters to zero
     epoch_Counter = 0;
     rem_eog_Counter = 0;
+    m_head = 0;
+    m_filled = 0;
 
     // Zero out average values
     avg_SEFd = 0;
@@ -54,11 +61,17 @@ remDetect::remDetect(int Fs, int size_fft, int size_window, int epoch_in_sec)
     fft_data = new double[size_fft];
     hm_window = new double[size_window];
     plan_spectrum = fftw_plan_dft_r2c_1d(size_fft, fft_data, fft_output, FFTW_MEASURE);
+    for (int i = 0; i < size_fft; i++) fft_data[i] = 0; // Zero padding past the window, after FFTW_MEASURE used the array
 
     // Initalize variables for REM analysis
-    SEFd = new double[epoch_in_sec];
-    RP = new double[epoch_in_sec];
-    AP = new double[epoch_in_sec];
+    SEFd = new double[m_Epoch];
+    RP = new double[m_Epoch];
+    AP = new double[m_Epoch];
+    EOG_hit = new int[m_Epoch];
+    sum_SEFd = 0;
+    sum_RP = 0;
+    sum_AP = 0;
+    for (int i = 0; i < m_Epoch; i++) EOG_hit[i] = 0;
 
     // Initalize window function
     for (int i = 0; i < size_window; i++)
@@ -67,34 +80,45 @@ remDetect::remDetect(int Fs, int size_fft, int size_window, int epoch_in_sec)
 
 int remDetect::calc_Epoch(double *spectrum, int f_Start, int f_End)
 {
-    // Calculate SEFd
-    double m_SEF_sum = SEF_sum(spectrum, f_Start, f_End);
-    SEFd[epoch_Counter] = SEFx(spectrum, 95, f_Start, m_SEF_sum) - SEFx(spectrum, 50, f_Start, m_SEF_sum);
+    // Take the oldest sub-epoch out of the running sums once the epoch is full
+    if (m_filled == m_Epoch) {
+        sum_SEFd -= SEFd[m_head];
+        sum_RP   -= RP[m_head];
+        sum_AP   -= AP[m_head];
+    }
 
-    // Calculate Absolute and Relative power
-    RP[epoch_Counter] = relPower(spectrum, f_Start, f_End);
-    AP[epoch_Counter] = absPower(spectrum, f_Start, f_End);
+    calc_Features(spectrum, f_Start, f_End, &SEFd[m_head], &RP[m_head], &AP[m_head]);
+
+    sum_SEFd += SEFd[m_head];
+    sum_RP   += RP[m_head];
+    sum_AP   += AP[m_head];
+
+    // Advance the ring, and re-sum it once per lap so rounding errors of the
+    // running sums can not build up over a whole night
+    if (++m_head == m_Epoch) {
+        m_head = 0;
+        sum_SEFd = 0;
+        sum_RP = 0;
+        sum_AP = 0;
+        for (int i = 0; i < m_Epoch; i++) {
+            sum_SEFd += SEFd[i];
+            sum_RP   += RP[i];
+            sum_AP   += AP[i];
+        }
+    }
+    if (m_filled < m_Epoch) m_filled++;
 
     // Increment epoch counter, which corresponds to m_size_window/m_Fs seconds passed
     epoch_Counter++;
 
-    if (epoch_Counter == m_Epoch) {
-        // Reset global average values
+    // Decide once the first epoch is full, then every m_Hop sub-epochs
+    if (m_filled == m_Epoch && epoch_Counter >= m_Hop) {
         epoch_Counter = 0;
-        avg_SEFd = 0;
-        avg_AP = 0;
-        avg_RP = 0;
 
         // Calculate the final (averaged) values
-        for (int i = 0; i < m_Epoch; i++) {
-            avg_SEFd += SEFd[i];
-            avg_AP   += AP[i];
-            avg_RP   += RP[i];
-        }
-
-        avg_SEFd /= m_Epoch;
-        avg_AP /= m_Epoch;
-        avg_RP /= m_Epoch;
+        avg_SEFd = sum_SEFd / m_Epoch;
+        avg_AP = sum_AP / m_Epoch;
+        avg_RP = sum_RP / m_Epoch;
 
         return 1;
 
@@ -104,6 +128,17 @@ int remDetect::calc_Epoch(double *spectrum, int f_Start, int f_End)
     }
 }
 
+void remDetect::calc_Features(double *spectrum, int f_Start, int f_End, double *SEFd_out, double *RP_out, double *AP_out)
+{
+    // Calculate SEFd
+    double m_SEF_sum = SEF_sum(spectrum, f_Start, f_End);
+    *SEFd_out = SEFx(spectrum, 95, f_Start, m_SEF_sum) - SEFx(spectrum, 50, f_Start, m_SEF_sum);
+
+    // Calculate Absolute and Relative power
+    *RP_out = relPower(spectrum, f_Start, f_End);
+    *AP_out = absPower(spectrum, f_Start, f_End);
+}
+
 int remDetect::evaluate_REM_Epoch()
 {
     // If the SEFd value is bigger than the specified minimum
@@ -208,10 +243,24 @@ int remDetect::evaluate_EOG_REM_Epoch(double *EOG1, double *EOG2, double min_EOG
 
     // if the value is within the limit window then return 1, else 0
     // Typical value is: min = 1000 and max = 7000
-    if (avg_EOG_IP > min_EOG) {
-        rem_eog_Counter++;
-        return 1;
-    } else return 0;
+    // The hit goes into the slot of the sub-epoch being calculated, replacing the
+    // one that falls out of the epoch, so the counter covers the same epoch
+    int hit = (avg_EOG_IP > min_EOG) ? 1 : 0;
+    rem_eog_Counter += hit - EOG_hit[m_head];
+    EOG_hit[m_head] = hit;
+
+    return hit;
+}
+
+// Same counting as evaluate_EOG_REM_Epoch, from the saccades a SaccadeDetector found in
+// this sub-epoch. Called after evaluate_EOG_REM_Epoch, its hit replaces that one.
+int remDetect::evaluate_Saccade_REM_Epoch(int saccades, int min_saccades)
+{
+    int hit = (saccades >= min_saccades) ? 1 : 0;
+    rem_eog_Counter += hit - EOG_hit[m_head];
+    EOG_hit[m_head] = hit;
+
+    return hit;
 }
 
 // DEPRECATED: evaluate_WAKE_Epoch
@@ -228,10 +277,11 @@ remDetect::~remDetect()
 
     fftw_destroy_plan(plan_spectrum);
     fftw_free(fft_output);
-    delete hm_window;
-    delete fft_data;
+    delete[] hm_window;
+    delete[] fft_data;
 
-    delete SEFd;
-    delete RP;
-    delete AP;
+    delete[] SEFd;
+    delete[] RP;
+    delete[] AP;
+    delete[] EOG_hit;
 }
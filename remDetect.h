@@ -22,6 +22,9 @@
  */
 
 
+#ifndef REMDETECT_H
+#define REMDETECT_H
+
 #include <fftw3.h>
 #include <math.h>
 
@@ -33,7 +36,10 @@
  *
  * HOW TO USE THIS LIBRARY
     1. Initialize object:
-        remDetect(Sampling Frequency, FFT size, Window size, Epoch in seconds - 120s pref)
+        remDetect(Sampling Frequency, FFT size, Window size, Epoch in seconds - 120s pref, Hop in seconds)
+            -> Hop is how often an epoch-averaged decision is made. The epoch slides
+               by that much each time, so a hop of one Window size gives a fresh
+               decision every sub-epoch. Leave it out for non-overlapping epochs
     2. Set Analysis parameters:
         remDetect.set_limits(SEFd minimum, Absolute power maximum, Relative power min, Relative power max);
     3. Calculate magnitude spectrum:
@@ -42,12 +48,21 @@
         remDetect.calc_Epoch(FFT spectrum, 8, 16)
             -> 4a. IF THE ABOVE RETURNS 1:
                    EVALUATE REM_STAGE = remDetect.evaluate_REM_Epoch()
+            -> 4b. FOR THE FEATURES OF ONE SPECTRUM, WITHOUT TOUCHING THE EPOCH:
+                   remDetect.calc_Features(FFT spectrum, 8, 16, &SEFd, &RP, &AP)
+                   The spectrum may also come from a BandTracker, see bandTracker.h
+    5. (Optional) Count EOG activity once per sub-epoch, before step 4:
+        remDetect.evaluate_EOG_REM_Epoch(EOG1, EOG2, minimum)
+            -> rem_eog_Counter holds the number of hits within the current epoch,
+               do not reset it
+        or from the saccades of a SaccadeDetector (see saccadeDetector.h):
+        remDetect.evaluate_Saccade_REM_Epoch(saccades in the sub-epoch, minimum)
  *
  */
 
 class remDetect {
 public:
-    remDetect(int Fs, int size_fft, int size_window, int epoch_in_sec);
+    remDetect(int Fs, int size_fft, int size_window, int epoch_in_sec, int hop_in_sec = 0);
     ~remDetect();
 
     // Routine for calculating spectrum
@@ -55,9 +70,11 @@ public:
 
     // Callable functions
     int calc_Epoch(double *spectrum, int f_Start, int f_End);
+    void calc_Features(double *spectrum, int f_Start, int f_End, double *SEFd_out, double *RP_out, double *AP_out);
     int evaluate_REM_Epoch();
     void set_limits(double min_SEFd, double max_AP, double min_RP, double max_RP);
     int evaluate_EOG_REM_Epoch(double *EOG1, double *EOG2, double min_EOG);
+    int evaluate_Saccade_REM_Epoch(int saccades, int min_saccades);
     int evaluate_WAKE_Epoch(double *spectrum, int f_i1, int f_E1, float WAKE_THRESHOLD1, int f_i2, int f_E2, float WAKE_THRESHOLD2);
 
     // Output variables which are accessable
@@ -78,15 +95,23 @@ private:
     double absPower(double *spectrum, int f_Start, int f_End);
     double relPower(double *spectrum, int f_Start, int f_End);
 
-    // Variables for REM detection
+    // Variables for REM detection, ring buffers holding the last m_Epoch sub-epochs
     double *SEFd, *RP, *AP;
+    int *EOG_hit;
+
+    // Running sums over the ring buffers, and where the next sub-epoch goes
+    double sum_SEFd, sum_RP, sum_AP;
+    int m_head, m_filled;
 
     int m_size_window;
     int m_size_fft;
     int m_Fs;
     int m_Epoch;
+    int m_Hop;
 
     // Analysis parameters
     double m_min_SEFd, m_max_AP, m_min_RP, m_max_RP;
 
 };
+
+#endif // REMDETECT_H
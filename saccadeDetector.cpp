@@ -0,0 +1,177 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "saccadeDetector.h"
+#include "filterBank.h"
+#include <math.h>
+
+// Filter corners, velocity span and event timing
+const double SACCADE_HP_FREQ = 0.3;
+const double SACCADE_LP_FREQ = 20.0;
+const double SACCADE_SPAN_SEC = 0.020;
+const double SACCADE_WARMUP_SEC = 2.0;
+const double SACCADE_MIN_SEC = 0.020;
+const double SACCADE_MAX_SEC = 0.300;
+const double SACCADE_REFRACTORY_SEC = 0.150;
+
+// Velocity correlation of the two channels over the event, at most
+const double SACCADE_MAX_CORRELATION = -0.5;
+
+SaccadeDetector::SaccadeDetector(int Fs, int max_samples)
+{
+    m_Fs = Fs;
+    m_max_samples = max_samples;
+    set_limits(1500, 25);
+
+    // First order high-pass and second order Butterworth low-pass, bilinear transform
+    double k = tan(M_PI * SACCADE_HP_FREQ / Fs);
+    m_coeffs[0] = 1.0 / (1.0 + k);
+    m_coeffs[1] = -m_coeffs[0];
+    m_coeffs[2] = 0.0;
+    m_coeffs[3] = (k - 1.0) / (k + 1.0);
+    m_coeffs[4] = 0.0;
+
+    k = tan(M_PI * SACCADE_LP_FREQ / Fs);
+    double norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+    m_coeffs[5] = k * k * norm;
+    m_coeffs[6] = 2.0 * m_coeffs[5];
+    m_coeffs[7] = m_coeffs[5];
+    m_coeffs[8] = 2.0 * (k * k - 1.0) * norm;
+    m_coeffs[9] = (1.0 - M_SQRT2 * k + k * k) * norm;
+
+    m_filter = new FilterBank(m_coeffs, 2, 2, m_max_samples);
+    m_block = new double[2 * m_max_samples];
+
+    m_span = (int) (SACCADE_SPAN_SEC * Fs + 0.5);
+    if (m_span < 1) m_span = 1;
+    m_history = new double[2 * m_span];
+    for (int i = 0; i < 2 * m_span; i++) m_history[i] = 0.0;
+    m_pos = 0;
+    m_count = 0;
+
+    m_warmup = (int) (SACCADE_WARMUP_SEC * Fs);
+    m_min_duration = (int) (SACCADE_MIN_SEC * Fs + 0.5);
+    m_max_duration = (int) (SACCADE_MAX_SEC * Fs + 0.5);
+    m_refractory = (int) (SACCADE_REFRACTORY_SEC * Fs + 0.5);
+
+    m_active = 0;
+    m_refractory_end = 0;
+    m_events.reserve(16);
+}
+
+void SaccadeDetector::set_limits(double min_velocity, double min_amplitude)
+{
+    m_min_velocity = min_velocity;
+    m_min_amplitude = min_amplitude;
+}
+
+int SaccadeDetector::push(const double *EOG1, const double *EOG2, int num_samples)
+{
+    m_events.clear();
+
+    // The first samples set the electrode offsets, so the high-pass does not start on a step
+    if (m_count == 0 && num_samples > 0) {
+        m_offset[0] = EOG1[0];
+        m_offset[1] = EOG2[0];
+    }
+
+    double *x1 = m_block, *x2 = m_block + m_max_samples;
+    double *h1 = m_history, *h2 = m_history + m_span;
+    double scale = (double) m_Fs / m_span;
+
+    for (int done = 0; done < num_samples; done += m_max_samples) {
+        int n = num_samples - done;
+        if (n > m_max_samples) n = m_max_samples;
+
+        for (int i = 0; i < n; i++) {
+            x1[i] = EOG1[done + i] - m_offset[0];
+            x2[i] = EOG2[done + i] - m_offset[1];
+        }
+        m_filter->process(m_block, m_block, n, m_max_samples);
+
+        for (int i = 0; i < n; i++, m_count++) {
+            double v1 = (x1[i] - h1[m_pos]) * scale;
+            double v2 = (x2[i] - h2[m_pos]) * scale;
+            double start_level = h1[m_pos] - h2[m_pos];
+            h1[m_pos] = x1[i];
+            h2[m_pos] = x2[i];
+            if (++m_pos == m_span) m_pos = 0;
+
+            double v = v1 - v2;
+            double speed = fabs(v);
+            int direction = (v > 0) ? 1 : -1;
+
+            if (m_active) {
+                if (direction == m_event.direction && speed >= 0.5 * m_min_velocity) {
+                    m_event.duration++;
+                    if (speed > m_event.peak_velocity) m_event.peak_velocity = speed;
+                    m_level = x1[i] - x2[i];
+                    m_sum_12 += v1 * v2;
+                    m_sum_11 += v1 * v1;
+                    m_sum_22 += v2 * v2;
+                    continue;
+                }
+                end_Event();
+            }
+
+            if (m_count < m_warmup || m_count < m_refractory_end || speed < m_min_velocity) continue;
+
+            // Onset, the level a span ago is where the movement started from
+            m_active = 1;
+            m_event.onset = m_count;
+            m_event.duration = 1;
+            m_event.direction = direction;
+            m_event.peak_velocity = speed;
+            m_start_level = start_level;
+            m_level = x1[i] - x2[i];
+            m_sum_12 = v1 * v2;
+            m_sum_11 = v1 * v1;
+            m_sum_22 = v2 * v2;
+        }
+    }
+
+    return m_events.size();
+}
+
+void SaccadeDetector::end_Event()
+{
+    m_active = 0;
+    m_event.amplitude = (m_level - m_start_level) * m_event.direction;
+
+    double correlation = m_sum_12 / sqrt(m_sum_11 * m_sum_22 + 1e-300);
+
+    if (m_event.duration >= m_min_duration && m_event.duration <= m_max_duration &&
+        m_event.amplitude >= m_min_amplitude && correlation <= SACCADE_MAX_CORRELATION) {
+        m_events.push_back(m_event);
+        m_refractory_end = m_event.onset + m_event.duration + m_refractory;
+    }
+}
+
+SaccadeDetector::~SaccadeDetector()
+{
+    delete m_filter;
+    delete[] m_block;
+    delete[] m_history;
+}
@@ -0,0 +1,123 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+#ifndef SACCADEDETECTOR_H
+#define SACCADEDETECTOR_H
+
+#include <vector>
+
+class FilterBank;
+
+/* STREAMING SACCADE DETECTOR FOR THE TWO EOG CHANNELS
+ *
+ * Finds individual eye movements sample by sample, instead of one averaged
+ * -EOG1 * EOG2 product per window. Both channels are high-passed (0.3 Hz) and
+ * low-passed (20 Hz) causally, and the velocity of their difference (the eye
+ * movement) and of each channel is taken over 20 ms. An event starts once the
+ * difference moves faster than the minimum velocity and lasts while it keeps
+ * moving the same way at half that speed. It is a saccade if it took 20 to
+ * 300 ms, moved at least the minimum amplitude and the two channels moved
+ * against each other (velocity correlation below -0.5), which leaves out blinks
+ * and other movements common to both. After a saccade, onsets are ignored for
+ * 150 ms.
+ *
+ * A saccade is reported when it ends, a few samples of filter delay later; onset
+ * is the first sample over the threshold, counted from the first sample pushed.
+ * Amplitudes are in the units of the input (uV), velocities in units per second.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        SaccadeDetector(Sampling Frequency, max samples per push)
+    2. (Optional) Set the limits, defaults are 1500 uV/s and 25 uV:
+        SaccadeDetector.set_limits(min velocity, min amplitude);
+    3. Push both EOG channels as they arrive, any block size:
+        FOR i < SaccadeDetector.push(EOG1, EOG2, # of samples):
+            SaccadeDetector.event(i).onset, .duration, .amplitude, ...
+    4. Count them into the REM decision once per sub-epoch:
+        remDetect.evaluate_Saccade_REM_Epoch(saccades in the sub-epoch, minimum)
+ *
+ */
+
+struct SaccadeEvent {
+    long long onset;        // sample
+    int duration;           // samples
+    int direction;          // +1 towards EOG1 (EOG1 - EOG2 rises), -1 towards EOG2
+    double amplitude;       // change of EOG1 - EOG2
+    double peak_velocity;
+};
+
+class SaccadeDetector
+{
+public:
+    SaccadeDetector(int Fs, int max_samples);
+    ~SaccadeDetector();
+
+    void set_limits(double min_velocity, double min_amplitude);
+    int push(const double *EOG1, const double *EOG2, int num_samples);
+
+    // Saccades that ended in the last push
+    const SaccadeEvent &event(int i) const { return m_events[i]; }
+
+    int rate() const { return m_Fs; }
+    long long samples() const { return m_count; }
+
+private:
+    SaccadeDetector(const SaccadeDetector &);
+    SaccadeDetector &operator=(const SaccadeDetector &);
+
+    void end_Event();
+
+    int m_Fs;
+    int m_max_samples;
+    double m_min_velocity, m_min_amplitude;
+
+    // DC blocker and low-pass, both channels in one bank
+    double m_coeffs[5 * 2];
+    FilterBank *m_filter;
+    double *m_block;        // [EOG1 | EOG2] x m_max_samples
+    double m_offset[2];
+
+    // Filtered samples of the last velocity span, oldest at m_pos
+    int m_span;
+    double *m_history;      // [EOG1 | EOG2] x m_span
+    int m_pos;
+    long long m_count;
+
+    // Timing in samples
+    int m_warmup, m_min_duration, m_max_duration, m_refractory;
+
+    // Event being followed
+    int m_active;
+    SaccadeEvent m_event;
+    double m_start_level, m_level;
+    double m_sum_12, m_sum_11, m_sum_22;
+    long long m_refractory_end;
+
+    std::vector<SaccadeEvent> m_events;
+
+};
+
+#endif // SACCADEDETECTOR_H
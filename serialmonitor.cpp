@@ -24,37 +24,61 @@
 
 #include "serialmonitor.h"
 #include "edflib.h"
+#include "analysisConstants.h"
 #include <QtSerialPort/QSerialPort>
 #include <QCoreApplication>
 #include <iostream>
 #include <QStringList>
+#include <sstream>
+#include <cmath>
+#include <stdio.h>
 
 // Formula for impedance calculation - FUDGE CALCULATION
 #define IMP_CALC(x) (x * 1.5)/0.06
 
 const int SMP_FREQ = 250;
 const double ADS1299_SCALE = 0.02235174445530706111277;
+const int BDF_SAMPLE_BYTES = 3;
+const int MAX_CHANNELS = 8; // ADS1299 inputs, what the per-channel arrays and frames hold
+const int IMPEDANCE_DIG_MAX = 1000000;
 
 const int DATA_WINDOW = SMP_FREQ;
-const int REM_DATA_WINDOW = SMP_FREQ * 2;
-const int FFT_WINDOW = 512;
-const int EPOCH_SEC = 30;
+
+// ANALYSIS_FREQ and the REM settings are in analysisConstants.h, shared with tools/
+const int ANALYSIS_DECIMATION = SMP_FREQ / ANALYSIS_FREQ;
+const int ANALYSIS_CHANNELS = 3; // EEG, EOG1 and EOG2
+const int MAX_RECORD_SEC = 60;
 const int REM_COUNTER_THRESHOLD = 0;
-const int EOG_COUNTER_THRESHOLD = 2;
+const int EVENT_ANNOTATIONS_PER_SEC = 2; // Saccades, spindles and slow waves
+const int CUE_ANNOTATION_SEC = 2; // Stimulus onsets, stimuli are 2.5 s apart
+const int MAX_ANNOTATION_SIGNALS = 64; // edflib's limit
 
 // TIME CONSTANTS
 const int WINDOW_TRIGGER = 60 * 4;
 
-// Index calculation
-#define arr_REM(x, y) x + (y) * REM_DATA_WINDOW
+// Per-channel analysis chains, see pipeline.h
+const char PIPELINE_CONFIG[] = "pipeline.cfg";
+
+// Closed-loop stimulation, see stimulusScheduler.h. Measure both latencies for the setup at hand
+const double STIM_TARGET_PHASE_DEG = 0.0; // Up-state of the slow oscillation
+const double STIM_OUTPUT_LATENCY_SEC = 0.0; // DAC to the ear, the cue engine schedules for the DAC
+const double STIM_TRANSPORT_LATENCY_SEC = 0.03; // Sample taken to sample read
+const double STIM_COMMAND_LATENCY_SEC = 0.03; // 'O' written to the board output switching, under 50 ms
+const char STIM_CUE_FILE[] = "stim_cue.wav";
+
+// Sound output of the cues, see cueEngine.h
+const int CUE_RATE = 48000;
+const int CUE_CHANNELS = 2;
+const int CUE_FILE_RATE = 8000; // Mono, a WAV file's 4 GB last 74 h at it
+const double CUE_LATENCY_SEC = 0.01;
+const char REM_ALERT_FILE[] = "rem_alert.wav";
 
-// IIR Coefficients
-extern double coeffs_hp[];
-extern double coeffs_hp_EOG[];
-extern double coeffs_lp[];
+// Learned sleep staging model replacing the fixed rules, see sleepModel.h
+const char SLEEP_MODEL_FILE[] = "sleep_model.txt";
 
 // Character definitions
 const char CHAR_DATA = 'D';
+const char CHAR_DATA_RAW = 'R'; // Binary frame: 'R' + channels * 3 bytes, MSB first as read from the ADS1299
 const char CHAR_IMP = 'I';
 const char CHAR_EOW = ';';
 const char CHAR_EOTP = 0x17;
@@ -94,7 +118,7 @@ SerialMonitor::SerialMonitor(QObject *parent) :
     channel_analysis = 1;
     std::cout << "============================\n";
     std::cout << "Which channel is used for REM analysis? (EEG, EOG1, EOG2)\n"
-                 "Type in -1 to only record data\n"
+                 "Type in -1 to only record data, any channel # uses " << PIPELINE_CONFIG << " if it exists\n"
                  "Starting from Channel # >> ";
     std::cin >> channel_analysis;
     std::cout << "============================\n";
@@ -104,15 +128,19 @@ SerialMonitor::SerialMonitor(QObject *parent) :
     time_passed_sec = 0;
     stimulus_delay_on = -1;
     time_failsafe_btn = -1;
-    flag_REM_Ready = 0;
 
     // Clear out Impedance buffer
     for (int i = 0; i < 8; i++) impedanceBuffer[i] = 0;
+    stimulus = 0;
+    stimulus_output = 0;
+    stimulus_timer = 0;
+    audio = 0;
 
 
     // Initialize BDF file
     this->init_BDF_file();
 
+    int analysis_on = (channel_analysis > 0);
     if (channel_analysis > 0) {
         channel_analysis--;
 
@@ -131,24 +159,145 @@ SerialMonitor::SerialMonitor(QObject *parent) :
 
         disabled_Time_Window *= 3600;
 
+        int closed_loop = 0;
+        std::cout << "============================\n";
+        std::cout << "Play a sound cue on slow oscillation up-states during N2 and N3?\n"
+                     "(1 = yes, 2 = and switch the board output with it, 0 = no)\n>> ";
+        std::cin >> closed_loop;
+
+        std::string audio_device = "default";
+        std::cout << "============================\n";
+        std::cout << "Sound output? default, a device (ALSA ex) hw:0,0, Windows ex) 1), null, or a .wav file to record the cues to\n>> ";
+        std::cin >> audio_device;
+
         std::getchar();
 
-        // Initialize filter and REM detection objects
-        filter_hp = new filterIIR(coeffs_hp, 1);
-        filter_hp_EOG = new filterIIR(coeffs_hp_EOG, 18);
-        filter_lp = new filterIIR(coeffs_lp, 6);
-        rem_analysis = new remDetect(SMP_FREQ, FFT_WINDOW, REM_DATA_WINDOW, EPOCH_SEC);
-        signal_nf_buffer = new double[REM_DATA_WINDOW * 8];
+        // Per-channel processing chains: from PIPELINE_CONFIG if present, otherwise
+        // EEG, EOG1 and EOG2 from the selected channel on with the standard chains
+        pipeline = new Pipeline(SMP_FREQ, DATA_WINDOW, REM_DATA_WINDOW / (DATA_WINDOW / ANALYSIS_DECIMATION));
+        std::ifstream pipeline_file(PIPELINE_CONFIG);
+        int pipeline_error;
+
+        if (pipeline_file.is_open()) {
+            std::cout << "Loading analysis chains from " << PIPELINE_CONFIG << "\n";
+            pipeline_error = pipeline->load(pipeline_file, signalLabel, channels);
+        } else {
+            std::istringstream config(Pipeline::default_Config(signalLabel, channel_analysis, channels,
+                                                               ANALYSIS_DECIMATION, MAINS_FREQ, MAINS_BANDWIDTH));
+            pipeline_error = pipeline->load(config, signalLabel, channels);
+        }
+
+        if (pipeline_error) {
+            std::cerr << "Analysis chains: " << pipeline->error() << "\n";
+            discard_BDF_file();
+            exit(1);
+        }
+
+        // remDetect expects all three windows at the analysis rate, and so does an optional EMG
+        for (int i = 0; i < PIPELINE_OUTPUTS; i++) {
+            if (i >= ANALYSIS_CHANNELS && !pipeline->output(i)) continue;
+
+            if (pipeline->output_Rate(i) != ANALYSIS_FREQ || pipeline->output_Length(i) != REM_DATA_WINDOW) {
+                std::cerr << "Analysis chains need output=EEG, EOG1 and EOG2 (and EMG if any) at " << ANALYSIS_FREQ << " SPS\n";
+                discard_BDF_file();
+                exit(1);
+            }
+        }
+
+        // Cues are decoded up front and started on the frame they are due
+        int audio_sink = CueEngine::default_Sink();
+        int audio_rate = CUE_RATE, audio_channels = CUE_CHANNELS;
+
+        if (audio_device == "null") {
+            audio_sink = CUE_SINK_NULL;
+        } else if (audio_device.size() > 4 && audio_device.compare(audio_device.size() - 4, 4, ".wav") == 0) {
+            audio_sink = CUE_SINK_FILE;
+            audio_rate = CUE_FILE_RATE;
+            audio_channels = 1;
+            std::cout << "Recording the cues to " << audio_device << " for up to "
+                      << (int) (CUE_WAV_MAX_BYTES / (2.0 * audio_rate * audio_channels) / 3600) << " hours\n";
+        } else if (audio_sink == CUE_SINK_NULL) {
+            std::cerr << "Sound output: built without a sound device, the cues are silent\n";
+        }
+
+        // Without the device the cues stay timed and annotated, and the alarm still switches the output
+        audio = new CueEngine();
+        if (audio->open(audio_sink, audio_device, audio_rate, audio_channels, CUE_LATENCY_SEC)) {
+            std::cerr << "Sound output: " << audio->error() << ", the cues are silent\n";
+            if (audio_sink == CUE_SINK_FILE || audio->open(CUE_SINK_NULL, "", CUE_RATE, CUE_CHANNELS, CUE_LATENCY_SEC))
+                discard_BDF_file();
+                exit(1);
+        }
+        audio->set_Sample_Clock(SMP_FREQ, STIM_TRANSPORT_LATENCY_SEC);
+
+        alert_cue = audio->load(REM_ALERT_FILE);
+        if (alert_cue < 0) std::cerr << "REM alert: " << audio->error() << "\n";
+
+        // Stimuli are timed on the raw EEG as every sample arrives, not on the filtered blocks
+        if (closed_loop) {
+            stimulus = new StimulusScheduler(SMP_FREQ);
+            stimulus->set_Target(STIM_TARGET_PHASE_DEG);
+            stimulus->set_Latency(STIM_OUTPUT_LATENCY_SEC);
+            stimulus_channel = pipeline->output_Channel(PIPELINE_EEG);
+            stimulus_request = -1;
+
+            // The board output is sent ahead of the cue by its own latency, on the same plan
+            if (closed_loop == 2) {
+                stimulus_output = 1;
+                stimulus_timer = new QTimer(this);
+                stimulus_timer->setSingleShot(true);
+                stimulus_timer->setTimerType(Qt::PreciseTimer);
+                connect(stimulus_timer, SIGNAL(timeout()), this, SLOT(writeStimulus()));
+            }
+
+            stimulus_cue = audio->load(STIM_CUE_FILE);
+            if (stimulus_cue < 0) {
+                std::cerr << "Stimulus cue: " << audio->error() << "\n";
+                discard_BDF_file();
+                exit(1);
+            }
+        }
+
+        rem_analysis = new remDetect(ANALYSIS_FREQ, FFT_WINDOW, REM_DATA_WINDOW, EPOCH_SEC, EPOCH_HOP_SEC);
         fft_spectrum = new double[FFT_WINDOW/2];
 
         // Set parameters
-        rem_analysis->set_limits(4, 17, -15, -13);
+        rem_analysis->set_limits(REM_MIN_SEFD, REM_MAX_AP, REM_MIN_RP, REM_MAX_RP);
         // rem_analysis->set_limits(4, 19, -15, -13); // More sensitive
 
-        // Set up mp3 alert
-        rem_sound_Alert = new QSound("rem_alert.wav");
+        // EOG events sample by sample, on the EOG chains before their window stages
+        saccade_detector = new SaccadeDetector(ANALYSIS_FREQ, pipeline->block_Length(PIPELINE_EOG1));
+        saccade_detector->set_limits(SACCADE_MIN_VELOCITY, SACCADE_MIN_AMPLITUDE);
+        window_saccades = 0;
+
+        spindle_detector = new SpindleDetector(ANALYSIS_FREQ, pipeline->block_Length(PIPELINE_EEG));
+        slow_wave_detector = new SlowWaveDetector(ANALYSIS_FREQ, pipeline->block_Length(PIPELINE_EEG));
+
+        sleep_stager = new SleepStager(rem_analysis, ANALYSIS_FREQ, FFT_WINDOW, REM_DATA_WINDOW, EPOCH_SEC);
+        sleep_model = 0;
+
+        std::ifstream model_file(SLEEP_MODEL_FILE);
+        if (model_file.is_open()) {
+            sleep_model = new SleepModel();
+
+            if (sleep_model->load(model_file) || sleep_stager->set_Model(sleep_model)) {
+                std::cerr << "Sleep model " << SLEEP_MODEL_FILE << ": "
+                          << (sleep_model->error().empty() ? "does not fit the sleep stager" : sleep_model->error()) << "\n";
+                discard_BDF_file();
+                exit(1);
+            }
+            std::cout << "Scoring sleep stages with " << SLEEP_MODEL_FILE << "\n";
+        }
+
+        // Spectrum and features of every window, next to the recording for later use
+        feature_store = new FeatureStore();
+        if (feature_store->create(filename_BDF.toStdString() + ".features", ANALYSIS_FREQ, REM_DATA_WINDOW, FFT_WINDOW))
+            std::cerr << "Feature file: " << feature_store->error() << "\n";
 }
 
+    // Now that the analysis and stimulation are known, before the first data record
+    size_Annotations(analysis_on);
+
     std::cout << "============================\n";
     std::cout << "If nothing happens after this, power cycle the OpenLD board and try again. This is some random bug.\n";
     std::cout << "============================\n";
@@ -159,9 +308,53 @@ SerialMonitor::SerialMonitor(QObject *parent) :
 
 }
 
+// Sign extend a little endian 24 bit sample from the BDF record layout
+static inline int bdf_sample_to_int(const unsigned char *sample)
+{
+    int value = sample[0] | (sample[1] << 8) | (sample[2] << 16);
+    if (value & 0x800000) value -= 0x1000000;
+
+    return value;
+}
+
 void SerialMonitor::writeToText()
 {
-    while (DAQ->canReadLine()) {
+    // Everything read below arrived by now
+    double arrival = audio ? audio->now() : 0;
+
+    while (true) {
+        // Binary frames can contain '\n', so they are read by size instead of by line
+        char peek_char;
+        if (DAQ->peek(&peek_char, 1) == 1 && peek_char == CHAR_DATA_RAW) {
+            if (DAQ->bytesAvailable() < rawFrameSize) break;
+
+            unsigned char frame[MAX_CHANNELS * BDF_SAMPLE_BYTES + 1];
+            DAQ->read((char *) frame, rawFrameSize);
+
+            // Place each sample straight into the BDF record (channel-major, little endian)
+            for (int i = 0; i < channels; i++) {
+                unsigned char *src = frame + 1 + i * BDF_SAMPLE_BYTES;
+                unsigned char *dst = rawBuffer + (i * recordSamples + recordWindow * DATA_WINDOW + DataCounter) * BDF_SAMPLE_BYTES;
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
+            }
+
+            if (stimulus) {
+                unsigned char *eeg = rawBuffer + (stimulus_channel * recordSamples + recordWindow * DATA_WINDOW + DataCounter) * BDF_SAMPLE_BYTES;
+                stimulus->push(bdf_sample_to_int(eeg) * ADS1299_SCALE);
+            }
+
+            DataCounter++;
+            recordFilled++;
+            rawFrames++;
+
+            if (DataCounter == DATA_WINDOW) tick_Window();
+            continue;
+        }
+
+        if (!DAQ->canReadLine()) break;
+
         QString IncomingData = DAQ->readLine();
 
         char First_Char = IncomingData.at(0).toLatin1();
@@ -174,10 +367,13 @@ void SerialMonitor::writeToText()
 
             for (int i = 0; i < channels; i++) {
                 ProcessedData[i].remove(" ");
-                dataBuffer[DataCounter + i * SMP_FREQ] = (int) ProcessedData[i].toInt();
+                window_Data(i)[DataCounter] = (int) ProcessedData[i].toInt();
             }
 
+            if (stimulus) stimulus->push(window_Data(stimulus_channel)[DataCounter] * ADS1299_SCALE);
+
             DataCounter++;
+            recordFilled++;
 
         } else if (First_Char == CHAR_IMP && impedance_on) {
             IncomingData.remove(0, 1);
@@ -194,45 +390,262 @@ void SerialMonitor::writeToText()
         } else if (First_Char == CHAR_EOW) {
             if (DataCounter != 0) analysisfile << "ERROR: Data Counter = " << DataCounter << " != 0" << std::endl;
 
+            // Only the analysis channels are decoded from binary frames, the storage path stays in BDF layout
+            if (rawFrames && channel_analysis > 0) {
+                for (int ch = 0; ch < channels; ch++) {
+                    if (!pipeline->uses_Channel(ch)) continue;
+                    unsigned char *raw = rawBuffer + (ch * recordSamples + recordWindow * DATA_WINDOW) * BDF_SAMPLE_BYTES;
+                    for (int i = 0; i < DATA_WINDOW; i++)
+                        window_Data(ch)[i] = bdf_sample_to_int(raw + i * BDF_SAMPLE_BYTES);
+                }
+            }
+
             if (channel_analysis > 0) {
                 // Call analysis routine
                 do_REM_Analysis();
             }
 
-            // Write to BDF
-            for (int i = 0; i < channels; i++) edfwrite_digital_samples(BDFHandler, dataBuffer + SMP_FREQ * i);
-
+            // Impedance is sampled once per window
             if (impedance_on) {
-                for (int i = 0; i < channels; i++) edfwrite_digital_samples(BDFHandler, impedanceBuffer);
+                for (int i = 0; i < channels; i++) impedanceRecord[i * recordSeconds + recordWindow] = impedanceBuffer[i];
+            }
+
+            // Write to BDF once a whole data record has been accumulated
+            if (++recordWindow == recordSeconds) {
+                write_BDF_Record();
+                recordWindow = 0;
+                recordFilled = 0;
             }
         }
 
         // If we recieved DATA_WINDOW number of samples
-        if (DataCounter == DATA_WINDOW){
+        if (DataCounter == DATA_WINDOW) tick_Window();
+    }
+
+    if (audio) {
+        audio->sync((long long) time_passed_sec * DATA_WINDOW + DataCounter, arrival);
+        log_Cues();
+    }
+
+    if (stimulus) plan_Stimulus();
+}
+
+// Hands the stimuli that started to the scheduler, and annotates alarms at their onset
+void SerialMonitor::log_Cues()
+{
+    CueOnset onset;
+
+    while (audio->onset(onset)) {
+        if (stimulus && onset.request == stimulus_request) {
+            stimulus->fired(onset.sample);
+            stimulus_request = -1;
+
+        } else if (onset.cue == alert_cue && onset.sample >= 0) {
+            annotate_Cue((long long) onset.sample / ANALYSIS_DECIMATION, "Alert cue");
+        }
+    }
+}
+
+// Times the next stimulus with the samples just read, and logs the ones measured since
+void SerialMonitor::plan_Stimulus()
+{
+    double fire;
+
+    // Planned on the EEG samples, the cue engine's sample clock maps them to the DAC.
+    // A cue that already started can not be moved, its onset comes back through log_Cues()
+    int planned = stimulus->plan(audio->time_Sample(audio->now()), &fire);
+    if (planned && stimulus_request >= 0 && audio->cancel(stimulus_request) == 0) {
+        stimulus_request = -1;
+        if (stimulus_output) stimulus_timer->stop();
+    }
+    if (planned > 0 && stimulus_request < 0) {
+        stimulus_request = audio->schedule_Sample(stimulus_cue, fire);
+
+        // Written so the output switches when the cue reaches the subject
+        if (stimulus_output && stimulus_request >= 0) {
+            double send = audio->sample_Time(fire) + STIM_OUTPUT_LATENCY_SEC - STIM_COMMAND_LATENCY_SEC;
+            stimulus_timer->start(qMax(0, qRound((send - audio->now()) * 1000)));
+        }
+    }
+
+    StimulusResult result;
+    while (stimulus->measure(result)) {
+        char text[40];
+        snprintf(text, sizeof(text), "Stimulus %.0f deg", result.phase);
+        annotate_Cue(result.sample / ANALYSIS_DECIMATION, text);
+
+        analysisfile << "STIMULUS: " << (double) result.sample / SMP_FREQ << ", "
+                     << result.phase << ", "
+                     << result.error << ", "
+                     << result.latency << ", "
+                     << result.timer_error << std::endl;
+
+        m_guiConsole->update_Toolbar(QString("Stimulus %1 at %2 deg (error %3 deg, %4 ms)                ")
+                                     .arg(stimulus->stimuli())
+                                     .arg(QString::number(result.phase, 'f', 0))
+                                     .arg(QString::number(result.error, 'f', 0))
+                                     .arg(QString::number(result.latency * 1000, 'f', 0)));
+    }
+}
 
-            m_guiConsole->update_Time(QString("Tick tock Current Time: %1 (Elapsed Time: %2)")
-                                      .arg(start_time.toString("hh:mm:ss"))
-                                      .arg(QDateTime::fromTime_t(time_passed_sec).toUTC().toString("hh:mm:ss")));
-            m_guiConsole->update_display();
+// Board output of a planned stimulus, not measured: only the cue's onset comes back
+void SerialMonitor::writeStimulus()
+{
+    DAQ->write(QByteArray("O", 1));
+}
+
+void SerialMonitor::write_BDF_Record()
+{
+    if (rawFrames) {
+        if (impedance_on) {
+            unsigned char *imp = rawBuffer + channels * recordSamples * BDF_SAMPLE_BYTES;
+            for (int i = 0; i < channels * recordSeconds; i++) {
+                int value = qBound(0, impedanceRecord[i], IMPEDANCE_DIG_MAX);
+                imp[i * BDF_SAMPLE_BYTES + 0] = value & 0xff;
+                imp[i * BDF_SAMPLE_BYTES + 1] = (value >> 8) & 0xff;
+                imp[i * BDF_SAMPLE_BYTES + 2] = (value >> 16) & 0xff;
+            }
+        }
+
+        edf_blockwrite_digital_3byte_samples(BDFHandler, rawBuffer);
+        rawFrames = 0;
+
+    } else {
+        for (int i = 0; i < channels; i++) edfwrite_digital_samples(BDFHandler, dataBuffer + recordSamples * i);
+
+        if (impedance_on) {
+            for (int i = 0; i < channels; i++) edfwrite_digital_samples(BDFHandler, impedanceRecord + recordSeconds * i);
+        }
+    }
+}
 
-            // Update time variables
-            start_time = start_time.addSecs(1);
-            time_passed_sec++;
+// Writes the record still being accumulated, zero-padded, then closes the file.
+// Without it the samples and annotations since the last whole record are lost.
+void SerialMonitor::close_BDF_file()
+{
+    if (recordFilled > 0) {
+        for (int i = 0; i < channels; i++) {
+            if (rawFrames) {
+                unsigned char *raw = rawBuffer + i * recordSamples * BDF_SAMPLE_BYTES;
+                for (int j = recordFilled * BDF_SAMPLE_BYTES; j < recordSamples * BDF_SAMPLE_BYTES; j++) raw[j] = 0;
+            } else {
+                for (int j = recordFilled; j < recordSamples; j++) dataBuffer[i * recordSamples + j] = 0;
+            }
 
-            // Reset data counter
-            DataCounter = 0;
+            if (impedance_on)
+                for (int w = recordWindow; w < recordSeconds; w++) impedanceRecord[i * recordSeconds + w] = 0;
         }
+
+        write_BDF_Record();
+        recordFilled = 0;
     }
+
+    edfclose_file(BDFHandler);
+}
+
+// Setup failed after the file was opened: close it and remove it, it holds no data
+void SerialMonitor::discard_BDF_file()
+{
+    edfclose_file(BDFHandler);
+    remove(filename_BDF.toLatin1().data());
+}
+
+// edflib writes the annotation list in order at close, filling the annotation signals of one
+// data record after the other, so only the total over the recording has to fit. The signals
+// per record follow from the expected rates of what is on: nothing but the record times when
+// only recording, events and decisions with the analysis, and cue onsets at the stimulus rate
+// only with stimulation (otherwise just the REM alert)
+void SerialMonitor::size_Annotations(int analysis)
+{
+    double decision_rate = 0.0;
+    event_rate = cue_rate = 0.0;
+
+    if (analysis) {
+        decision_rate = 1.0 / EPOCH_HOP_SEC + 1.0 / EPOCH_SEC; // REM decisions and sleep stages
+        event_rate = EVENT_ANNOTATIONS_PER_SEC;
+        cue_rate = stimulus ? 1.0 / CUE_ANNOTATION_SEC : 1.0 / EPOCH_SEC;
+    }
+
+    int slots = qBound(1, (int) ceil((decision_rate + event_rate + cue_rate) * recordSeconds), MAX_ANNOTATION_SIGNALS);
+
+    // Past edflib's limit, the events give way
+    event_rate = qMin(event_rate, qMax(0.0, (double) slots / recordSeconds - decision_rate - cue_rate));
+
+    events_written = cues_written = 0;
+    edf_set_number_of_annotation_signals(BDFHandler, slots);
+}
+
+// Seconds of signal the file will hold once the record being accumulated is written
+double SerialMonitor::annotated_Seconds() const
+{
+    return (double) (time_passed_sec / recordSeconds + 1) * recordSeconds;
+}
+
+// Annotates an event found at the analysis rate, as long as the events so far stay within event_rate
+void SerialMonitor::annotate_Event(long long onset, int duration, const char *text)
+{
+    if (events_written >= event_rate * annotated_Seconds()) return;
+
+    events_written++;
+    edfwrite_annotation_latin1(BDFHandler, onset * 10000LL / ANALYSIS_FREQ, duration * 10000LL / ANALYSIS_FREQ, text);
+}
+
+// Annotates a cue at its onset at the analysis rate, from the share kept for cues so events can not crowd it out
+void SerialMonitor::annotate_Cue(long long onset, const char *text)
+{
+    if (cues_written >= cue_rate * annotated_Seconds()) return;
+
+    cues_written++;
+    edfwrite_annotation_latin1(BDFHandler, onset * 10000LL / ANALYSIS_FREQ, 0, text);
+}
+
+// Current window of a channel inside the data record being accumulated
+int *SerialMonitor::window_Data(int channel)
+{
+    return dataBuffer + channel * recordSamples + recordWindow * DATA_WINDOW;
+}
+
+void SerialMonitor::tick_Window()
+{
+    m_guiConsole->update_Time(QString("Tick tock Current Time: %1 (Elapsed Time: %2)")
+                              .arg(start_time.toString("hh:mm:ss"))
+                              .arg(QDateTime::fromTime_t(time_passed_sec).toUTC().toString("hh:mm:ss")));
+    m_guiConsole->update_display();
+
+    // Update time variables
+    start_time = start_time.addSecs(1);
+    time_passed_sec++;
+
+    // Reset data counter
+    DataCounter = 0;
 }
 
 SerialMonitor::~SerialMonitor()
 {
     DAQ->close();
-    edfclose_file(BDFHandler);
+    close_BDF_file();
     m_guiConsole->~guiConsole();
 
     if (channel_analysis > 0) {
         rem_analysis->~remDetect();
+        delete saccade_detector;
+        delete spindle_detector;
+        delete slow_wave_detector;
+
+        if (stimulus) {
+            analysisfile << "STIMULUS SUMMARY: " << stimulus->stimuli() << " stimuli, phase error "
+                         << stimulus->mean_Error() << " +- " << stimulus->error_SD() << " deg, latency "
+                         << stimulus->mean_Latency() << " s, onset error " << stimulus->mean_Timer_Error()
+                         << " s (max " << stimulus->max_Timer_Error() << " s)" << std::endl;
+            delete stimulus;
+        }
+        delete audio;
+
+        delete sleep_stager;
+        delete sleep_model;
+        delete feature_store; // After the BDF file, so tools see it as newer
+        delete pipeline;
+        delete[] fft_spectrum;
         analysisfile.close();
     }
 }
@@ -242,21 +655,46 @@ void SerialMonitor::init_BDF_file()
     filename_BDF = QDateTime::currentDateTime().toString("'data_'yyyy-MM-dd'_T'hh-mm'.bdf'");
 
     channels = 1;
-    std::cout << "How many channels are there? (Prepend '-' to disable Impedance Monitoring - Active Electrodes)\n>> ";
+    std::cout << "How many channels are there? (1 - " << MAX_CHANNELS << ", prepend '-' to disable Impedance Monitoring - Active Electrodes)\n>> ";
     std::cin >> channels;
 
-    if (channels < 0) {
-        impedance_on = 0;
-        channels *= -1;
+    impedance_on = (channels >= 0);
+    channels = qBound(1, qAbs(channels), MAX_CHANNELS);
+
+    if (!impedance_on) {
         BDFHandler = edfopen_file_writeonly(filename_BDF.toLatin1().data(), EDFLIB_FILETYPE_BDFPLUS, channels);
 
     } else {
-        impedance_on = 1;
         BDFHandler = edfopen_file_writeonly(filename_BDF.toLatin1().data(), EDFLIB_FILETYPE_BDFPLUS, channels * 2);
     }
 
-    std::cout << "Recording " << channels << " channels at " << SMP_FREQ << " SPS\n";
-    dataBuffer = new int [channels * DATA_WINDOW]; // Allocate memory for the buffer
+    // Longer data records mean fewer per-record calls, TAL's and flushes for long recordings
+    recordSeconds = 1;
+    std::cout << "Data record duration in seconds? (1 - " << MAX_RECORD_SEC << ", BDF default is 1)\n>> ";
+    std::cin >> recordSeconds;
+    recordSeconds = qBound(1, recordSeconds, MAX_RECORD_SEC);
+
+    int recordFlush = 1;
+    std::cout << "How many data records to buffer before writing to disk? (1 = every record)\n>> ";
+    std::cin >> recordFlush;
+    recordFlush = qMax(1, recordFlush);
+
+    edf_set_datarecord_duration(BDFHandler, recordSeconds * 100000); // Unit is 10 uS
+    edf_set_flush_interval(BDFHandler, recordFlush);
+
+    std::cout << "Recording " << channels << " channels at " << SMP_FREQ << " SPS, "
+              << recordSeconds << " s per data record\n";
+
+    recordSamples = SMP_FREQ * recordSeconds;
+    recordWindow = 0;
+    recordFilled = 0;
+    dataBuffer = new int [channels * recordSamples]; // Allocate memory for the buffer
+    impedanceRecord = new int [channels * recordSeconds];
+
+    // One BDF data record for binary frames: every data channel, then the impedance channels
+    rawFrameSize = 1 + channels * BDF_SAMPLE_BYTES;
+    rawFrames = 0;
+    rawBuffer = new unsigned char [(channels * recordSamples + (impedance_on ? channels * recordSeconds : 0)) * BDF_SAMPLE_BYTES];
 
 
     // Channel setup for channels on data stream
@@ -264,7 +702,7 @@ void SerialMonitor::init_BDF_file()
         std::cout << "Enter Channel " << i + 1 << " Label: ";
         std::cin >> signalLabel[i];
         edf_set_label(BDFHandler, i, signalLabel[i]);
-        edf_set_samplefrequency(BDFHandler, i, SMP_FREQ);
+        edf_set_samplefrequency(BDFHandler, i, recordSamples); // Samples per data record
         // Range: +VREF = 4.5/24 * 1000000 and -VREF = -1 * +VREF * 2^23/(2^23 - 1)
         edf_set_physical_maximum(BDFHandler, i, (double) +187.5 * 1000.0);
         edf_set_physical_minimum(BDFHandler, i, (double) -187.5 * 1000.0 * 1.000000119);
@@ -276,10 +714,12 @@ void SerialMonitor::init_BDF_file()
     // Channel setup for channels on impedance logging
     if (impedance_on) {
         for (int i = channels; i < channels * 2; i++){
-            strcat(signalLabel[i - channels], "_Impedance");
-            std::cout << "Impedance label: " << signalLabel[i - channels] << "\n";
-            edf_set_label(BDFHandler, i, signalLabel[i - channels]);
-            edf_set_samplefrequency(BDFHandler, i, 1);
+            // Keep signalLabel intact, the analysis chains are matched against it
+            char impedanceLabel[64];
+            snprintf(impedanceLabel, sizeof(impedanceLabel), "%s_Impedance", signalLabel[i - channels]);
+            std::cout << "Impedance label: " << impedanceLabel << "\n";
+            edf_set_label(BDFHandler, i, impedanceLabel);
+            edf_set_samplefrequency(BDFHandler, i, recordSeconds);
             // Unit is in ohms, max val
             edf_set_physical_maximum(BDFHandler, i, 1000.0);
             edf_set_physical_minimum(BDFHandler, i, 0.0);
@@ -294,60 +734,68 @@ void SerialMonitor::init_BDF_file()
 void SerialMonitor::do_REM_Analysis()
 {
 
-    double EEG[1000], EOG1[1000], EOG2[1000];
-
-    if (flag_REM_Ready == 0) { // We only recieved 250 samples
-
-        // Convert integer data into physical data - multiply by V_REF/(2^23 - 1)/PGA_GAIN
-        for (int i = 0; i < DATA_WINDOW; i++) {
-            signal_nf_buffer[arr_REM(i, channel_analysis)] =
-                    ((double) dataBuffer[i + channel_analysis * SMP_FREQ]) * ADS1299_SCALE;
-            signal_nf_buffer[arr_REM(i, channel_analysis + 1)] =
-                    ((double) dataBuffer[i + (channel_analysis + 1) * SMP_FREQ]) * ADS1299_SCALE;
-            signal_nf_buffer[arr_REM(i, channel_analysis + 2)] =
-                    ((double) dataBuffer[i + (channel_analysis + 2) * SMP_FREQ]) * ADS1299_SCALE;
-        }
-
-        // Set flag_REM_Ready to 1 so the next time we can calculate subepoch
-        flag_REM_Ready = 1;
-
-    } else if (flag_REM_Ready == 1) { // We have recieved 500 samples now
+    // Run the configured chains on the new window
+    int window_ready = pipeline->push_Block(window_Data(0), recordSamples, ADS1299_SCALE);
 
-        double output_filter1[REM_DATA_WINDOW];
+    // Saccades from every block as it arrives, each annotated at its own onset
+    int saccades = saccade_detector->push(pipeline->block_Output(PIPELINE_EOG1), pipeline->block_Output(PIPELINE_EOG2),
+                                          pipeline->block_Length(PIPELINE_EOG1));
+    for (int i = 0; i < saccades; i++) {
+        const SaccadeEvent &saccade = saccade_detector->event(i);
+        window_saccades++;
+        annotate_Event(saccade.onset, saccade.duration, (saccade.direction > 0) ? "Saccade to EOG1" : "Saccade to EOG2");
+    }
 
-        // Same as above, but appending this time
-        for (int i = 0; i < DATA_WINDOW; i++) {
-            signal_nf_buffer[arr_REM(i, channel_analysis) + REM_DATA_WINDOW/2] =
-                    ((double) dataBuffer[i + channel_analysis * SMP_FREQ]) * ADS1299_SCALE;
-            signal_nf_buffer[arr_REM(i, channel_analysis + 1) + REM_DATA_WINDOW/2] =
-                    ((double) dataBuffer[i + (channel_analysis + 1) * SMP_FREQ]) * ADS1299_SCALE;
-            signal_nf_buffer[arr_REM(i, channel_analysis + 2) + REM_DATA_WINDOW/2] =
-                    ((double) dataBuffer[i + (channel_analysis + 2) * SMP_FREQ]) * ADS1299_SCALE;
+    // NREM microstructure of the EEG, annotated while the last epoch was scored N2 or N3
+    double *EEG_block = pipeline->block_Output(PIPELINE_EEG);
+    int nrem = sleep_stager->stage == SLEEP_N2 || sleep_stager->stage == SLEEP_N3;
+    if (stimulus) stimulus->arm(nrem);
 
-        }
-
-        // reset flag_REM_Ready
-        flag_REM_Ready = 0;
+    int spindles = spindle_detector->push(EEG_block, pipeline->block_Length(PIPELINE_EEG));
+    for (int i = 0; i < spindles; i++) {
+        if (nrem) annotate_Event(spindle_detector->event(i).onset, spindle_detector->event(i).duration, "Spindle");
+    }
 
-        // Filter the signal buffer of 500 samples
-        filter_hp->filtfilt(signal_nf_buffer, output_filter1, REM_DATA_WINDOW);
-        filter_lp->filtfilt(output_filter1, EEG, REM_DATA_WINDOW);
+    int slow_waves = slow_wave_detector->push(EEG_block, pipeline->block_Length(PIPELINE_EEG));
+    for (int i = 0; i < slow_waves; i++) {
+        const SlowWaveEvent &wave = slow_wave_detector->event(i);
+        if (nrem) annotate_Event(wave.onset, wave.duration, wave.k_complex ? "K-complex" : "Slow oscillation");
+    }
 
-        filter_hp_EOG->filtfilt(signal_nf_buffer + arr_REM(0, channel_analysis + 1), output_filter1, REM_DATA_WINDOW);
-        filter_lp->filtfilt(output_filter1, EOG1, REM_DATA_WINDOW);
+    // Once a whole REM window has been collected and filtered, analyse it
+    if (window_ready) {
 
-        filter_hp_EOG->filtfilt(signal_nf_buffer + arr_REM(0, channel_analysis + 2), output_filter1, REM_DATA_WINDOW);
-        filter_lp->filtfilt(output_filter1, EOG2, REM_DATA_WINDOW);
+        double *EEG = pipeline->output(PIPELINE_EEG);
+        double *EOG1 = pipeline->output(PIPELINE_EOG1);
+        double *EOG2 = pipeline->output(PIPELINE_EOG2);
 
         // Calculate magnitude spectrum
         rem_analysis->fft_power_Spectrum(EEG, fft_spectrum);
 
+        // Score the sleep stage of every whole epoch, EMG only if a chain provides it
+        if (sleep_stager->add_Window(fft_spectrum, EOG1, EOG2, pipeline->output(PIPELINE_EMG))) {
+            edfwrite_annotation_latin1(BDFHandler, (long long)((time_passed_sec - EPOCH_SEC) * 10000LL), (long long)( EPOCH_SEC * 10000LL),
+                                       SleepStager::stage_Name(sleep_stager->stage));
+        }
+
         // Evaluate REM for each data window
         // rem_analysis->evaluate_EOG_REM_Epoch(EOG1, EOG2, 1000); // Not sensitive
         rem_analysis->evaluate_EOG_REM_Epoch(EOG1, EOG2, 500); // Verry sensitive, 7 minute disable window very recommended
 
-        // Calculate on each sub-epochs (REM_DATA_WINDOW) and when we reach the end of the epoch:
-        if (rem_analysis->calc_Epoch(fft_spectrum, 8, 16)) {
+        // The saccades of this window decide the EOG hit instead, the product above stays in the logs
+        rem_analysis->evaluate_Saccade_REM_Epoch(window_saccades, MIN_WINDOW_SACCADES);
+
+        // Keep this window for re-scoring, only a block write every few minutes
+        double features[FEATURE_COLUMNS];
+        features[FEATURE_TIME] = time_passed_sec;
+        rem_analysis->calc_Features(fft_spectrum, REM_BAND_LOW, REM_BAND_HIGH, &features[FEATURE_SEFD], &features[FEATURE_RP], &features[FEATURE_AP]);
+        features[FEATURE_EOG_IP] = rem_analysis->avg_EOG_IP;
+        features[FEATURE_SACCADES] = window_saccades;
+        feature_store->append(features, fft_spectrum);
+        window_saccades = 0;
+
+        // Calculate on each sub-epochs (REM_DATA_WINDOW) and when the sliding epoch has moved by a hop:
+        if (rem_analysis->calc_Epoch(fft_spectrum, REM_BAND_LOW, REM_BAND_HIGH)) {
 
             // Determine if I'm in REM stage or not
             stage_REM = rem_analysis->evaluate_REM_Epoch();
@@ -363,13 +811,14 @@ void SerialMonitor::do_REM_Analysis()
             //   << std::endl; Don't end line YET
 
             // Update TUI output
-            m_guiConsole->update_Config(QString("Analysis Timestamp: %1                    \n"
+            m_guiConsole->update_Config(QString("Analysis Timestamp: %1  %6                    \n"
                                                 "SEFd: %2  AP: %3  RP: %4  EOG: %5                 ")
                                         .arg(QDateTime::fromTime_t(time_passed_sec).toUTC().toString("hh:mm:ss"))
                                         .arg(QString::number(rem_analysis->avg_SEFd, 'f', 1))
                                         .arg(QString::number(rem_analysis->avg_AP, 'f', 1))
                                         .arg(QString::number(rem_analysis->avg_RP, 'f', 1))
-                                        .arg(rem_analysis->rem_eog_Counter));
+                                        .arg(rem_analysis->rem_eog_Counter)
+                                        .arg(SleepStager::stage_Name(sleep_stager->stage)));
 
             // IF REM IS DETECTED OR ALARM
             if (stage_REM || alarm_demo) {
@@ -395,8 +844,8 @@ void SerialMonitor::do_REM_Analysis()
 
                     m_guiConsole->update_Toolbar(QString("It is Time!!"));
 
-                    // Play REM Alert mp3 to wake myself up!
-                    rem_sound_Alert->play();
+                    // Play REM Alert to wake myself up! Annotated once it started, see log_Cues()
+                    audio->play(alert_cue);
 
                     // The alarm is on, hence begin WINDOW_TRIGGER for the trigger
                     disabled_Time_Window = time_passed_sec + WINDOW_TRIGGER;
@@ -405,8 +854,8 @@ void SerialMonitor::do_REM_Analysis()
                 } else { // NO ALARM
                     analysisfile << 0;
 
-                    // Annotate BDF File
-                    edfwrite_annotation_latin1(BDFHandler, (long long)(time_passed_sec * 10000LL), (long long)( EPOCH_SEC * 10000LL), "REM");
+                    // Annotate BDF File, only the hop since the last decision so REM runs don't overlap
+                    edfwrite_annotation_latin1(BDFHandler, (long long)((time_passed_sec - EPOCH_HOP_SEC) * 10000LL), (long long)( EPOCH_HOP_SEC * 10000LL), "REM");
 
                 }
 
@@ -418,9 +867,6 @@ void SerialMonitor::do_REM_Analysis()
                 m_guiConsole->update_Toolbar(QString("Recording and Analyzing ..."));
             }
 
-            // Reset REM EOG Counter
-            rem_analysis->rem_eog_Counter = 0;
-
             // End line for the Analysis file
             analysisfile << std::endl;
 
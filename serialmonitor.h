@@ -28,11 +28,19 @@
 #include <QObject>
 #include <QtSerialPort/QSerialPort>
 #include "guiconsole.h"
-#include "filterIIR.h"
+#include "pipeline.h"
 #include "remDetect.h"
+#include "sleepStager.h"
+#include "sleepModel.h"
+#include "featureStore.h"
+#include "saccadeDetector.h"
+#include "spindleDetector.h"
+#include "slowWaveDetector.h"
+#include "stimulusScheduler.h"
+#include "cueEngine.h"
 #include <fstream>
 #include <QDateTime>
-#include <QSound>
+#include <QTimer>
 
 
 class SerialMonitor : public QObject
@@ -54,9 +62,21 @@ private:
     QSerialPort *DAQ;
     unsigned int DataCounter;
 
-    // Buffers for raw data and impedance measurements
+    // Buffers for raw data and impedance measurements, holding one whole data record
     int *dataBuffer;
     int impedanceBuffer[8];
+    int *impedanceRecord;
+
+    // Data record layout: recordSeconds windows of DATA_WINDOW samples per channel
+    int recordSeconds;
+    int recordSamples;
+    int recordWindow;
+    int recordFilled;   // samples per channel received into the record so far
+
+    // BDF data record filled directly from binary frames (3 bytes per sample)
+    unsigned char *rawBuffer;
+    int rawFrameSize;
+    int rawFrames;
 
     // Variables related to BDF files
     QString filename_BDF;
@@ -64,18 +84,57 @@ private:
     int channels;
     char signalLabel[8][50];
 
-    // IIR Filter object
-    filterIIR *filter_hp;
-    filterIIR *filter_hp_EOG;
-    filterIIR *filter_lp;
+    // Per-channel filter chains feeding the analysis
+    Pipeline *pipeline;
 
     // REM detect object
     remDetect *rem_analysis;
     void do_REM_Analysis();
 
+    // Individual eye movements, counted per window
+    SaccadeDetector *saccade_detector;
+    int window_saccades;
+
+    // Spindles, slow oscillations and K-complexes of the EEG
+    SpindleDetector *spindle_detector;
+    SlowWaveDetector *slow_wave_detector;
+
+    // Annotation signals per data record, from the rates below
+    void size_Annotations(int analysis);
+    double annotated_Seconds() const;
+
+    // Event annotations, at most event_rate per second of the recording
+    long events_written;
+    double event_rate;
+    void annotate_Event(long long onset, int duration, const char *text);
+
+    // Alarm and stimulus onsets, within their own cue_rate
+    long cues_written;
+    double cue_rate;
+    void annotate_Cue(long long onset, const char *text);
+
+    // Closed-loop stimulation on the slow oscillation phase of the EEG, NULL when off
+    StimulusScheduler *stimulus;
+    int stimulus_channel;
+    int stimulus_cue, stimulus_request;
+    int stimulus_output;
+    QTimer *stimulus_timer;
+    void plan_Stimulus();
+
+    // Sound cues of the alarm and the stimulation, on the EEG sample clock
+    CueEngine *audio;
+    int alert_cue;
+    void log_Cues();
+
+    // Five stage scoring of every epoch, on the same windows
+    SleepStager *sleep_stager;
+    SleepModel *sleep_model;
+
+    // Every window's spectrum and features, see featureStore.h
+    FeatureStore *feature_store;
+
     int channel_analysis;
     int stage_REM;
-    int flag_REM_Ready;
 
     int alarm_demo;
     int impedance_on;
@@ -87,12 +146,8 @@ private:
     long stimulus_delay_on;
     long time_failsafe_btn;
 
-    double *signal_nf_buffer;
     double *fft_spectrum;
 
-    // REM play sound file
-    QSound *rem_sound_Alert;
-
     // File to save things in
     std::ofstream analysisfile;
 
@@ -102,11 +157,17 @@ private:
     QTime start_time;
 
     void start_curses();
+    void tick_Window();
+    void write_BDF_Record();
+    void close_BDF_file();
+    void discard_BDF_file();
+    int *window_Data(int channel);
 
 private slots:
     void detectEOW();
     void writeToSettings();
     void writeToText();
+    void writeStimulus();
 
 
 };
@@ -0,0 +1,367 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "sleepModel.h"
+#include <sstream>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Largest tensor a layer may produce, and nodes per tree, to catch broken files early
+const int SLEEP_MODEL_MAX_TENSOR = 1 << 20;
+const int SLEEP_MODEL_MAX_NODES = 1 << 16;
+
+SleepModel::SleepModel()
+{
+    m_input_kind = SLEEP_MODEL_FEATURES;
+    m_input_size = 0;
+    m_workspace = 0;
+    m_input = 0;
+    m_buffer[0] = m_buffer[1] = 0;
+    m_output = 0;
+    m_outputs = 0;
+}
+
+int SleepModel::read_Values(std::istream &model, std::vector<double> &values, int count)
+{
+    for (int i = 0; i < count; i++) {
+        double value;
+        if (!(model >> value)) return -1;
+        values.push_back(value);
+    }
+    return 0;
+}
+
+int SleepModel::parse(std::istream &model)
+{
+    std::string word;
+    int channels = 1, length = 0;
+
+    if (!(model >> word) || word != "sleepmodel") {
+        m_error = "not a sleep model";
+        return -1;
+    }
+
+    if (!(model >> word) || word != "input" || !(model >> word) || !(model >> length) || length < 1) {
+        m_error = "missing or bad input";
+        return -1;
+    }
+    if (word == "features") m_input_kind = SLEEP_MODEL_FEATURES;
+    else if (word == "spectrum") m_input_kind = SLEEP_MODEL_SPECTRUM;
+    else {
+        m_error = "unknown input " + word;
+        return -1;
+    }
+    m_input_size = length;
+
+    while (model >> word) {
+        Layer layer;
+        layer.type = -1;
+        layer.in_channels = channels;
+        layer.in_length = length;
+        layer.kernel = layer.stride = 1;
+        layer.weights = layer.biases = layer.thresholds = 0;
+
+        int size = channels * length;
+        int ok = 1;
+
+        if (word == "normalize") {
+            layer.type = LAYER_NORMALIZE;
+            ok = !read_Values(model, layer.values, 2 * size);
+
+        } else if (word == "conv") {
+            layer.type = LAYER_CONV;
+            ok = (model >> channels >> layer.kernel >> layer.stride) && channels > 0 &&
+                 layer.kernel > 0 && layer.stride > 0 && layer.kernel <= length;
+            if (ok) {
+                length = (length - layer.kernel) / layer.stride + 1;
+                ok = !read_Values(model, layer.values, channels * layer.in_channels * layer.kernel + channels);
+            }
+
+        } else if (word == "relu") {
+            layer.type = LAYER_RELU;
+
+        } else if (word == "maxpool") {
+            layer.type = LAYER_MAXPOOL;
+            ok = (model >> layer.kernel) && layer.kernel > 0 && layer.kernel <= length;
+            if (ok) length /= layer.kernel;
+
+        } else if (word == "mean") {
+            layer.type = LAYER_MEAN;
+            length = 1;
+
+        } else if (word == "dense") {
+            layer.type = LAYER_DENSE;
+            ok = (model >> channels) && channels > 0;
+            length = 1;
+            if (ok) ok = !read_Values(model, layer.values, channels * size + channels);
+
+        } else if (word == "trees") {
+            int trees = 0;
+            layer.type = LAYER_TREES;
+            ok = (model >> channels >> trees) && channels > 0 && trees > 0;
+            length = 1;
+
+            for (int t = 0; ok && t < trees; t++) {
+                int nodes = 0, base = layer.feature.size();
+                ok = (model >> nodes) && nodes > 0 && nodes <= SLEEP_MODEL_MAX_NODES;
+                layer.roots.push_back(base);
+
+                for (int n = 0; ok && n < nodes; n++) {
+                    std::string first;
+                    double value;
+                    int left = 0, right = 0;
+                    ok = (model >> first >> value) ? 1 : 0;
+                    if (!ok) break;
+
+                    if (first == "leaf") {
+                        layer.feature.push_back(-1);
+                    } else {
+                        // Children after their parent, so evaluation always ends
+                        char *end;
+                        int feature = strtol(first.c_str(), &end, 10);
+                        ok = (model >> left >> right) && *end == 0 && feature >= 0 && feature < size &&
+                             left > n && left < nodes && right > n && right < nodes;
+                        layer.feature.push_back(feature);
+                    }
+                    layer.left.push_back(base + left);
+                    layer.right.push_back(base + right);
+                    layer.values.push_back(value);
+                }
+            }
+
+        } else {
+            m_error = "unknown layer " + word;
+            return -1;
+        }
+
+        if (!ok || length < 1 || channels * length > SLEEP_MODEL_MAX_TENSOR) {
+            m_error = "bad or incomplete " + word + " layer";
+            return -1;
+        }
+
+        layer.out_channels = channels;
+        layer.out_length = length;
+        m_layers.push_back(layer);
+    }
+
+    m_outputs = channels * length;
+    return 0;
+}
+
+int SleepModel::load(std::istream &model)
+{
+    destroy();
+    m_error.clear();
+
+    // Strip comments, the rest is just numbers and words
+    std::string line, text;
+    while (std::getline(model, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        text += line + "\n";
+    }
+
+    std::istringstream tokens(text);
+    if (parse(tokens)) {
+        destroy();
+        return -1;
+    }
+
+    // Size the workspace: input, two activation buffers and every layer's parameters
+    int largest = m_input_size;
+    int size = Workspace::size_Of(m_input_size);
+
+    for (size_t i = 0; i < m_layers.size(); i++) {
+        int out = m_layers[i].out_channels * m_layers[i].out_length;
+        if (out > largest) largest = out;
+        size += Workspace::size_Of(m_layers[i].values.size());
+    }
+    size += 2 * Workspace::size_Of(largest);
+
+    m_workspace = new Workspace(size);
+    m_input = m_workspace->take(m_input_size);
+    m_buffer[0] = m_workspace->take(largest);
+    m_buffer[1] = m_workspace->take(largest);
+
+    for (size_t i = 0; i < m_layers.size(); i++) {
+        Layer &layer = m_layers[i];
+        int count = layer.values.size();
+        double *params = m_workspace->take(count);
+
+        if (layer.type == LAYER_DENSE) {
+            // Transposed to [inputs][outputs], so the inner loop runs over outputs
+            int inputs = layer.in_channels * layer.in_length, outputs = layer.out_channels;
+            for (int o = 0; o < outputs; o++)
+                for (int k = 0; k < inputs; k++) params[k * outputs + o] = layer.values[o * inputs + k];
+            for (int o = 0; o < outputs; o++) params[inputs * outputs + o] = layer.values[inputs * outputs + o];
+            layer.weights = params;
+            layer.biases = params + inputs * outputs;
+
+        } else {
+            for (int k = 0; k < count; k++) params[k] = layer.values[k];
+
+            if (layer.type == LAYER_TREES) layer.thresholds = params;
+            else if (layer.type == LAYER_CONV) {
+                layer.weights = params;
+                layer.biases = params + layer.out_channels * layer.in_channels * layer.kernel;
+            } else if (layer.type == LAYER_NORMALIZE) {
+                layer.weights = params;
+                layer.biases = params + layer.in_channels * layer.in_length;
+            }
+        }
+
+        std::vector<double>().swap(layer.values);
+    }
+
+    // Layers alternate between the two buffers
+    m_output = m_layers.empty() ? m_input : m_buffer[(m_layers.size() - 1) % 2];
+
+    return 0;
+}
+
+void SleepModel::run_Conv(const Layer &layer, const double *in, double *out)
+{
+    int in_length = layer.in_length, out_length = layer.out_length;
+
+    for (int o = 0; o < layer.out_channels; o++) {
+        double *row = out + o * out_length;
+        for (int p = 0; p < out_length; p++) row[p] = layer.biases[o];
+
+        for (int i = 0; i < layer.in_channels; i++) {
+            const double *w = layer.weights + (o * layer.in_channels + i) * layer.kernel;
+
+            for (int k = 0; k < layer.kernel; k++) {
+                const double *src = in + i * in_length + k;
+                double weight = w[k];
+
+                if (layer.stride == 1) {
+                    for (int p = 0; p < out_length; p++) row[p] += weight * src[p];
+                } else {
+                    for (int p = 0; p < out_length; p++) row[p] += weight * src[p * layer.stride];
+                }
+            }
+        }
+    }
+}
+
+void SleepModel::run_Dense(const Layer &layer, const double *in, double *out)
+{
+    int inputs = layer.in_channels * layer.in_length, outputs = layer.out_channels;
+
+    for (int o = 0; o < outputs; o++) out[o] = layer.biases[o];
+
+    for (int k = 0; k < inputs; k++) {
+        const double *w = layer.weights + k * outputs;
+        double x = in[k];
+        for (int o = 0; o < outputs; o++) out[o] += w[o] * x;
+    }
+}
+
+void SleepModel::run_Trees(const Layer &layer, const double *in, double *out)
+{
+    int classes = layer.out_channels;
+
+    for (int c = 0; c < classes; c++) out[c] = 0;
+
+    for (size_t t = 0; t < layer.roots.size(); t++) {
+        int node = layer.roots[t];
+        while (layer.feature[node] >= 0)
+            node = (in[layer.feature[node]] < layer.thresholds[node]) ? layer.left[node] : layer.right[node];
+
+        out[t % classes] += layer.thresholds[node];
+    }
+}
+
+int SleepModel::predict()
+{
+    if (!m_workspace) return -1;
+
+    const double *in = m_input;
+
+    for (size_t i = 0; i < m_layers.size(); i++) {
+        const Layer &layer = m_layers[i];
+        double *out = m_buffer[i % 2];
+        int size = layer.in_channels * layer.in_length;
+
+        switch (layer.type) {
+        case LAYER_NORMALIZE:
+            for (int k = 0; k < size; k++) out[k] = (in[k] - layer.weights[k]) * layer.biases[k];
+            break;
+        case LAYER_CONV:
+            run_Conv(layer, in, out);
+            break;
+        case LAYER_RELU:
+            for (int k = 0; k < size; k++) out[k] = (in[k] > 0) ? in[k] : 0;
+            break;
+        case LAYER_MAXPOOL:
+            for (int c = 0; c < layer.out_channels; c++)
+                for (int p = 0; p < layer.out_length; p++) {
+                    const double *src = in + c * layer.in_length + p * layer.kernel;
+                    double largest = src[0];
+                    for (int k = 1; k < layer.kernel; k++) if (src[k] > largest) largest = src[k];
+                    out[c * layer.out_length + p] = largest;
+                }
+            break;
+        case LAYER_MEAN:
+            for (int c = 0; c < layer.in_channels; c++) {
+                double sum = 0;
+                for (int p = 0; p < layer.in_length; p++) sum += in[c * layer.in_length + p];
+                out[c] = sum / layer.in_length;
+            }
+            break;
+        case LAYER_DENSE:
+            run_Dense(layer, in, out);
+            break;
+        case LAYER_TREES:
+            run_Trees(layer, in, out);
+            break;
+        }
+
+        in = out;
+    }
+
+    // Highest score wins
+    int best = 0;
+    for (int c = 1; c < m_outputs; c++) if (m_output[c] > m_output[best]) best = c;
+
+    return best;
+}
+
+void SleepModel::destroy()
+{
+    delete m_workspace;
+    m_workspace = 0;
+    m_input = 0;
+    m_buffer[0] = m_buffer[1] = 0;
+    m_output = 0;
+    m_outputs = 0;
+    m_input_size = 0;
+    m_layers.clear();
+}
+
+SleepModel::~SleepModel()
+{
+    destroy();
+}
@@ -0,0 +1,145 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#ifndef SLEEPMODEL_H
+#define SLEEPMODEL_H
+
+#include <istream>
+#include <string>
+#include <vector>
+#include "workspace.h"
+
+/* SMALL LEARNED SLEEP STAGING MODELS, WITHOUT AN ML RUNTIME
+ *
+ * A model is a text file: its input, then layers run in order, and the last
+ * layer gives one score per stage. Numbers are separated by any white space,
+ * and # starts a comment:
+ *
+ *     sleepmodel
+ *     input features <length>         SleepStager's epoch features, length SLEEP_FEATURES (11)
+ *     input spectrum <bins>           epoch mean of 20 log10 of the first bins of the spectrum
+ *
+ *     normalize <mean x size> <scale x size>     x = (x - mean) * scale, element by element
+ *     conv <out channels> <kernel> <stride> <weights [out][in][kernel]> <biases [out]>
+ *     relu
+ *     maxpool <size>
+ *     mean                            average over the positions of each channel
+ *     dense <outputs> <weights [outputs][inputs]> <biases [outputs]>
+ *     trees <classes> <# of trees>    gradient boosted trees on the flattened input,
+ *                                     tree t adds its leaf to the score of class t % classes.
+ *         then per tree: <# of nodes>, and per node either
+ *         <feature> <threshold> <left node> <right node>     go left if x[feature] < threshold
+ *         leaf <value>
+ *
+ * For example, five one-tree scores for W, N1, N2, N3 and REM, N3 on the delta band
+ * feature and REM on the EOG feature (see the SLEEP_FEATURE_ order in sleepStager.h):
+ *
+ *     sleepmodel
+ *     input features 11
+ *     trees 5 5
+ *         1  leaf 0                    # W
+ *         1  leaf 0                    # N1
+ *         1  leaf 0.5                  # N2
+ *         3  3 30 1 2  leaf 0  leaf 1  # N3 when delta is 30 or more
+ *         3  9 2 1 2  leaf 0  leaf 1   # REM when EOG is 2 or more
+ *
+ * Tensors are [channel][position]; features and spectrum both come in as one channel.
+ * All weights and activations live in one workspace allocated by load(), so predict()
+ * does not allocate. The kernels keep the innermost loops over contiguous positions
+ * or outputs (dense weights are stored transposed) so the compiler vectorizes them.
+ *
+ * HOW TO USE
+    1. Initialize object and load a model, -1 on error (see error()):
+        SleepModel.load(model stream);
+    2. Fill SleepModel.input() with SleepModel.input_Size() values of SleepModel.input_Kind()
+       (or give the model to SleepStager.set_Model, which does this every epoch)
+    3. Run it:
+        stage = SleepModel.predict();    -> scores in SleepModel.output()
+ *
+ */
+
+enum { SLEEP_MODEL_FEATURES, SLEEP_MODEL_SPECTRUM };
+
+class SleepModel
+{
+public:
+    SleepModel();
+    ~SleepModel();
+
+    int load(std::istream &model);
+    const std::string &error() const { return m_error; }
+
+    int input_Kind() const { return m_input_kind; }
+    int input_Size() const { return m_input_size; }
+    double *input() { return m_input; }
+
+    int predict();
+    const double *output() const { return m_output; }
+    int output_Size() const { return m_outputs; }
+
+private:
+    SleepModel(const SleepModel &);
+    SleepModel &operator=(const SleepModel &);
+
+    enum { LAYER_NORMALIZE, LAYER_CONV, LAYER_RELU, LAYER_MAXPOOL, LAYER_MEAN, LAYER_DENSE, LAYER_TREES };
+
+    struct Layer {
+        int type;
+        int in_channels, in_length;
+        int out_channels, out_length;
+        int kernel, stride;
+
+        // Read from the file, moved into the workspace by load()
+        std::vector<double> values;
+        double *weights, *biases;
+
+        // Trees: first node of every tree, and the nodes (feature -1 for leaves)
+        std::vector<int> roots, feature, left, right;
+        double *thresholds;
+    };
+
+    int parse(std::istream &model);
+    int read_Values(std::istream &model, std::vector<double> &values, int count);
+    void destroy();
+
+    void run_Conv(const Layer &layer, const double *in, double *out);
+    void run_Dense(const Layer &layer, const double *in, double *out);
+    void run_Trees(const Layer &layer, const double *in, double *out);
+
+    int m_input_kind;
+    int m_input_size;
+    std::vector<Layer> m_layers;
+
+    Workspace *m_workspace;
+    double *m_input;
+    double *m_buffer[2];
+    double *m_output;
+    int m_outputs;
+
+    std::string m_error;
+
+};
+
+#endif // SLEEPMODEL_H
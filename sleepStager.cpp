@@ -0,0 +1,255 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "sleepStager.h"
+#include "sleepModel.h"
+#include <math.h>
+#include <stddef.h>
+
+#define FREQ_TO_BIN(x, N_FFT, Fs) int(x * N_FFT/Fs)
+
+// Band edges in hz: delta, theta, alpha, sigma and beta
+static const double sleep_band_edges[SLEEP_BANDS + 1] = { 0.5, 4, 8, 12, 16, 30 };
+
+// The EMG baseline creeps up by this factor every epoch, so one artifact can not pin it down
+const double SLEEP_EMG_BASELINE_LEAK = 1.005;
+
+static const char *sleep_stage_names[SLEEP_STAGES] = {
+    "Sleep stage W", "Sleep stage N1", "Sleep stage N2", "Sleep stage N3", "Sleep stage R"
+};
+
+SleepLimits::SleepLimits()
+{
+    // REM criteria as used with remDetect in serialmonitor
+    min_SEFd = 4;
+    max_AP = 17;
+    min_RP = -15;
+    max_RP = -13;
+    min_EOG = 500;
+    min_EOG_Windows = 3;
+
+    wake_Fast = 0.35;
+    n3_Delta = 0.8;
+    n3_AP = 30;
+    n2_Sigma = 0.06;
+
+    wake_EMG = 10;
+    max_EMG_REM = 3;
+}
+
+SleepStager::SleepStager(remDetect *features, int Fs, int size_fft, int size_window, int epoch_in_sec)
+{
+    m_features = features;
+    m_Fs = Fs;
+    m_size_fft = size_fft;
+    m_size_window = size_window;
+    m_Epoch = epoch_in_sec * Fs / size_window;
+    if (m_Epoch < 1) m_Epoch = 1;
+
+    stage = -1;
+    avg_SEFd = avg_RP = avg_AP = 0;
+    for (int i = 0; i < SLEEP_BANDS; i++) avg_Band[i] = 0;
+    avg_Delta_AP = 0;
+    avg_EMG = emg_dB = 0;
+    eog_Counter = 0;
+    emg_Valid = 0;
+
+    m_windows = m_emg_windows = m_eog_hits = 0;
+    m_sum_SEFd = m_sum_RP = m_sum_AP = 0;
+    for (int i = 0; i < SLEEP_BANDS; i++) m_sum_Band[i] = 0;
+    m_sum_Delta_AP = 0;
+    m_sum_EMG = 0;
+    m_emg_Baseline = -1;
+
+    m_model = NULL;
+    m_sum_Spectrum = NULL;
+    m_spectrum_bins = 0;
+}
+
+int SleepStager::set_Model(SleepModel *model)
+{
+    delete[] m_sum_Spectrum;
+    m_sum_Spectrum = NULL;
+    m_spectrum_bins = 0;
+    m_model = NULL;
+
+    if (model == NULL) return 0;
+
+    if (model->output_Size() != SLEEP_STAGES) return -1;
+
+    if (model->input_Kind() == SLEEP_MODEL_SPECTRUM) {
+        if (model->input_Size() > m_size_fft / 2) return -1;
+        m_spectrum_bins = model->input_Size();
+        m_sum_Spectrum = new double[m_spectrum_bins];
+        for (int i = 0; i < m_spectrum_bins; i++) m_sum_Spectrum[i] = 0;
+    } else if (model->input_Size() != SLEEP_FEATURES) {
+        return -1;
+    }
+
+    m_model = model;
+    return 0;
+}
+
+void SleepStager::features(double *output) const
+{
+    output[SLEEP_FEATURE_SEFD] = avg_SEFd;
+    output[SLEEP_FEATURE_AP] = avg_AP;
+    output[SLEEP_FEATURE_RP] = avg_RP;
+    for (int b = 0; b < SLEEP_BANDS; b++) output[SLEEP_FEATURE_BAND + b] = avg_Band[b];
+    output[SLEEP_FEATURE_DELTA_AP] = avg_Delta_AP;
+    output[SLEEP_FEATURE_EOG] = eog_Counter;
+    output[SLEEP_FEATURE_EMG] = emg_Valid ? emg_dB : 0;
+}
+
+void SleepStager::set_Limits(const SleepLimits &limits)
+{
+    m_limits = limits;
+}
+
+const char *SleepStager::stage_Name(int stage)
+{
+    return (stage >= 0 && stage < SLEEP_STAGES) ? sleep_stage_names[stage] : "Sleep stage ?";
+}
+
+// Sum of the bins in [f_Start, f_End), of power or of magnitude scaled like remDetect's absPower
+double SleepStager::band_Sum(const double *spectrum, double f_Start, double f_End, int squared)
+{
+    double sum = 0;
+
+    for (int i = FREQ_TO_BIN(f_Start, m_size_fft, m_Fs); i < FREQ_TO_BIN(f_End, m_size_fft, m_Fs); i++)
+        sum += squared ? spectrum[i] * spectrum[i] : spectrum[i];
+
+    return sum * ((double)m_Fs) / ((double)m_size_fft);
+}
+
+int SleepStager::add_Window(double *spectrum, const double *EOG1, const double *EOG2, const double *EMG)
+{
+    double SEFd, RP, AP;
+
+    m_features->calc_Features(spectrum, 8, 16, &SEFd, &RP, &AP);
+    m_sum_SEFd += SEFd;
+    m_sum_RP += RP;
+    m_sum_AP += AP;
+
+    // Band fractions of the 0.5 to 30 hz power
+    double band[SLEEP_BANDS], total = 0;
+    for (int b = 0; b < SLEEP_BANDS; b++) {
+        band[b] = band_Sum(spectrum, sleep_band_edges[b], sleep_band_edges[b + 1], 1);
+        total += band[b];
+    }
+    for (int b = 0; b < SLEEP_BANDS; b++) m_sum_Band[b] += (total > 0) ? band[b] / total : 0;
+
+    double delta = band_Sum(spectrum, sleep_band_edges[SLEEP_DELTA], sleep_band_edges[SLEEP_DELTA + 1], 0);
+    m_sum_Delta_AP += 20.0 * log10(delta > 0 ? delta : 1e-12);
+
+    // Opposing eye movements, as remDetect::evaluate_EOG_REM_Epoch
+    double eog = 0;
+    for (int i = 0; i < m_size_window; i++) eog += -1.0 * EOG1[i] * EOG2[i];
+    if (eog / m_size_window > m_limits.min_EOG) m_eog_hits++;
+
+    for (int i = 0; i < m_spectrum_bins; i++)
+        m_sum_Spectrum[i] += 20.0 * log10(spectrum[i] > 0 ? spectrum[i] : 1e-12);
+
+    if (EMG != NULL) {
+        double power = 0;
+        for (int i = 0; i < m_size_window; i++) power += EMG[i] * EMG[i];
+        m_sum_EMG += power / m_size_window;
+        m_emg_windows++;
+    }
+
+    if (++m_windows < m_Epoch) return 0;
+
+    // End of the epoch: average, score and start over
+    avg_SEFd = m_sum_SEFd / m_windows;
+    avg_RP = m_sum_RP / m_windows;
+    avg_AP = m_sum_AP / m_windows;
+    for (int b = 0; b < SLEEP_BANDS; b++) avg_Band[b] = m_sum_Band[b] / m_windows;
+    avg_Delta_AP = m_sum_Delta_AP / m_windows;
+    eog_Counter = m_eog_hits;
+
+    emg_Valid = (m_emg_windows == m_windows);
+    if (emg_Valid) {
+        avg_EMG = m_sum_EMG / m_emg_windows;
+
+        if (m_emg_Baseline < 0 || avg_EMG < m_emg_Baseline) m_emg_Baseline = avg_EMG;
+        emg_dB = (m_emg_Baseline > 0 && avg_EMG > 0) ? 10.0 * log10(avg_EMG / m_emg_Baseline) : 0;
+        m_emg_Baseline *= SLEEP_EMG_BASELINE_LEAK;
+    }
+
+    if (m_model) {
+        double *input = m_model->input();
+
+        if (m_spectrum_bins > 0) {
+            for (int i = 0; i < m_spectrum_bins; i++) {
+                input[i] = m_sum_Spectrum[i] / m_windows;
+                m_sum_Spectrum[i] = 0;
+            }
+        } else {
+            features(input);
+        }
+
+        stage = m_model->predict();
+    } else {
+        stage = classify();
+    }
+
+    m_windows = m_emg_windows = m_eog_hits = 0;
+    m_sum_SEFd = m_sum_RP = m_sum_AP = 0;
+    for (int b = 0; b < SLEEP_BANDS; b++) m_sum_Band[b] = 0;
+    m_sum_Delta_AP = 0;
+    m_sum_EMG = 0;
+
+    return 1;
+}
+
+int SleepStager::classify()
+{
+    const SleepLimits &l = m_limits;
+    int previous = stage;
+
+    if (avg_Band[SLEEP_ALPHA] + avg_Band[SLEEP_BETA] > l.wake_Fast ||
+        (emg_Valid && emg_dB > l.wake_EMG))
+        return SLEEP_W;
+
+    if (avg_Band[SLEEP_DELTA] > l.n3_Delta && avg_Delta_AP > l.n3_AP)
+        return SLEEP_N3;
+
+    // REM EEG with rapid eye movements, or REM carrying on without them
+    if (avg_SEFd > l.min_SEFd && avg_AP < l.max_AP && avg_RP > l.min_RP && avg_RP < l.max_RP &&
+        (eog_Counter >= l.min_EOG_Windows || previous == SLEEP_REM) &&
+        !(emg_Valid && emg_dB > l.max_EMG_REM))
+        return SLEEP_REM;
+
+    if (avg_Band[SLEEP_SIGMA] > l.n2_Sigma)
+        return SLEEP_N2;
+
+    // Without an arousal (that would have been W), N2 continues
+    return (previous == SLEEP_N2) ? SLEEP_N2 : SLEEP_N1;
+}
+
+SleepStager::~SleepStager()
+{
+    delete[] m_sum_Spectrum;
+}
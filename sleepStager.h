@@ -0,0 +1,149 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#ifndef SLEEPSTAGER_H
+#define SLEEPSTAGER_H
+
+#include "remDetect.h"
+
+class SleepModel;
+
+/* FIVE STAGE (W, N1, N2, N3, REM) SLEEP STAGING, ONE DECISION PER EPOCH
+ *
+ * Every analysis window adds its features to running sums, so memory is
+ * constant and the decision at the end of an epoch costs the same as one window:
+ *   - SEFd, AP and RP of remDetect (8 to 16 hz), the REM criteria
+ *   - Fractions of the 0.5 to 30 hz power in the delta, theta, alpha, sigma and beta bands
+ *   - Absolute delta power in dB, like remDetect's AP
+ *   - Windows with opposing eye movements, from the EOG inner product
+ *   - Mean EMG power against its lowest epoch so far, if an EMG window is given
+ *
+ * The epoch is then scored by rules, checked in this order:
+ *   W   - fast (alpha + beta) fraction or EMG above the wake limits
+ *   N3  - delta fraction and delta power above the N3 limits
+ *   REM - remDetect's SEFd/AP/RP criteria, enough eye movement windows
+ *         (or REM continuing from the last epoch) and no EMG rise
+ *   N2  - sigma (spindle band) fraction above the N2 limit
+ *   N1  - anything else, unless it continues an N2 stretch
+ * or, with a learned model set, by the model (see sleepModel.h) on the epoch's
+ * features or on its mean log spectrum.
+ *
+ * HOW TO USE
+    1. Initialize object, with the remDetect the spectrum comes from:
+        SleepStager(&remDetect, Sampling Frequency, FFT size, Window size, Epoch in seconds - 30s pref)
+    2. (Optional) Change the limits, or score with a loaded model instead (-1 if it does not fit):
+        SleepLimits limits; limits.n2_Sigma = ...; SleepStager.set_Limits(limits);
+        SleepStager.set_Model(&SleepModel);
+    3. For every analysis window, with the spectrum from remDetect.fft_power_Spectrum:
+        SleepStager.add_Window(spectrum, EOG1, EOG2, EMG or NULL)
+            -> IF THE ABOVE RETURNS 1:
+                   SleepStager.stage holds the stage of the epoch, see SleepStager::stage_Name
+ *
+ */
+
+enum { SLEEP_W, SLEEP_N1, SLEEP_N2, SLEEP_N3, SLEEP_REM, SLEEP_STAGES };
+enum { SLEEP_DELTA, SLEEP_THETA, SLEEP_ALPHA, SLEEP_SIGMA, SLEEP_BETA, SLEEP_BANDS };
+
+// Order of the epoch features given to models, see SleepStager::features
+enum { SLEEP_FEATURE_SEFD, SLEEP_FEATURE_AP, SLEEP_FEATURE_RP, SLEEP_FEATURE_BAND,
+       SLEEP_FEATURE_DELTA_AP = SLEEP_FEATURE_BAND + SLEEP_BANDS, SLEEP_FEATURE_EOG, SLEEP_FEATURE_EMG,
+       SLEEP_FEATURES };
+
+struct SleepLimits {
+    SleepLimits();
+
+    // REM, same meaning as remDetect::set_limits
+    double min_SEFd, max_AP, min_RP, max_RP;
+    double min_EOG;         // EOG inner product of an eye movement window
+    int min_EOG_Windows;    // Eye movement windows per epoch for REM
+
+    double wake_Fast;       // (alpha + beta) fraction
+    double n3_Delta;        // delta fraction
+    double n3_AP;           // delta power in dB
+    double n2_Sigma;        // sigma fraction
+
+    // EMG in dB over the lowest epoch so far
+    double wake_EMG;
+    double max_EMG_REM;
+};
+
+class SleepStager
+{
+public:
+    SleepStager(remDetect *features, int Fs, int size_fft, int size_window, int epoch_in_sec);
+    ~SleepStager();
+
+    void set_Limits(const SleepLimits &limits);
+    int set_Model(SleepModel *model);
+    int add_Window(double *spectrum, const double *EOG1, const double *EOG2, const double *EMG);
+
+    // Features of the last epoch, SLEEP_FEATURES values (EMG is 0 without one)
+    void features(double *output) const;
+
+    static const char *stage_Name(int stage);
+
+    // Stage of the last epoch, -1 before the first one
+    int stage;
+
+    // Averaged features of the last epoch
+    double avg_SEFd, avg_RP, avg_AP;
+    double avg_Band[SLEEP_BANDS];
+    double avg_Delta_AP;
+    double avg_EMG, emg_dB;
+    int eog_Counter;
+    int emg_Valid;
+
+private:
+    SleepStager(const SleepStager &);
+    SleepStager &operator=(const SleepStager &);
+
+    int classify();
+    double band_Sum(const double *spectrum, double f_Start, double f_End, int squared);
+
+    remDetect *m_features;
+    SleepLimits m_limits;
+
+    int m_Fs;
+    int m_size_fft;
+    int m_size_window;
+    int m_Epoch;
+
+    // Running sums over the current epoch
+    int m_windows, m_emg_windows, m_eog_hits;
+    double m_sum_SEFd, m_sum_RP, m_sum_AP;
+    double m_sum_Band[SLEEP_BANDS];
+    double m_sum_Delta_AP;
+    double m_sum_EMG;
+
+    double m_emg_Baseline;
+
+    // Learned model, and the epoch sum of the log spectrum when it wants one
+    SleepModel *m_model;
+    double *m_sum_Spectrum;
+    int m_spectrum_bins;
+
+};
+
+#endif // SLEEPSTAGER_H
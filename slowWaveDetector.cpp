@@ -0,0 +1,153 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "slowWaveDetector.h"
+#include "filterBank.h"
+#include <math.h>
+
+// IIR Coefficients
+extern double coeffs_slow[];
+
+const int SLOW_STAGES = 4;
+const double SLOW_WARMUP_SEC = 5.0;
+const double SLOW_BACKGROUND_SEC = 10.0;
+const double SLOW_MIN_HALF_SEC = 0.25;
+const double SLOW_MAX_HALF_SEC = 1.0;
+const double K_COMPLEX_MIN_SEC = 0.5;
+const double K_COMPLEX_BACKGROUND_FACTOR = 5.0;
+
+SlowWaveDetector::SlowWaveDetector(int Fs, int max_samples)
+{
+    m_Fs = Fs;
+    m_max_samples = max_samples;
+    set_limits(40, 75);
+
+    m_filter = new FilterBank(coeffs_slow, SLOW_STAGES, 1, m_max_samples);
+    m_block = new double[m_max_samples];
+    m_offset = 0;
+    m_count = 0;
+    m_last = 0;
+
+    m_back_span = (int) (SLOW_BACKGROUND_SEC * Fs);
+    m_back_ring = new double[m_back_span];
+    for (int i = 0; i < m_back_span; i++) m_back_ring[i] = 0;
+    m_back_pos = 0;
+    m_back_sum = 0;
+
+    m_warmup = (int) (SLOW_WARMUP_SEC * Fs);
+    m_min_half = (int) (SLOW_MIN_HALF_SEC * Fs + 0.5);
+    m_max_half = (int) (SLOW_MAX_HALF_SEC * Fs + 0.5);
+    m_min_k_complex = (int) (K_COMPLEX_MIN_SEC * Fs + 0.5);
+
+    m_phase = 0;
+    m_events.reserve(4);
+}
+
+void SlowWaveDetector::set_limits(double min_depth, double min_peak_to_peak)
+{
+    m_min_depth = min_depth;
+    m_min_peak_to_peak = min_peak_to_peak;
+}
+
+int SlowWaveDetector::push(const double *EEG, int num_samples)
+{
+    m_events.clear();
+
+    // The first sample sets the electrode offset, so the high-pass does not start on a step
+    if (m_count == 0 && num_samples > 0) m_offset = EEG[0];
+
+    for (int done = 0; done < num_samples; done += m_max_samples) {
+        int n = num_samples - done;
+        if (n > m_max_samples) n = m_max_samples;
+
+        for (int i = 0; i < n; i++) m_block[i] = EEG[done + i] - m_offset;
+        m_filter->process(m_block, m_block, n, m_max_samples);
+
+        for (int i = 0; i < n; i++, m_count++) {
+            double x = m_block[i];
+            int down = m_last >= 0 && x < 0;
+            int up = m_last < 0 && x >= 0;
+            m_last = x;
+
+            if (m_phase == 2 && (down || m_count - m_up > m_max_half)) end_Wave();
+
+            if (m_phase == 1) {
+                if (x < -m_event.depth) {
+                    m_event.depth = -x;
+                    m_event.trough = m_count;
+                }
+                if (up) {
+                    int half = m_count - m_event.onset;
+                    m_phase = (half >= m_min_half && m_event.depth >= m_min_depth) ? 2 : 0;
+                    m_up = m_count;
+                    m_peak = x;
+                } else if (m_count - m_event.onset > m_max_half) {
+                    m_phase = 0;
+                }
+            } else if (m_phase == 2 && x > m_peak) {
+                m_peak = x;
+            }
+
+            if (down && m_count >= m_warmup) {
+                m_phase = 1;
+                m_event.onset = m_count;
+                m_event.trough = m_count;
+                m_event.depth = -x;
+                m_background = sqrt(m_back_sum / m_back_span);
+            }
+
+            // Background, after the wave starting here took its snapshot; rebuilt every lap
+            double square = x * x;
+            m_back_sum += square - m_back_ring[m_back_pos];
+            m_back_ring[m_back_pos] = square;
+            if (++m_back_pos == m_back_span) {
+                m_back_pos = 0;
+                m_back_sum = 0;
+                for (int k = 0; k < m_back_span; k++) m_back_sum += m_back_ring[k];
+            }
+        }
+    }
+
+    return m_events.size();
+}
+
+void SlowWaveDetector::end_Wave()
+{
+    m_phase = 0;
+    m_event.duration = m_count - m_event.onset;
+    m_event.peak_to_peak = m_peak + m_event.depth;
+    if (m_event.peak_to_peak < m_min_peak_to_peak) return;
+
+    m_event.k_complex = m_event.duration >= m_min_k_complex &&
+                        m_event.peak_to_peak >= K_COMPLEX_BACKGROUND_FACTOR * m_background;
+    m_events.push_back(m_event);
+}
+
+SlowWaveDetector::~SlowWaveDetector()
+{
+    delete m_filter;
+    delete[] m_block;
+    delete[] m_back_ring;
+}
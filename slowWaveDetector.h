@@ -0,0 +1,113 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+#ifndef SLOWWAVEDETECTOR_H
+#define SLOWWAVEDETECTOR_H
+
+#include <vector>
+
+class FilterBank;
+
+/* STREAMING SLOW OSCILLATION AND K-COMPLEX DETECTOR FOR ONE EEG CHANNEL
+ *
+ * The EEG is band-passed to 0.16 - 4 hz (coeffs_slow) with a FilterBank block by
+ * block, and every wave is followed from its zero crossings: a negative half-wave
+ * (down crossing to up crossing) of 0.25 to 1 s reaching the minimum trough, then
+ * the positive half-wave up to the next down crossing or 1 s. A wave with the
+ * minimum peak to peak is a slow oscillation, or a K-complex when it also lasts
+ * 0.5 s or more and stands out from the background: peak to peak at least 5 times
+ * the RMS of the band over the 10 s before it, kept in a ring of squared samples.
+ *
+ * A wave is reported when its positive half-wave ends; onset (the down crossing),
+ * trough and duration are in samples, counted from the first sample pushed. The
+ * design is for 250 hz, like the other IIR_Coeffs.cpp designs.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        SlowWaveDetector(Sampling Frequency, max samples per push)
+    2. (Optional) Set the limits, defaults are 40 uV and 75 uV:
+        SlowWaveDetector.set_limits(min trough depth, min peak to peak);
+    3. Push the EEG as it arrives, e.g. Pipeline.block_Output(PIPELINE_EEG):
+        FOR i < SlowWaveDetector.push(EEG, # of samples):
+            SlowWaveDetector.event(i).onset, .trough, .k_complex, ...
+ *
+ */
+
+struct SlowWaveEvent {
+    long long onset;        // sample of the down crossing
+    long long trough;       // sample of the negative peak
+    int duration;           // samples, both half-waves
+    double depth;           // of the trough, input units (uV)
+    double peak_to_peak;
+    int k_complex;          // 1 if it stands out from the background
+};
+
+class SlowWaveDetector
+{
+public:
+    SlowWaveDetector(int Fs, int max_samples);
+    ~SlowWaveDetector();
+
+    void set_limits(double min_depth, double min_peak_to_peak);
+    int push(const double *EEG, int num_samples);
+
+    // Waves that ended in the last push
+    const SlowWaveEvent &event(int i) const { return m_events[i]; }
+
+private:
+    SlowWaveDetector(const SlowWaveDetector &);
+    SlowWaveDetector &operator=(const SlowWaveDetector &);
+
+    void end_Wave();
+
+    int m_Fs;
+    int m_max_samples;
+    double m_min_depth, m_min_peak_to_peak;
+
+    FilterBank *m_filter;
+    double *m_block;
+    double m_offset;
+    long long m_count;
+    double m_last;
+
+    // Squared band samples of the background, oldest at m_back_pos
+    double *m_back_ring;
+    int m_back_span, m_back_pos;
+    double m_back_sum;
+
+    int m_warmup, m_min_half, m_max_half, m_min_k_complex;
+
+    // Wave being followed: 0 none, 1 negative half, 2 positive half
+    int m_phase;
+    long long m_up;
+    double m_peak, m_background;
+    SlowWaveEvent m_event;
+
+    std::vector<SlowWaveEvent> m_events;
+
+};
+
+#endif // SLOWWAVEDETECTOR_H
@@ -0,0 +1,176 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "spindleDetector.h"
+#include "filterBank.h"
+#include <math.h>
+
+// IIR Coefficients
+extern double coeffs_sigma[];
+
+const int SPINDLE_STAGES = 4;
+const double SPINDLE_RMS_SEC = 0.2;
+const int SPINDLE_BASELINE_SEC = 5 * 60;
+const int SPINDLE_MIN_BASELINE_SEC = 30;
+const double SPINDLE_MIN_SEC = 0.5;
+const double SPINDLE_MAX_SEC = 3.0;
+
+SpindleDetector::SpindleDetector(int Fs, int max_samples)
+{
+    m_Fs = Fs;
+    m_max_samples = max_samples;
+    set_limits(2, 3);
+
+    m_filter = new FilterBank(coeffs_sigma, SPINDLE_STAGES, 1, m_max_samples);
+    m_block = new double[m_max_samples];
+    m_offset = 0;
+    m_count = 0;
+
+    m_rms_span = (int) (SPINDLE_RMS_SEC * Fs + 0.5);
+    if (m_rms_span < 1) m_rms_span = 1;
+    m_rms_ring = new double[m_rms_span];
+    for (int i = 0; i < m_rms_span; i++) m_rms_ring[i] = 0;
+    m_rms_pos = 0;
+    m_rms_sum = 0;
+
+    m_base_span = SPINDLE_BASELINE_SEC;
+    m_base_ring = new double[m_base_span];
+    for (int i = 0; i < m_base_span; i++) m_base_ring[i] = 0;
+    m_base_pos = m_base_filled = 0;
+    m_base_sum = 0;
+    m_second_sum = 0;
+    m_second_fill = 0;
+
+    m_min_duration = (int) (SPINDLE_MIN_SEC * Fs + 0.5);
+    m_max_duration = (int) (SPINDLE_MAX_SEC * Fs + 0.5);
+
+    m_active = m_reached = 0;
+    m_crossings = 0;
+    m_last = 0;
+    m_events.reserve(4);
+}
+
+void SpindleDetector::set_limits(double lower, double upper)
+{
+    m_lower = lower;
+    m_upper = upper;
+}
+
+double SpindleDetector::rms() const
+{
+    return (m_count < m_rms_span || m_rms_sum <= 0) ? 0 : sqrt(m_rms_sum / m_rms_span);
+}
+
+double SpindleDetector::baseline() const
+{
+    return (m_base_filled < SPINDLE_MIN_BASELINE_SEC || m_base_sum <= 0) ? 0 : sqrt(m_base_sum / m_base_filled);
+}
+
+int SpindleDetector::push(const double *EEG, int num_samples)
+{
+    m_events.clear();
+
+    // The first sample sets the electrode offset, so the high-pass does not start on a step
+    if (m_count == 0 && num_samples > 0) m_offset = EEG[0];
+
+    for (int done = 0; done < num_samples; done += m_max_samples) {
+        int n = num_samples - done;
+        if (n > m_max_samples) n = m_max_samples;
+
+        for (int i = 0; i < n; i++) m_block[i] = EEG[done + i] - m_offset;
+        m_filter->process(m_block, m_block, n, m_max_samples);
+
+        for (int i = 0; i < n; i++) {
+            double x = m_block[i];
+            double square = x * x;
+            m_count++;
+
+            // RMS window; the sum is rebuilt every lap so rounding can not build up
+            m_rms_sum += square - m_rms_ring[m_rms_pos];
+            m_rms_ring[m_rms_pos] = square;
+            if (++m_rms_pos == m_rms_span) {
+                m_rms_pos = 0;
+                m_rms_sum = 0;
+                for (int k = 0; k < m_rms_span; k++) m_rms_sum += m_rms_ring[k];
+            }
+
+            // Baseline, one mean square per second
+            m_second_sum += square;
+            if (++m_second_fill == m_Fs) {
+                double mean = m_second_sum / m_Fs;
+                m_base_sum += mean - m_base_ring[m_base_pos];
+                m_base_ring[m_base_pos] = mean;
+                if (++m_base_pos == m_base_span) m_base_pos = 0;
+                if (m_base_filled < m_base_span) m_base_filled++;
+                m_second_sum = 0;
+                m_second_fill = 0;
+            }
+
+            double level = rms(), base = baseline();
+            int crossing = (x >= 0) != (m_last >= 0);
+            m_last = x;
+
+            if (base <= 0) continue;
+
+            if (m_active) {
+                if (level > m_lower * base) {
+                    m_event.duration++;
+                    m_crossings += crossing;
+                    if (fabs(x) > m_event.amplitude) m_event.amplitude = fabs(x);
+                    if (level > m_upper * base) m_reached = 1;
+                    continue;
+                }
+                end_Event();
+            } else if (level > m_lower * base) {
+                m_active = 1;
+                m_reached = level > m_upper * base;
+                m_crossings = 0;
+                m_event.onset = m_count - 1 - m_rms_span / 2;
+                m_event.duration = 1;
+                m_event.amplitude = fabs(x);
+            }
+        }
+    }
+
+    return m_events.size();
+}
+
+void SpindleDetector::end_Event()
+{
+    m_active = 0;
+
+    if (m_reached && m_event.duration >= m_min_duration && m_event.duration <= m_max_duration) {
+        m_event.frequency = 0.5 * m_crossings * m_Fs / m_event.duration;
+        m_events.push_back(m_event);
+    }
+}
+
+SpindleDetector::~SpindleDetector()
+{
+    delete m_filter;
+    delete[] m_block;
+    delete[] m_rms_ring;
+    delete[] m_base_ring;
+}
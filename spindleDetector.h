@@ -0,0 +1,120 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+#ifndef SPINDLEDETECTOR_H
+#define SPINDLEDETECTOR_H
+
+#include <vector>
+
+class FilterBank;
+
+/* STREAMING SLEEP SPINDLE DETECTOR FOR ONE EEG CHANNEL
+ *
+ * The EEG is band-passed to the sigma band (coeffs_sigma, 11 to 16 hz) with a
+ * FilterBank block by block, and its RMS is followed over 200 ms in a ring of
+ * squared samples. The baseline is the RMS of the last 5 minutes, kept as a ring
+ * of per-second mean squares. A spindle is a stretch where the RMS stays above
+ * the lower factor of the baseline, reaches the upper factor and lasts 0.5 to
+ * 3 seconds. Detection starts once 30 seconds of baseline are in.
+ *
+ * A spindle is reported when it ends; onset and duration are in samples, counted
+ * from the first sample pushed and centred on the RMS window. The design is for
+ * 250 hz, like the other IIR_Coeffs.cpp designs.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        SpindleDetector(Sampling Frequency, max samples per push)
+    2. (Optional) Set the RMS factors over the baseline, defaults are 2 and 3:
+        SpindleDetector.set_limits(lower, upper);
+    3. Push the EEG as it arrives, e.g. Pipeline.block_Output(PIPELINE_EEG):
+        FOR i < SpindleDetector.push(EEG, # of samples):
+            SpindleDetector.event(i).onset, .duration, .amplitude, .frequency
+ *
+ */
+
+struct SpindleEvent {
+    long long onset;        // sample
+    int duration;           // samples
+    double amplitude;       // largest sigma band sample, input units (uV)
+    double frequency;       // hz, from the zero crossings
+};
+
+class SpindleDetector
+{
+public:
+    SpindleDetector(int Fs, int max_samples);
+    ~SpindleDetector();
+
+    void set_limits(double lower, double upper);
+    int push(const double *EEG, int num_samples);
+
+    // Spindles that ended in the last push
+    const SpindleEvent &event(int i) const { return m_events[i]; }
+
+    // Sigma band RMS over the last 200 ms and its baseline, 0 until known
+    double rms() const;
+    double baseline() const;
+
+private:
+    SpindleDetector(const SpindleDetector &);
+    SpindleDetector &operator=(const SpindleDetector &);
+
+    void end_Event();
+
+    int m_Fs;
+    int m_max_samples;
+    double m_lower, m_upper;
+
+    FilterBank *m_filter;
+    double *m_block;
+    double m_offset;
+    long long m_count;
+
+    // Squared sigma samples of the RMS window, oldest at m_rms_pos
+    double *m_rms_ring;
+    int m_rms_span, m_rms_pos;
+    double m_rms_sum;
+
+    // Mean square of each of the last seconds, oldest at m_base_pos
+    double *m_base_ring;
+    int m_base_span, m_base_pos, m_base_filled;
+    double m_base_sum;
+    double m_second_sum;
+    int m_second_fill;
+
+    int m_min_duration, m_max_duration;
+
+    // Spindle being followed
+    int m_active, m_reached;
+    int m_crossings;
+    double m_last;
+    SpindleEvent m_event;
+
+    std::vector<SpindleEvent> m_events;
+
+};
+
+#endif // SPINDLEDETECTOR_H
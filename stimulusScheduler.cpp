@@ -0,0 +1,360 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "stimulusScheduler.h"
+#include "biquadCascade.h"
+#include <math.h>
+
+const double STIM_HP_FREQ = 0.4;
+const double STIM_LP_FREQ = 2.0;
+
+// Loop bandwidth and damping of the phase-locked loop, range its frequency stays in
+const double STIM_LOOP_HZ = 0.25;
+const double STIM_LOOP_DAMPING = 0.7;
+const double STIM_LOOP_MIN_HZ = 0.3;
+const double STIM_LOOP_MAX_HZ = 2.5;
+
+// Time constant of the amplitude, and how long the band-pass and loop settle
+const double STIM_AMPLITUDE_SEC = 1.0;
+const double STIM_WARMUP_SEC = 5.0;
+
+// Arousal: alpha power of the last window this far over its level, which follows
+// the seconds without one over about a minute, once it has settled
+const double STIM_AROUSAL_LOW_HZ = 8.0;
+const double STIM_AROUSAL_HIGH_HZ = 11.0;
+const double STIM_AROUSAL_WINDOW_SEC = 2.0;
+const double STIM_AROUSAL_DB = 6.0;
+const int STIM_AROUSAL_LEVEL_SEC = 60;
+const int STIM_AROUSAL_SETTLE_SEC = 30;
+
+// A plan this close to firing is kept, and none is made closer than the minimum lead
+const double STIM_LOCK_SEC = 0.05;
+const double STIM_MIN_LEAD_SEC = 0.005;
+
+// A plan that was not fired by then is taken as lost, its output never started
+const double STIM_LOST_SEC = 1.0;
+
+// Measuring: EEG kept, around each stimulus, and the half length of the Hilbert transformer
+const double STIM_RAW_SEC = 8.0;
+const double STIM_BEFORE_SEC = 3.0;
+const double STIM_AFTER_SEC = 3.0;
+const double STIM_HILBERT_SEC = 2.0;
+
+const int STIM_QUEUE = 8;
+
+static double wrap_Pi(double x)
+{
+    x = fmod(x + M_PI, 2 * M_PI);
+    if (x < 0) x += 2 * M_PI;
+    return x - M_PI;
+}
+
+StimulusScheduler::StimulusScheduler(int Fs)
+{
+    m_Fs = Fs;
+    set_Target(0);
+    set_Latency(0);
+    set_limits(30, 0.5, 1.5, 2.5);
+    m_armed = 0;
+
+    // 2nd order Butterworth high-pass and low-pass, bilinear transform
+    double k = tan(M_PI * STIM_HP_FREQ / Fs);
+    double norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+    m_coeffs[0] = norm;
+    m_coeffs[1] = -2.0 * norm;
+    m_coeffs[2] = norm;
+    m_coeffs[3] = 2.0 * (k * k - 1.0) * norm;
+    m_coeffs[4] = (1.0 - M_SQRT2 * k + k * k) * norm;
+
+    k = tan(M_PI * STIM_LP_FREQ / Fs);
+    norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+    m_coeffs[5] = k * k * norm;
+    m_coeffs[6] = 2.0 * m_coeffs[5];
+    m_coeffs[7] = m_coeffs[5];
+    m_coeffs[8] = 2.0 * (k * k - 1.0) * norm;
+    m_coeffs[9] = (1.0 - M_SQRT2 * k + k * k) * norm;
+
+    m_s1[0] = m_s1[1] = m_s2[0] = m_s2[1] = 0;
+    m_offset = 0;
+    m_count = 0;
+
+    // Type 2 loop on e = 0.5 sin(phase error): wn^2 = 0.5 ki Fs, 2 zeta wn = 0.5 kp Fs
+    double wn = 2 * M_PI * STIM_LOOP_HZ;
+    m_kp = 4 * STIM_LOOP_DAMPING * wn / Fs;
+    m_ki = 2 * wn * wn / Fs;
+    m_phase = 0;
+    m_omega = 2 * M_PI * 0.8;
+    m_amplitude = 0;
+    m_amplitude_decay = 1.0 / (STIM_AMPLITUDE_SEC * Fs);
+
+    int alpha_window = (int) (STIM_AROUSAL_WINDOW_SEC * Fs);
+    int alpha_fft = 1;
+    while (alpha_fft < alpha_window) alpha_fft *= 2;
+    m_alpha = new BandTracker(Fs, alpha_fft, alpha_window, (int) STIM_AROUSAL_LOW_HZ, (int) STIM_AROUSAL_HIGH_HZ);
+    m_alpha_level = 0;
+    m_alpha_seconds = 0;
+    m_aroused = 0;
+
+    m_raw_span = (int) (STIM_RAW_SEC * Fs);
+    m_raw = new double[m_raw_span];
+    for (int i = 0; i < m_raw_span; i++) m_raw[i] = 0;
+    m_raw_pos = 0;
+    m_segment = new double[(int) ((STIM_BEFORE_SEC + STIM_AFTER_SEC) * Fs)];
+
+    // Windowed ideal Hilbert transformer, odd taps only
+    m_hilbert_half = (int) (STIM_HILBERT_SEC * Fs);
+    m_hilbert = new double[m_hilbert_half + 1];
+    for (int i = 0; i <= m_hilbert_half; i++)
+        m_hilbert[i] = (i % 2) ? 2.0 / (M_PI * i) * (0.54 + 0.46 * cos(M_PI * i / m_hilbert_half)) : 0.0;
+
+    m_pending = 0;
+    m_plan_fire = m_plan_latency = 0;
+    m_last_fire = -HUGE_VAL;
+
+    m_queue_head = m_queue_count = 0;
+
+    m_measured = 0;
+    m_sum_cos = m_sum_sin = 0;
+    m_sum_latency = m_sum_timer = m_max_timer = 0;
+}
+
+void StimulusScheduler::set_Target(double phase_deg)
+{
+    m_target = phase_deg * M_PI / 180.0;
+}
+
+void StimulusScheduler::set_Latency(double output_sec)
+{
+    m_output_latency = output_sec;
+}
+
+void StimulusScheduler::set_limits(double min_amplitude, double min_freq, double max_freq, double refractory_sec)
+{
+    m_min_amplitude = min_amplitude;
+    m_min_freq = min_freq;
+    m_max_freq = max_freq;
+    m_refractory = refractory_sec;
+}
+
+void StimulusScheduler::push(double sample)
+{
+    // The first sample sets the electrode offset, so the high-pass does not start on a step
+    if (m_count == 0) m_offset = sample;
+
+    // Alpha is tracked after the high-pass only, the low-pass is for the loop
+    double y = biquad_Section(m_coeffs, m_s1[0], m_s2[0], sample - m_offset);
+    m_alpha->push(&y, 1);
+    y = biquad_Section(m_coeffs + 5, m_s1[1], m_s2[1], y);
+
+    // Loop on y = amplitude * cos(phase)
+    m_phase += m_omega / m_Fs;
+    double e = -y * sin(m_phase) / ((m_amplitude > 1e-6) ? m_amplitude : 1e-6);
+    if (e > 1) e = 1;
+    if (e < -1) e = -1;
+    m_phase = wrap_Pi(m_phase + m_kp * e);
+    m_omega += m_ki * e;
+    if (m_omega < 2 * M_PI * STIM_LOOP_MIN_HZ) m_omega = 2 * M_PI * STIM_LOOP_MIN_HZ;
+    if (m_omega > 2 * M_PI * STIM_LOOP_MAX_HZ) m_omega = 2 * M_PI * STIM_LOOP_MAX_HZ;
+
+    // Mean of |y| is 2 / pi of the amplitude
+    m_amplitude += (fabs(y) * M_PI / 2 - m_amplitude) * m_amplitude_decay;
+
+    // The alpha level follows the seconds without an arousal
+    if ((m_count + 1) % m_Fs == 0 && m_alpha->ready() && !arousal()) {
+        int seconds = (m_alpha_seconds < STIM_AROUSAL_LEVEL_SEC) ? ++m_alpha_seconds : STIM_AROUSAL_LEVEL_SEC;
+        m_alpha_level += (m_alpha->band_Power() - m_alpha_level) / seconds;
+    }
+
+    m_raw[m_raw_pos] = sample;
+    if (++m_raw_pos == m_raw_span) m_raw_pos = 0;
+    m_count++;
+}
+
+// 1 while the alpha power of the last window is an arousal over its level
+int StimulusScheduler::arousal()
+{
+    m_aroused = m_alpha->ready() && m_alpha_seconds >= STIM_AROUSAL_SETTLE_SEC &&
+                m_alpha->band_Power() > m_alpha_level + STIM_AROUSAL_DB;
+
+    return m_aroused;
+}
+
+// How far the band-pass delays the phase at a frequency, in rad
+double StimulusScheduler::filter_Lag(double freq) const
+{
+    double w = 2 * M_PI * freq / m_Fs;
+    double lag = 0;
+
+    for (int k = 0; k < 2; k++) {
+        const double *c = m_coeffs + k * 5;
+        double num_re = c[0] + c[1] * cos(w) + c[2] * cos(2 * w);
+        double num_im = -c[1] * sin(w) - c[2] * sin(2 * w);
+        double den_re = 1.0 + c[3] * cos(w) + c[4] * cos(2 * w);
+        double den_im = -c[3] * sin(w) - c[4] * sin(2 * w);
+        lag -= atan2(num_im, num_re) - atan2(den_im, den_re);
+    }
+    return lag;
+}
+
+double StimulusScheduler::frequency() const
+{
+    return m_omega / (2 * M_PI);
+}
+
+double StimulusScheduler::phase() const
+{
+    return wrap_Pi(m_phase + filter_Lag(frequency())) * 180.0 / M_PI;
+}
+
+// All in samples, now being the sample taken at this moment
+int StimulusScheduler::plan(double now, double *fire)
+{
+    double freq = frequency();
+    if (m_pending && now > m_plan_fire + STIM_LOST_SEC * m_Fs) m_pending = 0;
+
+    if (!m_armed || m_count < STIM_WARMUP_SEC * m_Fs || m_amplitude < m_min_amplitude ||
+        freq < m_min_freq || freq > m_max_freq || now < m_last_fire + m_refractory * m_Fs || arousal()) {
+        if (m_pending && m_plan_fire - now > STIM_LOCK_SEC * m_Fs) {
+            m_pending = 0;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (m_pending && m_plan_fire - now <= STIM_LOCK_SEC * m_Fs) return 0;
+
+    // The last sample, and the phase still to go from it
+    double taken = (double) (m_count - 1);
+    double to_go = fmod(m_target - (m_phase + filter_Lag(freq)), 2 * M_PI);
+    if (to_go <= 0) to_go += 2 * M_PI;
+
+    double land = taken + to_go / (2 * M_PI * freq) * m_Fs;
+    double output = m_output_latency * m_Fs;
+    while (land - output < now + STIM_MIN_LEAD_SEC * m_Fs) land += m_Fs / freq;
+
+    double at = land - output;
+    if (m_pending && fabs(at - m_plan_fire) < 0.001 * m_Fs) return 0;
+
+    m_pending = 1;
+    m_plan_fire = at;
+    m_plan_latency = (land - taken) / m_Fs;
+    *fire = at;
+    return 1;
+}
+
+void StimulusScheduler::fired(double sample)
+{
+    if (!m_pending) return;
+
+    m_pending = 0;
+    m_last_fire = sample;
+    if (m_queue_count == STIM_QUEUE) return;
+
+    StimulusResult &r = m_queue[(m_queue_head + m_queue_count++) % STIM_QUEUE];
+    r.sample = (long long) floor(sample + m_output_latency * m_Fs + 0.5);
+    r.timer_error = (sample - m_plan_fire) / m_Fs;
+    r.latency = m_plan_latency + r.timer_error;
+    r.phase = r.error = 0;
+}
+
+int StimulusScheduler::measure(StimulusResult &result)
+{
+    int before = (int) (STIM_BEFORE_SEC * m_Fs), after = (int) (STIM_AFTER_SEC * m_Fs);
+
+    while (m_queue_count && m_count >= m_queue[m_queue_head].sample + after) {
+        StimulusResult r = m_queue[m_queue_head];
+        m_queue_head = (m_queue_head + 1) % STIM_QUEUE;
+        m_queue_count--;
+
+        // Too old for the samples kept, e.g. after a pause in the data
+        if (r.sample - before < m_count - m_raw_span) continue;
+
+        r.phase = landed_Phase(r.sample) * 180.0 / M_PI;
+        double error = wrap_Pi(r.phase * M_PI / 180.0 - m_target);
+        r.error = error * 180.0 / M_PI;
+
+        m_measured++;
+        m_sum_cos += cos(error);
+        m_sum_sin += sin(error);
+        m_sum_latency += r.latency;
+        m_sum_timer += r.timer_error;
+        if (fabs(r.timer_error) > fabs(m_max_timer)) m_max_timer = r.timer_error;
+
+        result = r;
+        return 1;
+    }
+    return 0;
+}
+
+// Phase at a sample from the zero-phase band-pass of the samples around it
+double StimulusScheduler::landed_Phase(long long sample)
+{
+    int before = (int) (STIM_BEFORE_SEC * m_Fs), after = (int) (STIM_AFTER_SEC * m_Fs);
+    int length = before + after;
+    long long first = sample - before, oldest = m_count - m_raw_span;
+
+    double mean = 0;
+    for (int i = 0; i < length; i++) {
+        m_segment[i] = m_raw[(m_raw_pos + (int) (first + i - oldest)) % m_raw_span];
+        mean += m_segment[i];
+    }
+    mean /= length;
+    for (int i = 0; i < length; i++) m_segment[i] -= mean;
+
+    for (int k = 0; k < 2; k++) {
+        double s1 = 0, s2 = 0;
+        for (int i = 0; i < length; i++) m_segment[i] = biquad_Section(m_coeffs + k * 5, s1, s2, m_segment[i]);
+        s1 = s2 = 0;
+        for (int i = length - 1; i >= 0; i--) m_segment[i] = biquad_Section(m_coeffs + k * 5, s1, s2, m_segment[i]);
+    }
+
+    double quadrature = 0;
+    for (int i = 1; i <= m_hilbert_half && i <= before && before + i < length; i += 2)
+        quadrature += m_hilbert[i] * (m_segment[before - i] - m_segment[before + i]);
+
+    return atan2(quadrature, m_segment[before]);
+}
+
+double StimulusScheduler::mean_Error() const
+{
+    return m_measured ? atan2(m_sum_sin, m_sum_cos) * 180.0 / M_PI : 0;
+}
+
+// Circular standard deviation
+double StimulusScheduler::error_SD() const
+{
+    if (!m_measured) return 0;
+
+    double R = sqrt(m_sum_cos * m_sum_cos + m_sum_sin * m_sum_sin) / m_measured;
+    return sqrt(-2.0 * log(R > 1e-12 ? R : 1e-12)) * 180.0 / M_PI;
+}
+
+StimulusScheduler::~StimulusScheduler()
+{
+    delete[] m_raw;
+    delete[] m_segment;
+    delete[] m_hilbert;
+    delete m_alpha;
+}
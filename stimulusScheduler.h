@@ -0,0 +1,172 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+
+#ifndef STIMULUSSCHEDULER_H
+#define STIMULUSSCHEDULER_H
+
+#include "bandTracker.h"
+
+/* PHASE-LOCKED STIMULUS SCHEDULING ON SLOW OSCILLATIONS
+ *
+ * Follows the instantaneous phase of the slow oscillation in one EEG channel
+ * sample by sample and plans the next stimulus so it lands on a target phase
+ * (0 deg is the positive peak, the up-state; 180 deg the trough):
+ *   - The EEG is band-passed to 0.4 - 2 hz (2nd order Butterworth each side) and
+ *     a phase-locked loop (0.25 hz loop bandwidth) tracks its phase and frequency.
+ *     The phase lag of the band-pass at the tracked frequency is added back.
+ *   - Times are EEG samples, counted from the first one pushed, and may be
+ *     fractional. Mapping them to a wall clock is up to the caller, e.g. the sample
+ *     clock of cueEngine.h, which also takes the transport latency into account.
+ *   - The stimulus is planned from the latest sample: the samples until the target
+ *     phase at the tracked frequency, less the output latency of the stimulus.
+ *     Every plan() call refines it with the samples pushed since, until it is
+ *     50 ms away.
+ * Only when armed, the oscillation is at least the minimum amplitude and within
+ * the frequency limits, the refractory time after the last stimulus is over, and
+ * there is no arousal: 8 - 11 hz power of the last 2 s (a BandTracker on the
+ * high-passed EEG, read at every plan() call) more than 6 dB over its level of the
+ * last minute without one. This reacts within a burst of samples, long before the
+ * 30 s sleep stage does.
+ *
+ * Each stimulus is measured once 3 s of EEG after it are in: the phase it landed
+ * on, from a zero-phase band-pass and a windowed Hilbert transform of the 6 s
+ * around it, its error against the target, the timer error (fired against
+ * planned) and the end-to-end latency, from the moment the last sample the plan
+ * used was taken to the stimulus reaching the subject. The output latency set
+ * with set_Latency() is taken as given, so it should come from a measurement.
+ *
+ * HOW TO USE
+    1. Initialize object:
+        StimulusScheduler(Sampling Frequency)
+    2. (Optional) Set the target, output latency (s) and limits:
+        StimulusScheduler.set_Target(phase in deg);
+        StimulusScheduler.set_Latency(output);
+        StimulusScheduler.set_limits(min amplitude uV, min freq, max freq, refractory s);
+    3. Arm it while stimulation is wanted (e.g. in N2 and N3):
+        StimulusScheduler.arm(1);
+    4. Push every EEG sample:
+        StimulusScheduler.push(sample);
+    5. After each burst of samples, with the EEG sample it is now (taken now):
+        IF StimulusScheduler.plan(now, &fire) RETURNS 1: (re)schedule the output for sample fire
+        IF IT RETURNS -1: cancel the output
+    6. Once the output started, with the sample it did at (e.g. the onset from cueEngine.h):
+        StimulusScheduler.fired(sample);
+    7. WHILE StimulusScheduler.measure(result) RETURNS 1: result holds a measured stimulus
+ *
+ */
+
+struct StimulusResult {
+    long long sample;       // EEG sample the stimulus reached the subject at
+    double phase;           // deg, what it landed on
+    double error;           // deg, against the target, -180 to 180
+    double latency;         // s, last sample used to stimulus
+    double timer_error;     // s, fired against planned
+};
+
+class StimulusScheduler
+{
+public:
+    StimulusScheduler(int Fs);
+    ~StimulusScheduler();
+
+    void set_Target(double phase_deg);
+    void set_Latency(double output_sec);
+    void set_limits(double min_amplitude, double min_freq, double max_freq, double refractory_sec);
+    void arm(int armed) { m_armed = armed; }
+
+    void push(double sample);
+    int plan(double now, double *fire);
+    void fired(double sample);
+    int measure(StimulusResult &result);
+
+    // Tracked oscillation at the last sample, phase in deg
+    double phase() const;
+    double frequency() const;
+    double amplitude() const { return m_amplitude; }
+    int aroused() const { return m_aroused; }
+
+    // Over all measured stimuli
+    int stimuli() const { return m_measured; }
+    double mean_Error() const;
+    double error_SD() const;
+    double mean_Latency() const { return m_measured ? m_sum_latency / m_measured : 0; }
+    double mean_Timer_Error() const { return m_measured ? m_sum_timer / m_measured : 0; }
+    double max_Timer_Error() const { return m_max_timer; }
+
+private:
+    StimulusScheduler(const StimulusScheduler &);
+    StimulusScheduler &operator=(const StimulusScheduler &);
+
+    double filter_Lag(double freq) const;
+    double landed_Phase(long long sample);
+
+    int m_Fs;
+    double m_target;
+    double m_output_latency;
+    double m_min_amplitude, m_min_freq, m_max_freq, m_refractory;
+    int m_armed;
+
+    // Band-pass, and the offset the high-pass starts from
+    double m_coeffs[5 * 2];
+    double m_s1[2], m_s2[2];
+    double m_offset;
+    long long m_count;
+
+    // Phase-locked loop, phase in rad and frequency in rad/s
+    double m_phase, m_omega;
+    double m_kp, m_ki;
+    double m_amplitude, m_amplitude_decay;
+
+    // Alpha power of the high-passed EEG, and its level while there was no arousal
+    int arousal();
+    BandTracker *m_alpha;
+    double m_alpha_level;
+    int m_alpha_seconds;
+    int m_aroused;
+
+    // Raw samples for measuring, oldest at m_raw_pos
+    double *m_raw;
+    int m_raw_span, m_raw_pos;
+    double *m_segment;
+    double *m_hilbert;
+    int m_hilbert_half;
+
+    // Stimulus being planned, in samples
+    int m_pending;
+    double m_plan_fire, m_plan_latency;
+    double m_last_fire;
+
+    // Fired stimuli waiting for the EEG after them
+    StimulusResult m_queue[8];
+    int m_queue_head, m_queue_count;
+
+    int m_measured;
+    double m_sum_cos, m_sum_sin;
+    double m_sum_latency, m_sum_timer, m_max_timer;
+
+};
+
+#endif // STIMULUSSCHEDULER_H
@@ -0,0 +1,282 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+/* WHOLE-NIGHT IIR FILTERING OF BDF/EDF RECORDINGS
+ *
+ * Filters every channel at the analysis rate (or the channels named with -l) of
+ * a recording as one signal from start to end, through the pipeline's IIR designs
+ * in order (see IIR_Coeffs.cpp), and writes a BDF+ with those channels replaced.
+ * The other channels and the annotations are copied unchanged. Chunks of all
+ * channels are filtered on all cores by ParallelIIR; -z filters forward and
+ * backward for zero phase. The time spent filtering is reported.
+ *
+ * USAGE
+ *     bdfFilter [-j threads] [-l label,...] [-z] -f design,... recording.bdf filtered.bdf
+ */
+
+#include "../parallelIIR.h"
+#include "../pipeline.h"
+#include "../analysisConstants.h"
+#include "../edflib.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Samples read per call, edfread_physical_samples() takes an int
+const int READ_CHUNK = 1 << 20;
+
+static std::vector<std::string> split_List(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+// Header fields come padded with spaces
+static std::string trim_Spaces(const char *field)
+{
+    std::string text(field);
+    size_t end = text.find_last_not_of(' ');
+    return (end == std::string::npos) ? std::string() : text.substr(0, end + 1);
+}
+
+// Same header, signals and annotations as the input; the output is removed on failure
+static int write_Filtered(const struct edf_hdr_struct &hdr, const char *path, const std::vector<int> &filtered,
+                          std::vector<double> &data, long long samples, const std::string &prefilter)
+{
+    int out = edfopen_file_writeonly(path, EDFLIB_FILETYPE_BDFPLUS, hdr.edfsignals);
+    if (out < 0) return -1;
+
+    int error = 0;
+    for (int s = 0; s < hdr.edfsignals; s++) {
+        const struct edf_param_struct &param = hdr.signalparam[s];
+        std::string filter = trim_Spaces(param.prefilter);
+        if (filtered[s] >= 0) filter += (filter.empty() ? "" : " ") + prefilter;
+
+        error |= edf_set_samplefrequency(out, s, (int) (param.smp_in_datarecord * EDFLIB_TIME_DIMENSION / hdr.datarecord_duration));
+        error |= edf_set_physical_maximum(out, s, param.phys_max);
+        error |= edf_set_physical_minimum(out, s, param.phys_min);
+        error |= edf_set_digital_maximum(out, s, param.dig_max);
+        error |= edf_set_digital_minimum(out, s, param.dig_min);
+        error |= edf_set_label(out, s, param.label);
+        error |= edf_set_physical_dimension(out, s, param.physdimension);
+        error |= edf_set_transducer(out, s, param.transducer);
+        error |= edf_set_prefilter(out, s, filter.substr(0, 80).c_str());
+    }
+
+    if (hdr.datarecord_duration != EDFLIB_TIME_DIMENSION)
+        error |= edf_set_datarecord_duration(out, (int) (hdr.datarecord_duration / 100));
+    error |= edf_set_startdatetime(out, hdr.startdate_year, hdr.startdate_month, hdr.startdate_day,
+                                   hdr.starttime_hour, hdr.starttime_minute, hdr.starttime_second);
+    edf_set_patientname(out, hdr.patient_name);
+    edf_set_patientcode(out, hdr.patientcode);
+    edf_set_patient_additional(out, hdr.patient_additional);
+    edf_set_admincode(out, hdr.admincode);
+    edf_set_technician(out, hdr.technician);
+    edf_set_equipment(out, hdr.equipment);
+    edf_set_recording_additional(out, hdr.recording_additional);
+
+    // Room for as many annotations per record as the input had on average
+    long long records = hdr.datarecords_in_file;
+    long long slots = records > 0 ? (hdr.annotations_in_file + records - 1) / records : 1;
+    edf_set_number_of_annotation_signals(out, (int) (slots < 1 ? 1 : (slots > 64 ? 64 : slots)));
+
+    std::vector<int> digital;
+    for (long long r = 0; r < records && !error; r++) {
+        for (int s = 0; s < hdr.edfsignals && !error; s++) {
+            int length = hdr.signalparam[s].smp_in_datarecord;
+
+            if (filtered[s] >= 0) {
+                error |= edfwrite_physical_samples(out, &data[filtered[s] * samples + r * length]);
+            } else {
+                digital.resize(length);
+                if (edfread_digital_samples(hdr.handle, s, length, &digital[0]) != length) error = -1;
+                else error |= edfwrite_digital_samples(out, &digital[0]);
+            }
+        }
+    }
+
+    for (long long n = 0; n < hdr.annotations_in_file && !error; n++) {
+        struct edf_annotation_struct annotation;
+        if (edf_get_annotation(hdr.handle, (int) n, &annotation)) continue;
+
+        long long duration = annotation.duration[0] ? (long long) (atof(annotation.duration) * 10000 + 0.5) : -1;
+        error |= edfwrite_annotation_utf8(out, annotation.onset / 1000, duration, annotation.annotation);
+    }
+
+    edfclose_file(out);
+    if (error) remove(path);
+    return error ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files, labels, designs;
+    int threads = (int) std::thread::hardware_concurrency();
+    int zero_phase = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+
+        if ((arg == "-j" || arg == "-l" || arg == "-f") && i + 1 < argc) {
+            std::string value(argv[++i]);
+
+            if (arg == "-j") threads = atoi(value.c_str());
+            else if (arg == "-l") labels = split_List(value);
+            else designs = split_List(value);
+
+        } else if (arg == "-z") {
+            zero_phase = 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size() != 2 || designs.empty()) {
+        std::cerr << "Usage: bdfFilter [-j threads] [-l label,...] [-z] -f design,... recording.bdf filtered.bdf\n"
+                     "       designs: hp, lp, hp_EOG, sigma, slow\n";
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    std::vector<const double *> coeffs(designs.size());
+    std::vector<int> stages(designs.size());
+    for (size_t d = 0; d < designs.size(); d++) {
+        if (Pipeline::iir_Design(designs[d], &coeffs[d], &stages[d])) {
+            std::cerr << designs[d] << ": unknown design, use hp, lp, hp_EOG, sigma or slow\n";
+            return 1;
+        }
+    }
+
+    struct edf_hdr_struct *hdr = new struct edf_hdr_struct;
+    if (edfopen_file_readonly(files[0].c_str(), hdr, EDFLIB_READ_ALL_ANNOTATIONS)) {
+        std::cerr << "Can not open " << files[0] << "\n";
+        delete hdr;
+        return 1;
+    }
+
+    // The output is written continuously, it can not keep the gaps
+    if (hdr->discontinuous) {
+        std::cerr << files[0] << " has gaps (BDF+D/EDF+D), filter its segments separately\n";
+        edfclose_file(hdr->handle);
+        delete hdr;
+        return 1;
+    }
+
+    // The designs are for the analysis rate; filtered[s] is the row of signal s in data, -1 if copied
+    std::vector<int> filtered(hdr->edfsignals, -1);
+    int channels = 0;
+    long long samples = 0;
+    int error = 0;
+
+    for (size_t l = 0; l < labels.size() && !error; l++) {
+        int found = 0;
+        for (int s = 0; s < hdr->edfsignals; s++) found |= (trim_Spaces(hdr->signalparam[s].label) == labels[l]);
+        if (!found) {
+            std::cerr << "No channel " << labels[l] << " in " << files[0] << "\n";
+            error = 1;
+        }
+    }
+
+    for (int s = 0; s < hdr->edfsignals && !error; s++) {
+        const struct edf_param_struct &param = hdr->signalparam[s];
+        int rate = (int) (param.smp_in_datarecord * EDFLIB_TIME_DIMENSION / hdr->datarecord_duration);
+        int named = labels.empty();
+
+        for (size_t l = 0; l < labels.size(); l++) named |= (trim_Spaces(param.label) == labels[l]);
+        if (!named) continue;
+
+        if (rate != ANALYSIS_FREQ) {
+            if (labels.empty()) continue;
+            std::cerr << "Channel " << trim_Spaces(param.label) << " is not at the analysis rate of " << ANALYSIS_FREQ << " Hz\n";
+            error = 1;
+        } else {
+            filtered[s] = channels++;
+            samples = param.smp_in_file;
+        }
+    }
+
+    if (!error && !channels) {
+        std::cerr << "No channel at the analysis rate of " << ANALYSIS_FREQ << " Hz in " << files[0] << "\n";
+        error = 1;
+    }
+    if (error) {
+        edfclose_file(hdr->handle);
+        delete hdr;
+        return 1;
+    }
+
+    // Whole channels, one after the other
+    std::vector<double> data((size_t) channels * samples);
+    for (int s = 0; s < hdr->edfsignals && !error; s++) {
+        if (filtered[s] < 0) continue;
+
+        double *row = &data[filtered[s] * samples];
+        for (long long done = 0; done < samples && !error; done += READ_CHUNK) {
+            int n = (int) (samples - done < READ_CHUNK ? samples - done : READ_CHUNK);
+            if (edfread_physical_samples(hdr->handle, s, n, row + done) != n) error = 1;
+        }
+    }
+    if (error) {
+        std::cerr << "Can not read " << files[0] << "\n";
+        edfclose_file(hdr->handle);
+        delete hdr;
+        return 1;
+    }
+
+    std::string prefilter = zero_phase ? "IIR zero phase:" : "IIR:";
+    for (size_t d = 0; d < designs.size(); d++) prefilter += (d ? "," : "") + designs[d];
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (size_t d = 0; d < designs.size(); d++) {
+        ParallelIIR filter(coeffs[d], stages[d], threads);
+        if (zero_phase) filter.filtfilt(&data[0], &data[0], samples, channels, samples);
+        else filter.filter(&data[0], &data[0], samples, channels, samples);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Filtered " << channels << " channels x " << (double) samples / ANALYSIS_FREQ / 3600 << " h ("
+              << prefilter << ") in " << seconds << " s on " << threads << " threads\n";
+
+    if (write_Filtered(*hdr, files[1].c_str(), filtered, data, samples, prefilter)) {
+        std::cerr << "Can not write " << files[1] << "\n";
+        error = 1;
+    }
+
+    edfclose_file(hdr->handle);
+    delete hdr;
+    return error;
+}
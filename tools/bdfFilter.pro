@@ -0,0 +1,43 @@
+#   Whole-night IIR filtering of a recording on all cores, part of the project OpenLD.
+#   Build from this directory and run on a recording:
+#       qmake && make && ./bdfFilter -j 8 -z -f hp_EOG,lp night1.bdf night1_filtered.bdf
+
+TARGET = bdfFilter
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+# For Windows
+LIBS     += -lfftw3-3
+
+# For Linux
+# LIBS     += -lfftw3
+# LIBS     += -lpthread
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += bdfFilter.cpp \
+        ../parallelIIR.cpp \
+        ../pipeline.cpp \
+        ../filterBank.cpp \
+        ../fixedFilterBank.cpp \
+        ../workspace.cpp \
+        ../polyphaseDecimator.cpp \
+        ../mainsNotch.cpp \
+        ../overlapSaveFIR.cpp \
+        ../edflib.c \
+        ../IIR_Coeffs.cpp
+
+HEADERS += ../analysisConstants.h \
+        ../parallelIIR.h \
+        ../pipeline.h \
+        ../filterBank.h \
+        ../fixedFilterBank.h \
+        ../biquadCascade.h \
+        ../workspace.h \
+        ../polyphaseDecimator.h \
+        ../mainsNotch.h \
+        ../overlapSaveFIR.h \
+        ../edflib.h
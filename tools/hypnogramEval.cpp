@@ -0,0 +1,259 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+/* OFFLINE SLEEP STAGING OF BDF/EDF RECORDINGS, WITH SCORING AGAINST REFERENCE HYPNOGRAMS
+ *
+ * Runs every recording through the same chains, remDetect and SleepStager as the
+ * live analysis, nights in parallel, and writes <recording>.hypnogram.csv with the
+ * stage and features of each epoch. When a reference is given, its stage annotations
+ * ("Sleep stage W/1/2/3/4/R", "W", "N1", "N2", "N3", "REM") are laid on the same
+ * epochs and the result is scored per night and pooled: accuracy, Cohen's kappa
+ * and the confusion matrix.
+ *
+ * USAGE
+ *     hypnogramEval [-j threads] [-a first analysis channel #] [-c pipeline.cfg] [-m sleep_model.txt]
+ *                   recording.bdf[=reference.edf] ...
+ */
+
+#include "nightReader.h"
+#include "../remDetect.h"
+#include "../sleepStager.h"
+#include "../sleepModel.h"
+#include "../pipeline.h"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+struct Night {
+    std::string recording, reference;
+    std::string error;
+    std::vector<int> hypnogram;
+    std::vector<int> truth;     // -1 where the reference has no stage
+};
+
+static std::string config_text;
+static std::string model_text;
+static int first_channel = 0;
+
+static int stage_Night(Night &night)
+{
+    NightReader reader;
+
+    if (reader.open(night.recording, first_channel, config_text)) {
+        night.error = reader.error();
+        return -1;
+    }
+
+    SleepStager stager(reader.features(), ANALYSIS_FREQ, FFT_WINDOW, REM_DATA_WINDOW, EPOCH_SEC);
+
+    // Every night has its own copy of the model (checked in main), predict() works in its buffers
+    SleepModel model;
+    if (!model_text.empty()) {
+        std::istringstream stream(model_text);
+        model.load(stream);
+        stager.set_Model(&model);
+    }
+
+    std::ofstream csv((night.recording + ".hypnogram.csv").c_str());
+    csv << "epoch, onset, stage, SEFd, AP, RP, delta, theta, alpha, sigma, beta, delta AP, EOG, EMG dB\n";
+
+    while (reader.next_Window()) {
+        if (!stager.add_Window(reader.spectrum(), reader.output(PIPELINE_EOG1), reader.output(PIPELINE_EOG2),
+                               reader.output(PIPELINE_EMG))) continue;
+
+        size_t epoch = night.hypnogram.size();
+        night.hypnogram.push_back(stager.stage);
+
+        csv << epoch << ", " << epoch * EPOCH_SEC << ", " << SleepStager::stage_Name(stager.stage) << ", "
+            << stager.avg_SEFd << ", " << stager.avg_AP << ", " << stager.avg_RP;
+        for (int b = 0; b < SLEEP_BANDS; b++) csv << ", " << stager.avg_Band[b];
+        csv << ", " << stager.avg_Delta_AP << ", " << stager.eog_Counter << ", "
+            << (stager.emg_Valid ? stager.emg_dB : 0) << "\n";
+    }
+
+    night.truth.assign(night.hypnogram.size(), -1);
+
+    if (!night.reference.empty()) {
+        std::vector<int> stages;
+        if (NightReader::read_Hypnogram(night.reference, stages, night.error)) return -1;
+
+        for (size_t e = 0; e < night.truth.size() && e < stages.size(); e++) night.truth[e] = stages[e];
+    }
+
+    return 0;
+}
+
+// Adds a night to the confusion matrix [reference][scored], returns the epochs used
+static long add_Confusion(const Night &night, long confusion[SLEEP_STAGES][SLEEP_STAGES])
+{
+    long used = 0;
+
+    for (size_t e = 0; e < night.truth.size(); e++) {
+        if (night.truth[e] < 0 || night.hypnogram[e] < 0) continue;
+        confusion[night.truth[e]][night.hypnogram[e]]++;
+        used++;
+    }
+
+    return used;
+}
+
+static void agreement(long confusion[SLEEP_STAGES][SLEEP_STAGES], double *accuracy, double *kappa)
+{
+    double total = 0, observed = 0, expected = 0;
+    double rows[SLEEP_STAGES] = { 0 }, cols[SLEEP_STAGES] = { 0 };
+
+    for (int i = 0; i < SLEEP_STAGES; i++)
+        for (int j = 0; j < SLEEP_STAGES; j++) {
+            total += confusion[i][j];
+            rows[i] += confusion[i][j];
+            cols[j] += confusion[i][j];
+        }
+
+    if (total <= 0) {
+        *accuracy = *kappa = 0;
+        return;
+    }
+
+    for (int i = 0; i < SLEEP_STAGES; i++) {
+        observed += confusion[i][i] / total;
+        expected += (rows[i] / total) * (cols[i] / total);
+    }
+
+    *accuracy = observed;
+    *kappa = (expected < 1) ? (observed - expected) / (1 - expected) : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<Night> nights;
+    int threads = (int) std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+
+        if ((arg == "-j" || arg == "-a" || arg == "-c" || arg == "-m") && i + 1 < argc) {
+            std::string value(argv[++i]);
+
+            if (arg == "-j") threads = atoi(value.c_str());
+            else if (arg == "-a") first_channel = atoi(value.c_str()) - 1;
+            else {
+                std::ifstream file(value.c_str());
+                if (!file.is_open()) {
+                    std::cerr << "Can not open " << value << "\n";
+                    return 1;
+                }
+                std::ostringstream text;
+                text << file.rdbuf();
+                (arg == "-c" ? config_text : model_text) = text.str();
+            }
+
+        } else {
+            Night night;
+            size_t split = arg.find('=');
+            night.recording = arg.substr(0, split);
+            if (split != std::string::npos) night.reference = arg.substr(split + 1);
+            nights.push_back(night);
+        }
+    }
+
+    if (nights.empty() || first_channel < 0) {
+        std::cerr << "Usage: hypnogramEval [-j threads] [-a first analysis channel #] [-c pipeline.cfg] [-m sleep_model.txt]\n"
+                     "                     recording.bdf[=reference.edf] ...\n";
+        return 1;
+    }
+
+    if (!model_text.empty()) {
+        SleepModel model;
+        SleepStager stager(0, ANALYSIS_FREQ, FFT_WINDOW, REM_DATA_WINDOW, EPOCH_SEC);
+        std::istringstream stream(model_text);
+
+        if (model.load(stream) || stager.set_Model(&model)) {
+            std::cerr << "Sleep model: " << (model.error().empty() ? "does not fit the sleep stager" : model.error()) << "\n";
+            return 1;
+        }
+    }
+
+    if (threads < 1) threads = 1;
+    if (threads > (int) nights.size()) threads = (int) nights.size();
+
+    // Workers take the next night until none are left
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.push_back(std::thread([&]() {
+            for (int n = next++; n < (int) nights.size(); n = next++) stage_Night(nights[n]);
+        }));
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    long pooled[SLEEP_STAGES][SLEEP_STAGES] = { { 0 } };
+    int failed = 0;
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t n = 0; n < nights.size(); n++) {
+        const Night &night = nights[n];
+        std::cout << night.recording << ": ";
+
+        if (!night.error.empty()) {
+            std::cout << night.error << "\n";
+            failed++;
+            continue;
+        }
+
+        std::cout << night.hypnogram.size() << " epochs";
+
+        if (!night.reference.empty()) {
+            long confusion[SLEEP_STAGES][SLEEP_STAGES] = { { 0 } };
+            long used = add_Confusion(night, confusion);
+            add_Confusion(night, pooled);
+
+            double accuracy, kappa;
+            agreement(confusion, &accuracy, &kappa);
+            std::cout << ", " << used << " scored, accuracy " << accuracy << ", kappa " << kappa;
+        }
+        std::cout << "\n";
+    }
+
+    double accuracy, kappa;
+    agreement(pooled, &accuracy, &kappa);
+
+    std::cout << "\nPooled accuracy " << accuracy << ", kappa " << kappa << "\n"
+              << "Reference (rows) against scored (columns):\n" << std::setw(6) << "";
+    const char *short_names[SLEEP_STAGES] = { "W", "N1", "N2", "N3", "REM" };
+    for (int j = 0; j < SLEEP_STAGES; j++) std::cout << std::setw(8) << short_names[j];
+    std::cout << "\n";
+    for (int i = 0; i < SLEEP_STAGES; i++) {
+        std::cout << std::setw(6) << short_names[i];
+        for (int j = 0; j < SLEEP_STAGES; j++) std::cout << std::setw(8) << pooled[i][j];
+        std::cout << "\n";
+    }
+
+    return failed ? 1 : 0;
+}
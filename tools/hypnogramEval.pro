@@ -0,0 +1,51 @@
+#   Offline sleep staging and hypnogram scoring, part of the project OpenLD.
+#   Build from this directory and run on any number of nights:
+#       qmake && make && ./hypnogramEval -j 8 night1.bdf=night1_hypnogram.edf ...
+
+TARGET = hypnogramEval
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+# For Windows
+LIBS     += -lfftw3-3
+
+# For Linux
+# LIBS     += -lfftw3
+# LIBS     += -lpthread
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += hypnogramEval.cpp \
+        nightReader.cpp \
+        ../sleepStager.cpp \
+        ../sleepModel.cpp \
+        ../remDetect.cpp \
+        ../saccadeDetector.cpp \
+        ../pipeline.cpp \
+        ../filterBank.cpp \
+        ../fixedFilterBank.cpp \
+        ../workspace.cpp \
+        ../polyphaseDecimator.cpp \
+        ../mainsNotch.cpp \
+        ../overlapSaveFIR.cpp \
+        ../edflib.c \
+        ../IIR_Coeffs.cpp
+
+HEADERS += nightReader.h \
+        ../analysisConstants.h \
+        ../sleepStager.h \
+        ../sleepModel.h \
+        ../remDetect.h \
+        ../saccadeDetector.h \
+        ../pipeline.h \
+        ../filterBank.h \
+        ../fixedFilterBank.h \
+        ../biquadCascade.h \
+        ../workspace.h \
+        ../polyphaseDecimator.h \
+        ../mainsNotch.h \
+        ../overlapSaveFIR.h \
+        ../edflib.h
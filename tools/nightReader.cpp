@@ -0,0 +1,265 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#include "nightReader.h"
+#include "../pipeline.h"
+#include "../remDetect.h"
+#include "../sleepStager.h"
+#include "../saccadeDetector.h"
+#include "../edflib.h"
+#include <mutex>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+// FFTW's planner is not thread safe, plans are made and destroyed one at a time
+static std::mutex fftw_lock;
+
+NightReader::NightReader()
+{
+    m_handle = -1;
+    m_signals = 0;
+    m_Fs = 0;
+    m_scale = 0;
+    m_pipeline = 0;
+    m_features = 0;
+    m_data = 0;
+    m_spectrum = 0;
+    m_window = 0;
+}
+
+int NightReader::open(const std::string &path, int first_channel, const std::string &config)
+{
+    close();
+
+    struct edf_hdr_struct *hdr = new struct edf_hdr_struct;
+
+    if (edfopen_file_readonly(path.c_str(), hdr, EDFLIB_DO_NOT_READ_ANNOTATIONS)) {
+        m_error = "can not open " + path;
+        delete hdr;
+        return -1;
+    }
+
+    m_handle = hdr->handle;
+    m_signals = hdr->edfsignals;
+
+    if (first_channel < 0 || first_channel >= m_signals) {
+        m_error = "no analysis channel in " + path;
+        delete hdr;
+        return -1;
+    }
+
+    // Labels come padded with spaces to 16 characters
+    char (*labels)[50] = new char[m_signals][50];
+    for (int i = 0; i < m_signals; i++) {
+        strncpy(labels[i], hdr->signalparam[i].label, 49);
+        labels[i][49] = 0;
+        for (int j = (int) strlen(labels[i]) - 1; j >= 0 && labels[i][j] == ' '; j--) labels[i][j] = 0;
+    }
+
+    // The first analysis channel sets the rate and the physical scale
+    const struct edf_param_struct &first = hdr->signalparam[first_channel];
+    m_Fs = (int) (first.smp_in_datarecord * EDFLIB_TIME_DIMENSION / hdr->datarecord_duration);
+    m_scale = (first.phys_max - first.phys_min) / (first.dig_max - first.dig_min);
+
+    std::string chains = config.empty() ?
+        Pipeline::default_Config(labels, first_channel, m_signals, m_Fs / ANALYSIS_FREQ, MAINS_FREQ, MAINS_BANDWIDTH) :
+        config;
+
+    int error = 0;
+    m_pipeline = new Pipeline(m_Fs, m_Fs, REM_DATA_WINDOW / ANALYSIS_FREQ);
+
+    {
+        std::lock_guard<std::mutex> lock(fftw_lock);
+        std::istringstream stream(chains);
+
+        if (m_Fs <= 0 || m_Fs % ANALYSIS_FREQ) {
+            m_error = "sample rate is not a multiple of the analysis rate";
+            error = -1;
+        } else if (m_pipeline->load(stream, labels, m_signals)) {
+            m_error = "analysis chains: " + m_pipeline->error();
+            error = -1;
+        } else {
+            m_features = new remDetect(ANALYSIS_FREQ, FFT_WINDOW, REM_DATA_WINDOW, EPOCH_SEC);
+        }
+    }
+
+    for (int i = 0; i < PIPELINE_OUTPUTS && !error; i++) {
+        if (i > PIPELINE_EOG2 && !m_pipeline->output(i)) continue;
+
+        if (m_pipeline->output_Rate(i) != ANALYSIS_FREQ || m_pipeline->output_Length(i) != REM_DATA_WINDOW) {
+            m_error = "analysis chains need output=EEG, EOG1 and EOG2 (and EMG if any) at the analysis rate";
+            error = -1;
+        }
+    }
+
+    for (int i = 0; i < m_signals && !error; i++) {
+        if (m_pipeline->uses_Channel(i) &&
+            hdr->signalparam[i].smp_in_datarecord != first.smp_in_datarecord) {
+            m_error = std::string("channel ") + labels[i] + " has another sample rate";
+            error = -1;
+        }
+    }
+
+    delete[] labels;
+    delete hdr;
+
+    if (error) return -1;
+
+    m_data = new int[m_signals * m_Fs];
+    m_spectrum = new double[FFT_WINDOW / 2];
+    m_window = 0;
+
+    return 0;
+}
+
+// After a successful open(), -1 otherwise
+int NightReader::add_Saccade_Limits(double min_velocity, double min_amplitude)
+{
+    if (!m_data) return -1;
+
+    SaccadeDetector *detector = new SaccadeDetector(ANALYSIS_FREQ, m_pipeline->block_Length(PIPELINE_EOG1));
+    detector->set_limits(min_velocity, min_amplitude);
+
+    m_saccade_detectors.push_back(detector);
+    m_saccades.push_back(0);
+
+    return m_saccade_detectors.size() - 1;
+}
+
+int NightReader::next_Window()
+{
+    if (!m_data) return 0;
+
+    for (size_t d = 0; d < m_saccades.size(); d++) m_saccades[d] = 0;
+
+    for (;;) {
+        for (int i = 0; i < m_signals; i++) {
+            if (!m_pipeline->uses_Channel(i)) continue;
+            if (edfread_digital_samples(m_handle, i, m_Fs, m_data + i * m_Fs) != m_Fs) return 0;
+        }
+
+        int ready = m_pipeline->push_Block(m_data, m_Fs, m_scale);
+
+        // Every block, on the EOG chains before their window stages
+        for (size_t d = 0; d < m_saccade_detectors.size(); d++)
+            m_saccades[d] += m_saccade_detectors[d]->push(m_pipeline->block_Output(PIPELINE_EOG1),
+                                                          m_pipeline->block_Output(PIPELINE_EOG2),
+                                                          m_pipeline->block_Length(PIPELINE_EOG1));
+
+        if (ready) break;
+    }
+
+    m_features->fft_power_Spectrum(m_pipeline->output(PIPELINE_EEG), m_spectrum);
+    m_window++;
+
+    return 1;
+}
+
+double *NightReader::output(int role) const
+{
+    return m_pipeline ? m_pipeline->output(role) : 0;
+}
+
+int NightReader::parse_Stage(const char *text)
+{
+    std::string s(text);
+    if (s.compare(0, 12, "Sleep stage ") == 0) s = s.substr(12);
+
+    if (s == "W") return SLEEP_W;
+    if (s == "1" || s == "N1") return SLEEP_N1;
+    if (s == "2" || s == "N2") return SLEEP_N2;
+    if (s == "3" || s == "4" || s == "N3") return SLEEP_N3;
+    if (s == "R" || s == "REM") return SLEEP_REM;
+
+    return -1;
+}
+
+// Stage of every EPOCH_SEC epoch, -1 where the reference has none
+int NightReader::read_Hypnogram(const std::string &path, std::vector<int> &stages, std::string &error)
+{
+    struct edf_hdr_struct *hdr = new struct edf_hdr_struct;
+    stages.clear();
+
+    if (edfopen_file_readonly(path.c_str(), hdr, EDFLIB_READ_ALL_ANNOTATIONS)) {
+        error = "can not open reference " + path;
+        delete hdr;
+        return -1;
+    }
+
+    for (long long n = 0; n < hdr->annotations_in_file; n++) {
+        struct edf_annotation_struct annot;
+        if (edf_get_annotation(hdr->handle, (int) n, &annot)) break;
+
+        int stage = parse_Stage(annot.annotation);
+        if (stage < 0) continue;
+
+        double onset = (double) annot.onset / EDFLIB_TIME_DIMENSION;
+        double duration = annot.duration[0] ? atof(annot.duration) : EPOCH_SEC;
+
+        // Every epoch starting inside the annotation, allowing for rounded onsets
+        long first = (long) ((onset - 0.5) / EPOCH_SEC);
+        if (first < 0) first = 0;
+        for (long e = first; (double) e * EPOCH_SEC + 0.5 < onset + duration; e++) {
+            if ((double) e * EPOCH_SEC + 0.5 < onset) continue;
+            if (e >= (long) stages.size()) stages.resize(e + 1, -1);
+            stages[e] = stage;
+        }
+    }
+
+    edfclose_file(hdr->handle);
+    delete hdr;
+    return 0;
+}
+
+void NightReader::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(fftw_lock);
+        delete m_features;
+        delete m_pipeline;
+    }
+    m_features = 0;
+    m_pipeline = 0;
+
+    if (m_handle >= 0) edfclose_file(m_handle);
+    m_handle = -1;
+
+    delete[] m_data;
+    delete[] m_spectrum;
+    m_data = 0;
+    m_spectrum = 0;
+
+    for (size_t d = 0; d < m_saccade_detectors.size(); d++) delete m_saccade_detectors[d];
+    m_saccade_detectors.clear();
+    m_saccades.clear();
+
+    m_error.clear();
+}
+
+NightReader::~NightReader()
+{
+    close();
+}
@@ -0,0 +1,107 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+#ifndef NIGHTREADER_H
+#define NIGHTREADER_H
+
+#include "../analysisConstants.h"
+#include <string>
+#include <vector>
+
+class Pipeline;
+class remDetect;
+class SaccadeDetector;
+
+/* READS A RECORDED NIGHT THROUGH THE LIVE ANALYSIS, WINDOW BY WINDOW
+ *
+ * Opens a BDF/EDF recording, builds the same chains as the live analysis (the
+ * default ones from the first analysis channel on, or a pipeline.cfg text) and
+ * hands out the filtered windows with the remDetect spectrum of the EEG, and the
+ * saccades of each window found on the EOG blocks as the live analysis does.
+ * Safe to use from several threads at once, one reader per thread.
+ *
+ * HOW TO USE
+    1. Open the recording, -1 on error (see error()):
+        NightReader.open(path, first analysis channel (0 based), pipeline.cfg text or "");
+    2. (Optional) Count saccades at some SaccadeDetector limits, detector index returned:
+        NightReader.add_Saccade_Limits(min velocity, min amplitude);
+    3. While NightReader.next_Window() RETURNS 1:
+        NightReader.output(PIPELINE_EEG), ..., NightReader.spectrum(), NightReader.features()
+        and NightReader.saccades(detector index)
+ *
+ * NightReader::read_Hypnogram() lays the stage annotations of a reference file
+ * ("Sleep stage W/1/2/3/4/R", "W", "N1", "N2", "N3", "REM") on epochs.
+ */
+
+class NightReader
+{
+public:
+    NightReader();
+    ~NightReader();
+
+    int open(const std::string &path, int first_channel, const std::string &config);
+    int next_Window();
+
+    int add_Saccade_Limits(double min_velocity, double min_amplitude);
+
+    double *output(int role) const;
+    double *spectrum() const { return m_spectrum; }
+    int saccades(int detector) const { return m_saccades[detector]; }
+    remDetect *features() const { return m_features; }
+
+    // Index of the last window handed out
+    long window() const { return m_window - 1; }
+
+    const std::string &error() const { return m_error; }
+
+    static int read_Hypnogram(const std::string &path, std::vector<int> &stages, std::string &error);
+    static int parse_Stage(const char *text);
+
+private:
+    NightReader(const NightReader &);
+    NightReader &operator=(const NightReader &);
+
+    void close();
+
+    int m_handle;
+    int m_signals;
+    int m_Fs;
+    double m_scale;
+
+    Pipeline *m_pipeline;
+    remDetect *m_features;
+    int *m_data;
+    double *m_spectrum;
+    long m_window;
+
+    // Saccades of the last window, per set of limits
+    std::vector<SaccadeDetector *> m_saccade_detectors;
+    std::vector<int> m_saccades;
+
+    std::string m_error;
+
+};
+
+#endif // NIGHTREADER_H
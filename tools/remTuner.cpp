@@ -0,0 +1,535 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+
+/* THRESHOLD SWEEP FOR THE REM DETECTION LIMITS OVER RECORDED NIGHTS
+ *
+ * The features of every 2 second window (SEFd, RP and AP of remDetect and the
+ * saccade count) come from <recording>.features (see featureStore.h) while it
+ * is newer than the recording - the live analysis writes it during the night -
+ * and are otherwise extracted once and cached there. The cached saccade counts
+ * are at the live SaccadeDetector limits; sweeping other limits detects the
+ * saccades again from the recording, once per set of limits. Every
+ * combination of set_limits(min SEFd, max AP, min RP, max RP), saccade limits,
+ * MIN_WINDOW_SACCADES and EOG_COUNTER_THRESHOLD is then replayed the way the live
+ * analysis decides - an epoch sliding by one window, REM when the averages pass
+ * the limits and more than the counter threshold windows had at least the minimum
+ * saccades - against the REM epochs of the reference hypnograms, spread over all cores.
+ *
+ * Every combination goes to a CSV; the summary gives, for a range of false
+ * positive rates, the most sensitive setting (ROC) and the quickest one to catch
+ * a REM period (latency from the start of the period).
+ *
+ * USAGE
+ *     remTuner [-j threads] [-a first analysis channel #] [-c pipeline.cfg] [-o rem_tuning.csv]
+ *              [-s min SEFd] [-A max AP] [-r min RP] [-R max RP]
+ *              [-v saccade min velocity uV/s] [-m saccade min amplitude uV] [-w min window saccades]
+ *              [-n EOG counter thresholds]
+ *              recording.bdf=reference.edf ...
+ *     Ranges are <first>:<last>:<step> or a list <a>,<b>,...
+ */
+
+#include "nightReader.h"
+#include "../remDetect.h"
+#include "../sleepStager.h"
+#include "../pipeline.h"
+#include "../featureStore.h"
+#include "../analysisConstants.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+// Live analysis: one decision per window over the last EPOCH_SEC
+const int EPOCH_WINDOWS = EPOCH_SEC / EPOCH_HOP_SEC;
+
+// What serialmonitor uses now, reported next to the best settings
+const double CURRENT_LIMITS[] = { REM_MIN_SEFD, REM_MAX_AP, REM_MIN_RP, REM_MAX_RP,
+                                  SACCADE_MIN_VELOCITY, SACCADE_MIN_AMPLITUDE, MIN_WINDOW_SACCADES, EOG_COUNTER_THRESHOLD };
+
+// Share of REM periods a setting must catch to count in the latency table
+const double LATENCY_MIN_BOUTS = 0.8;
+
+struct WindowFeatures {
+    float SEFd, RP, AP;
+};
+
+struct Night {
+    std::string recording, reference;
+    std::string error;
+    std::vector<WindowFeatures> windows;
+    std::vector<uint8_t> saccades;      // [window][saccade limits]
+    std::vector<int> stages;
+};
+
+enum { PARAM_SEFD, PARAM_AP, PARAM_MIN_RP, PARAM_MAX_RP, PARAM_VELOCITY, PARAM_AMPLITUDE, PARAM_SACCADES, PARAM_COUNTER, PARAMS };
+
+struct Result {
+    double TPR, FPR, precision;
+    double bouts, latency;
+};
+
+static std::string config_text;
+static int first_channel = 0;
+
+// Saccade limits swept, velocity major
+static std::vector<double> saccade_velocities, saccade_amplitudes;
+
+static int live_Saccade_Limits()
+{
+    return saccade_velocities.size() == 1 && saccade_velocities[0] == SACCADE_MIN_VELOCITY &&
+           saccade_amplitudes.size() == 1 && saccade_amplitudes[0] == SACCADE_MIN_AMPLITUDE;
+}
+
+// The cached saccade counts are at the live limits
+static int read_Cache(Night &night, const std::string &path)
+{
+    struct stat cache_stat, recording_stat;
+    if (stat(path.c_str(), &cache_stat) || stat(night.recording.c_str(), &recording_stat) ||
+        cache_stat.st_mtime < recording_stat.st_mtime)
+        return -1;
+
+    FeatureStore cache;
+    if (cache.open(path) || cache.rate() != ANALYSIS_FREQ || cache.window_Samples() != REM_DATA_WINDOW ||
+        cache.fft_Size() != FFT_WINDOW)
+        return -1;
+
+    night.windows.resize(cache.rows());
+    night.saccades.resize(cache.rows());
+    for (long i = 0; i < cache.rows(); i++) {
+        WindowFeatures &window = night.windows[i];
+        window.SEFd = cache.value(i, FEATURE_SEFD);
+        window.RP = cache.value(i, FEATURE_RP);
+        window.AP = cache.value(i, FEATURE_AP);
+        night.saccades[i] = (uint8_t) std::min(cache.value(i, FEATURE_SACCADES), 255.0f);
+    }
+    return 0;
+}
+
+static int extract_Night(Night &night)
+{
+    std::string cache_path = night.recording + ".features";
+    int cached = (read_Cache(night, cache_path) == 0);
+
+    if (!cached || !live_Saccade_Limits()) {
+        NightReader reader;
+        FeatureStore cache;
+
+        if (reader.open(night.recording, first_channel, config_text)) {
+            night.error = reader.error();
+            return -1;
+        }
+
+        // The live limits for the cache first, then the swept ones
+        int live = reader.add_Saccade_Limits(SACCADE_MIN_VELOCITY, SACCADE_MIN_AMPLITUDE);
+        for (size_t v = 0; v < saccade_velocities.size(); v++)
+            for (size_t a = 0; a < saccade_amplitudes.size(); a++)
+                reader.add_Saccade_Limits(saccade_velocities[v], saccade_amplitudes[a]);
+
+        night.windows.clear();
+        night.saccades.clear();
+        if (!cached) cache.create(cache_path, ANALYSIS_FREQ, REM_DATA_WINDOW, FFT_WINDOW);
+
+        while (reader.next_Window()) {
+            double features[FEATURE_COLUMNS];
+            remDetect *analysis = reader.features();
+
+            features[FEATURE_TIME] = (double) (reader.window() + 1) * EPOCH_HOP_SEC;
+            analysis->calc_Features(reader.spectrum(), REM_BAND_LOW, REM_BAND_HIGH, &features[FEATURE_SEFD], &features[FEATURE_RP], &features[FEATURE_AP]);
+            analysis->evaluate_EOG_REM_Epoch(reader.output(PIPELINE_EOG1), reader.output(PIPELINE_EOG2), 0);
+            features[FEATURE_EOG_IP] = analysis->avg_EOG_IP;
+            features[FEATURE_SACCADES] = reader.saccades(live);
+            if (!cached) cache.append(features, reader.spectrum());
+
+            WindowFeatures window = { (float) features[FEATURE_SEFD], (float) features[FEATURE_RP],
+                                      (float) features[FEATURE_AP] };
+            night.windows.push_back(window);
+            for (int l = live + 1; l <= (int) (saccade_velocities.size() * saccade_amplitudes.size()); l++)
+                night.saccades.push_back((uint8_t) std::min(reader.saccades(l), 255));
+        }
+    }
+
+    return NightReader::read_Hypnogram(night.reference, night.stages, night.error);
+}
+
+// "first:last:step" or "a,b,c"
+static int parse_Range(const std::string &text, std::vector<double> &values)
+{
+    values.clear();
+
+    if (text.find(':') != std::string::npos) {
+        double first, last, step;
+        if (sscanf(text.c_str(), "%lf:%lf:%lf", &first, &last, &step) != 3 || step <= 0 || last < first) return -1;
+        for (double v = first; v <= last + step * 1e-6; v += step) values.push_back(v);
+    } else {
+        std::istringstream items(text);
+        std::string item;
+        while (std::getline(items, item, ',')) values.push_back(atof(item.c_str()));
+    }
+
+    return values.empty() ? -1 : 0;
+}
+
+/* Decisions of all nights laid end to end, as the live analysis makes them.
+ * The epoch averages do not depend on the limits, only the EOG counts depend on
+ * the saccade limits and the minimum saccades per window, so both are computed
+ * once here.
+ */
+struct Decisions {
+    std::vector<float> SEFd, AP, RP;
+    std::vector<std::vector<uint8_t> > eog_count;   // [saccade limits][min saccades][decision]
+    std::vector<int8_t> label;                      // 1 REM, 0 not REM, -1 unscored
+    std::vector<int32_t> bout;                      // REM period of a REM decision
+    std::vector<float> since;                       // seconds into that period
+    long bouts;
+};
+
+static void build_Decisions(const std::vector<Night> &nights, const std::vector<double> &min_saccades, Decisions &d)
+{
+    size_t limits = saccade_velocities.size() * saccade_amplitudes.size();
+    size_t eog_settings = limits * min_saccades.size();
+    d.eog_count.resize(eog_settings);
+    d.bouts = 0;
+
+    for (size_t n = 0; n < nights.size(); n++) {
+        const Night &night = nights[n];
+        if (!night.error.empty()) continue;
+
+        const std::vector<WindowFeatures> &w = night.windows;
+        const uint8_t *saccades = night.saccades.data();
+        double sum_SEFd = 0, sum_AP = 0, sum_RP = 0;
+        std::vector<int> hits(eog_settings, 0);
+        double bout_start = -1;
+
+        for (size_t i = 0; i < w.size(); i++) {
+            sum_SEFd += w[i].SEFd;
+            sum_AP += w[i].AP;
+            sum_RP += w[i].RP;
+            for (size_t e = 0; e < eog_settings; e++)
+                hits[e] += saccades[i * limits + e / min_saccades.size()] >= min_saccades[e % min_saccades.size()];
+
+            if (i >= (size_t) EPOCH_WINDOWS) {
+                size_t old = i - EPOCH_WINDOWS;
+                sum_SEFd -= w[old].SEFd;
+                sum_AP -= w[old].AP;
+                sum_RP -= w[old].RP;
+                for (size_t e = 0; e < eog_settings; e++)
+                    hits[e] -= saccades[old * limits + e / min_saccades.size()] >= min_saccades[e % min_saccades.size()];
+            }
+
+            // Stage at the end of the window, REM periods are runs of REM epochs
+            double end = (double) (i + 1) * EPOCH_HOP_SEC;
+            size_t epoch = (size_t) ((end - 1) / EPOCH_SEC);
+            int stage = (epoch < night.stages.size()) ? night.stages[epoch] : -1;
+
+            if (stage == SLEEP_REM) {
+                if (bout_start < 0) {
+                    bout_start = (double) epoch * EPOCH_SEC;
+                    d.bouts++;
+                }
+            } else {
+                bout_start = -1;
+            }
+
+            if (i + 1 < (size_t) EPOCH_WINDOWS) continue;
+
+            d.SEFd.push_back(sum_SEFd / EPOCH_WINDOWS);
+            d.AP.push_back(sum_AP / EPOCH_WINDOWS);
+            d.RP.push_back(sum_RP / EPOCH_WINDOWS);
+            for (size_t e = 0; e < eog_settings; e++) d.eog_count[e].push_back(hits[e]);
+            d.label.push_back(stage < 0 ? -1 : (stage == SLEEP_REM));
+            d.bout.push_back(stage == SLEEP_REM ? d.bouts : 0);
+            d.since.push_back(stage == SLEEP_REM ? end - bout_start : 0);
+        }
+    }
+}
+
+// Replays one setting over all decisions; eeg is scratch space for the EEG criteria
+static Result evaluate(const Decisions &d, const double *p, int eog_index, std::vector<uint8_t> &eeg)
+{
+    size_t count = d.label.size();
+    const float *SEFd = d.SEFd.data(), *AP = d.AP.data(), *RP = d.RP.data();
+    float min_SEFd = p[PARAM_SEFD], max_AP = p[PARAM_AP], min_RP = p[PARAM_MIN_RP], max_RP = p[PARAM_MAX_RP];
+
+    // Branch free so it vectorizes
+    for (size_t i = 0; i < count; i++)
+        eeg[i] = (SEFd[i] > min_SEFd) & (AP[i] < max_AP) & (RP[i] > min_RP) & (RP[i] < max_RP);
+
+    const uint8_t *eog = d.eog_count[eog_index].data();
+    int counter = (int) p[PARAM_COUNTER];
+    long TP = 0, FP = 0, P = 0, N = 0, caught = 0;
+    double latency = 0;
+    int32_t last_bout = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (d.label[i] < 0) continue;
+
+        int detected = eeg[i] && eog[i] > counter;
+
+        if (d.label[i]) {
+            P++;
+            TP += detected;
+            if (detected && d.bout[i] != last_bout) {
+                last_bout = d.bout[i];
+                latency += d.since[i];
+                caught++;
+            }
+        } else {
+            N++;
+            FP += detected;
+        }
+    }
+
+    Result r;
+    r.TPR = P ? (double) TP / P : 0;
+    r.FPR = N ? (double) FP / N : 0;
+    r.precision = (TP + FP) ? (double) TP / (TP + FP) : 0;
+    r.bouts = d.bouts ? (double) caught / d.bouts : 0;
+    r.latency = caught ? latency / caught : -1;
+    return r;
+}
+
+static void print_Setting(const double *p, const Result &r)
+{
+    std::cout << std::setprecision(1)
+              << std::setw(7) << p[PARAM_SEFD] << std::setw(7) << p[PARAM_AP]
+              << std::setw(7) << p[PARAM_MIN_RP] << std::setw(7) << p[PARAM_MAX_RP]
+              << std::setw(8) << p[PARAM_VELOCITY] << std::setw(6) << p[PARAM_AMPLITUDE]
+              << std::setw(5) << p[PARAM_SACCADES] << std::setw(5) << p[PARAM_COUNTER]
+              << std::setprecision(3)
+              << std::setw(8) << r.TPR << std::setw(8) << r.FPR << std::setw(8) << r.bouts
+              << std::setprecision(1) << std::setw(9) << r.latency << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<Night> nights;
+    std::vector<double> grid[PARAMS];
+    const char *defaults[PARAMS] = { "2:6:0.5", "13:21:1", "-19:-13:1", "-15:-9:1", "1000,1500,2000", "15,25,35", "1:3:1", "0:4:1" };
+    const char *flags[PARAMS] = { "-s", "-A", "-r", "-R", "-v", "-m", "-w", "-n" };
+    std::string csv_path = "rem_tuning.csv";
+    int threads = (int) std::thread::hardware_concurrency();
+
+    for (int k = 0; k < PARAMS; k++) parse_Range(defaults[k], grid[k]);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        int param = -1;
+        for (int k = 0; k < PARAMS; k++) if (arg == flags[k]) param = k;
+
+        if (arg[0] == '-' && i + 1 < argc) {
+            std::string value(argv[++i]);
+
+            if (param >= 0) {
+                if (parse_Range(value, grid[param])) {
+                    std::cerr << "Bad range " << value << " for " << arg << "\n";
+                    return 1;
+                }
+            } else if (arg == "-j") threads = atoi(value.c_str());
+            else if (arg == "-a") first_channel = atoi(value.c_str()) - 1;
+            else if (arg == "-o") csv_path = value;
+            else if (arg == "-c") {
+                std::ifstream file(value.c_str());
+                if (!file.is_open()) {
+                    std::cerr << "Can not open " << value << "\n";
+                    return 1;
+                }
+                std::ostringstream text;
+                text << file.rdbuf();
+                config_text = text.str();
+            } else {
+                std::cerr << "Unknown option " << arg << "\n";
+                return 1;
+            }
+
+        } else {
+            Night night;
+            size_t split = arg.find('=');
+            night.recording = arg.substr(0, split);
+            if (split != std::string::npos) night.reference = arg.substr(split + 1);
+            nights.push_back(night);
+        }
+    }
+
+    if (nights.empty() || first_channel < 0) {
+        std::cerr << "Usage: remTuner [-j threads] [-a first analysis channel #] [-c pipeline.cfg] [-o rem_tuning.csv]\n"
+                     "                [-s min SEFd] [-A max AP] [-r min RP] [-R max RP]\n"
+                     "                [-v saccade min velocity uV/s] [-m saccade min amplitude uV] [-w min window saccades]\n"
+                     "                [-n EOG counter thresholds]\n"
+                     "                recording.bdf=reference.edf ...\n";
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    saccade_velocities = grid[PARAM_VELOCITY];
+    saccade_amplitudes = grid[PARAM_AMPLITUDE];
+
+    // 1. Features, one night per thread
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads && t < (int) nights.size(); t++)
+        workers.push_back(std::thread([&]() {
+            for (int n = next++; n < (int) nights.size(); n = next++) {
+                if (nights[n].reference.empty()) nights[n].error = "needs a reference hypnogram";
+                else extract_Night(nights[n]);
+            }
+        }));
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    workers.clear();
+
+    for (size_t n = 0; n < nights.size(); n++) {
+        std::cout << nights[n].recording << ": ";
+        if (nights[n].error.empty()) std::cout << nights[n].windows.size() << " windows\n";
+        else std::cout << nights[n].error << "\n";
+    }
+
+    Decisions decisions;
+    build_Decisions(nights, grid[PARAM_SACCADES], decisions);
+
+    if (decisions.label.empty()) {
+        std::cerr << "No scored windows to tune on\n";
+        return 1;
+    }
+
+    // 2. Every setting, in chunks handed out to the threads
+    long settings = 1;
+    for (int k = 0; k < PARAMS; k++) settings *= grid[k].size();
+
+    std::vector<Result> results(settings);
+    std::vector<char> valid(settings, 0);
+    const long chunk = 64;
+    std::atomic<long> next_setting(0);
+
+    for (int t = 0; t < threads; t++)
+        workers.push_back(std::thread([&]() {
+            std::vector<uint8_t> eeg(decisions.label.size());
+
+            for (long start = next_setting.fetch_add(chunk); start < settings; start = next_setting.fetch_add(chunk)) {
+                for (long s = start; s < start + chunk && s < settings; s++) {
+                    double p[PARAMS];
+                    int index[PARAMS];
+                    long rest = s;
+                    for (int k = PARAMS - 1; k >= 0; k--) {
+                        index[k] = rest % grid[k].size();
+                        rest /= grid[k].size();
+                        p[k] = grid[k][index[k]];
+                    }
+
+                    if (p[PARAM_MIN_RP] >= p[PARAM_MAX_RP]) continue;
+
+                    int eog_index = (index[PARAM_VELOCITY] * grid[PARAM_AMPLITUDE].size() + index[PARAM_AMPLITUDE]) *
+                                    grid[PARAM_SACCADES].size() + index[PARAM_SACCADES];
+                    results[s] = evaluate(decisions, p, eog_index, eeg);
+                    valid[s] = 1;
+                }
+            }
+        }));
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    // 3. Tables
+    std::ofstream csv(csv_path.c_str());
+    csv << "min_SEFd, max_AP, min_RP, max_RP, saccade_velocity, saccade_amplitude, min_window_saccades, eog_counter, "
+           "TPR, FPR, precision, REM periods caught, latency s\n";
+
+    const double budgets[] = { 0.005, 0.01, 0.02, 0.05, 0.1, 0.2 };
+    const int nbudgets = sizeof(budgets) / sizeof(budgets[0]);
+    long best_roc[nbudgets], best_latency[nbudgets];
+    for (int b = 0; b < nbudgets; b++) best_roc[b] = best_latency[b] = -1;
+
+    std::vector<double> params((size_t) settings * PARAMS);
+    for (long s = 0; s < settings; s++) {
+        long rest = s;
+        for (int k = PARAMS - 1; k >= 0; k--) {
+            params[s * PARAMS + k] = grid[k][rest % grid[k].size()];
+            rest /= grid[k].size();
+        }
+        if (!valid[s]) continue;
+
+        const Result &r = results[s];
+        const double *p = &params[s * PARAMS];
+        for (int k = 0; k < PARAMS; k++) csv << p[k] << ", ";
+        csv << r.TPR << ", " << r.FPR << ", " << r.precision << ", " << r.bouts << ", " << r.latency << "\n";
+
+        for (int b = 0; b < nbudgets; b++) {
+            if (r.FPR > budgets[b]) continue;
+
+            long &roc = best_roc[b];
+            if (roc < 0 || r.TPR > results[roc].TPR ||
+                (r.TPR == results[roc].TPR && r.latency >= 0 && r.latency < results[roc].latency))
+                roc = s;
+
+            long &fast = best_latency[b];
+            if (r.bouts >= LATENCY_MIN_BOUTS && r.latency >= 0 &&
+                (fast < 0 || r.latency < results[fast].latency))
+                fast = s;
+        }
+    }
+
+    std::cout << "\n" << decisions.label.size() << " decisions, " << decisions.bouts << " REM periods, "
+              << settings << " settings -> " << csv_path << "\n" << std::fixed << std::setprecision(3);
+
+    const char *columns = "   FPR<=   SEFd     AP  minRP  maxRP     vel   amp  min  cnt     TPR     FPR  caught  latency\n";
+
+    std::cout << "\nROC: most sensitive setting within each false positive budget\n" << columns;
+    for (int b = 0; b < nbudgets; b++) {
+        std::cout << std::setprecision(3) << std::setw(8) << budgets[b];
+        if (best_roc[b] < 0) std::cout << "  -\n";
+        else print_Setting(&params[best_roc[b] * PARAMS], results[best_roc[b]]);
+    }
+
+    std::cout << "\nLatency: quickest setting catching " << std::setprecision(0) << LATENCY_MIN_BOUTS * 100
+              << "% of REM periods within each budget\n"
+              << columns;
+    for (int b = 0; b < nbudgets; b++) {
+        std::cout << std::setprecision(3) << std::setw(8) << budgets[b];
+        if (best_latency[b] < 0) std::cout << "  -\n";
+        else print_Setting(&params[best_latency[b] * PARAMS], results[best_latency[b]]);
+    }
+
+    // The limits in use now, if their saccade settings are on the grid
+    int current[PARAMS];
+    for (int k = PARAM_VELOCITY; k <= PARAM_SACCADES; k++) {
+        current[k] = -1;
+        for (size_t i = 0; i < grid[k].size(); i++)
+            if (grid[k][i] == CURRENT_LIMITS[k]) current[k] = i;
+    }
+    if (current[PARAM_VELOCITY] >= 0 && current[PARAM_AMPLITUDE] >= 0 && current[PARAM_SACCADES] >= 0) {
+        std::vector<uint8_t> eeg(decisions.label.size());
+        int eog_index = (current[PARAM_VELOCITY] * grid[PARAM_AMPLITUDE].size() + current[PARAM_AMPLITUDE]) *
+                        grid[PARAM_SACCADES].size() + current[PARAM_SACCADES];
+        std::cout << "\nCurrent ";
+        print_Setting(CURRENT_LIMITS, evaluate(decisions, CURRENT_LIMITS, eog_index, eeg));
+    }
+
+    return 0;
+}
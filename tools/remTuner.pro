@@ -0,0 +1,50 @@
+#   Threshold sweep of the REM detection limits, part of the project OpenLD.
+#   Build from this directory and run on any number of nights:
+#       qmake && make && ./remTuner -j 8 night1.bdf=night1_hypnogram.edf ...
+
+TARGET = remTuner
+CONFIG   += console c++11
+CONFIG   -= app_bundle qt
+
+TEMPLATE = app
+
+# For Windows
+LIBS     += -lfftw3-3
+
+# For Linux
+# LIBS     += -lfftw3
+# LIBS     += -lpthread
+
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE *= -O3
+
+SOURCES += remTuner.cpp \
+        nightReader.cpp \
+        ../remDetect.cpp \
+        ../saccadeDetector.cpp \
+        ../featureStore.cpp \
+        ../pipeline.cpp \
+        ../filterBank.cpp \
+        ../fixedFilterBank.cpp \
+        ../workspace.cpp \
+        ../polyphaseDecimator.cpp \
+        ../mainsNotch.cpp \
+        ../overlapSaveFIR.cpp \
+        ../edflib.c \
+        ../IIR_Coeffs.cpp
+
+HEADERS += nightReader.h \
+        ../analysisConstants.h \
+        ../sleepStager.h \
+        ../remDetect.h \
+        ../saccadeDetector.h \
+        ../featureStore.h \
+        ../pipeline.h \
+        ../filterBank.h \
+        ../fixedFilterBank.h \
+        ../biquadCascade.h \
+        ../workspace.h \
+        ../polyphaseDecimator.h \
+        ../mainsNotch.h \
+        ../overlapSaveFIR.h \
+        ../edflib.h
@@ -0,0 +1,65 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#include "workspace.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Buffers are padded to whole cache lines
+const int WORKSPACE_ALIGN = 64 / sizeof(double);
+
+Workspace::Workspace(int capacity)
+{
+    m_capacity = capacity;
+    m_used = 0;
+
+    // Over-allocate by one cache line so the base can be aligned
+    m_memory = new double[m_capacity + WORKSPACE_ALIGN];
+    m_base = m_memory;
+    while (((uintptr_t) m_base) % 64) m_base++;
+
+    for (int i = 0; i < m_capacity; i++) m_base[i] = 0.0;
+}
+
+int Workspace::size_Of(int count)
+{
+    return ((count + WORKSPACE_ALIGN - 1) / WORKSPACE_ALIGN) * WORKSPACE_ALIGN;
+}
+
+double *Workspace::take(int count)
+{
+    int size = size_Of(count);
+
+    if (count < 0 || m_used + size > m_capacity) return NULL;
+
+    double *buffer = m_base + m_used;
+    m_used += size;
+
+    return buffer;
+}
+
+Workspace::~Workspace()
+{
+    delete[] m_memory;
+}
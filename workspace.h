@@ -0,0 +1,66 @@
+/* MIT License
+
+   Copyright (c) [2016] [Jae Choi]
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+ */
+
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+/* PREALLOCATED SCRATCH MEMORY FOR A DSP PIPELINE
+ *
+ * The whole arena is allocated once, sized from the pipeline configuration, and
+ * intermediate buffers are carved out of it. Nothing is handed back until the
+ * workspace is destroyed, so the analysis hot path never allocates.
+ * Every buffer starts on a 64 byte boundary.
+ *
+ * HOW TO USE
+    1. Add up the doubles needed by each buffer with Workspace::size_Of()
+    2. Initialize object:
+        Workspace(total # of doubles)
+    3. Carve buffers:
+        double *buf = Workspace.take(# of doubles);   -> NULL if the arena is too small
+ *
+ */
+
+class Workspace
+{
+public:
+    Workspace(int capacity);
+    ~Workspace();
+
+    double *take(int count);
+
+    // Space a buffer of count doubles occupies in the arena, including alignment padding
+    static int size_Of(int count);
+
+    int used() const { return m_used; }
+    int capacity() const { return m_capacity; }
+
+private:
+    double *m_memory;
+    double *m_base;
+    int m_capacity;
+    int m_used;
+
+};
+
+#endif // WORKSPACE_H